@@ -0,0 +1,183 @@
+/* -*- Mode: C; c-basic-offset:4 ; -*- */
+/*
+ * Copyright (c) 2016      Intel, Inc. All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+/*
+ * Time gds_hash_bytes against the two byte-at-a-time hashes it
+ * replaced - the one-at-a-time hash GDS_HASH_STR used to be, and the
+ * multiply-by-31 loop gds_hash_table used for pointer keys - over
+ * dotted key names of 10 to 60 bytes, such as the datastores see.
+ *
+ * Build from the top of the source tree with:
+ *
+ *     cc -O2 -I. bench/hash_string.c -o hash_string
+ *
+ * and run it with an optional number of keys (default 4096).
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "src/include/hash_string.h"
+
+#define BENCH_MIN_LEN   10
+#define BENCH_MAX_LEN   60
+/* hash every key this many times per run */
+#define BENCH_ROUNDS    256
+#define BENCH_RUNS      5
+
+static const char *bench_words[] = {
+    "gds", "pmix", "job", "rank", "node", "app", "local", "peers",
+    "hostname", "cpuset", "nspace", "uri", "size", "univ", "proc",
+    "mapping", "binding", "locality", "topo", "fabric", "endpt", "0",
+    "17", "4096", "x86_64", "server", "tmpdir", "credential"
+};
+#define BENCH_NWORDS (sizeof(bench_words) / sizeof(bench_words[0]))
+
+static uint64_t bench_seed = 0x9e3779b97f4a7c15ULL;
+/* keeps the hashing from being optimized away */
+static volatile uint64_t bench_sink;
+
+static uint32_t bench_random(void)
+{
+    bench_seed = bench_seed * 6364136223846793005ULL + 1442695040888963407ULL;
+    return (uint32_t)(bench_seed >> 33);
+}
+
+/* join random words with dots until the name is long enough,
+ * then cut it to a length picked between the bounds */
+static char* bench_make_key(void)
+{
+    size_t len = BENCH_MIN_LEN + bench_random() % (BENCH_MAX_LEN - BENCH_MIN_LEN + 1);
+    char buf[BENCH_MAX_LEN * 2];
+    size_t used = 0, n;
+    const char *word;
+
+    while (used < len) {
+        word = bench_words[bench_random() % BENCH_NWORDS];
+        n = strlen(word);
+        if (0 < used) {
+            buf[used++] = '.';
+        }
+        memcpy(buf + used, word, n);
+        used += n;
+    }
+    buf[len] = '\0';
+    return strdup(buf);
+}
+
+/* what GDS_HASH_STR used to be */
+static uint64_t bench_oaat(const char *key, size_t len)
+{
+    uint32_t hash = 0;
+
+    while (0 < len--) {
+        hash += *key++;
+        hash += (hash << 10);
+        hash ^= (hash >> 6);
+    }
+    hash += (hash << 3);
+    hash ^= (hash >> 11);
+    return hash + (hash << 15);
+}
+
+/* what gds_hash_hash_key_ptr used to be */
+static uint64_t bench_times31(const char *key, size_t len)
+{
+    const unsigned char *p = (const unsigned char*)key;
+    uint64_t hash = 0;
+
+    while (0 < len--) {
+        hash = 31 * hash + *p++;
+    }
+    return hash;
+}
+
+static uint64_t bench_bytes(const char *key, size_t len)
+{
+    return gds_hash_bytes(key, len, 0);
+}
+
+static double bench_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* the best of several runs, in ns per key */
+static double bench_run(uint64_t (*fn)(const char*, size_t),
+                        char **keys, size_t *lens, size_t nkeys,
+                        uint64_t *sink)
+{
+    double best = 0, start, ns;
+    size_t i, r;
+    int run;
+
+    for (run = 0; run < BENCH_RUNS; run++) {
+        start = bench_now();
+        for (r = 0; r < BENCH_ROUNDS; r++) {
+            for (i = 0; i < nkeys; i++) {
+                *sink += fn(keys[i], lens[i]);
+            }
+        }
+        ns = (bench_now() - start) * 1e9 / ((double)BENCH_ROUNDS * nkeys);
+        if (0 == run || ns < best) {
+            best = ns;
+        }
+    }
+    return best;
+}
+
+int main(int argc, char **argv)
+{
+    size_t nkeys = 4096, i, total = 0;
+    uint64_t sink = 0;
+    char **keys;
+    size_t *lens;
+
+    if (1 < argc && 0 == (nkeys = strtoul(argv[1], NULL, 10))) {
+        fprintf(stderr, "usage: %s [nkeys]\n", argv[0]);
+        return 1;
+    }
+    keys = (char**)malloc(nkeys * sizeof(char*));
+    lens = (size_t*)malloc(nkeys * sizeof(size_t));
+    if (NULL == keys || NULL == lens) {
+        return 1;
+    }
+    for (i = 0; i < nkeys; i++) {
+        if (NULL == (keys[i] = bench_make_key())) {
+            return 1;
+        }
+        lens[i] = strlen(keys[i]);
+        total += lens[i];
+    }
+
+    printf("%lu keys of %d-%d bytes, %.1f on average, e.g. %s\n",
+           (unsigned long)nkeys, BENCH_MIN_LEN, BENCH_MAX_LEN,
+           (double)total / nkeys, keys[0]);
+    printf("one-at-a-time    %6.2f ns/key\n",
+           bench_run(bench_oaat, keys, lens, nkeys, &sink));
+    printf("multiply-by-31   %6.2f ns/key\n",
+           bench_run(bench_times31, keys, lens, nkeys, &sink));
+    printf("gds_hash_bytes   %6.2f ns/key\n",
+           bench_run(bench_bytes, keys, lens, nkeys, &sink));
+
+    for (i = 0; i < nkeys; i++) {
+        free(keys[i]);
+    }
+    free(keys);
+    free(lens);
+    bench_sink = sink;
+    return 0;
+}
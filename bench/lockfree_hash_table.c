@@ -0,0 +1,166 @@
+/* -*- Mode: C; c-basic-offset:4 ; -*- */
+/*
+ * Copyright (c) 2016      Intel, Inc. All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+/*
+ * Contention benchmark for gds_lockfree_hash_table_t. From 1 to 64
+ * threads (doubling each time) run a mix of 80% lookups, 10% inserts
+ * and 10% removes on random keys of a shared table, half full at the
+ * start. The same mix is run on a gds_hash_table_t behind a single
+ * mutex - the only way to share one before - for comparison.
+ *
+ * Build it from the top of a configured and built tree with:
+ *
+ *     cc -O2 -I. -Iinclude bench/lockfree_hash_table.c \
+ *        -Lsrc/.libs -lgds -lpthread -o lockfree_hash_table
+ *
+ * and run it with an optional largest thread count (default 64).
+ * Nothing is gained from more threads than there are cores - past
+ * that point the numbers show how each table copes with threads
+ * being preempted, which is where the mutex suffers most.
+ */
+
+#include <src/include/gds_config.h>
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "src/class/gds_hash_table.h"
+#include "src/class/gds_lockfree_hash_table.h"
+
+#define BENCH_KEYS          65536
+#define BENCH_MAX_THREADS   64
+/* operations done by each thread */
+#define BENCH_OPS           400000
+
+static gds_lockfree_hash_table_t *bench_lf;
+static gds_hash_table_t bench_ht;
+static pthread_mutex_t bench_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_barrier_t bench_start;
+static volatile uintptr_t bench_sink;
+
+static void* bench_lockfree(void *arg)
+{
+    uint64_t seed = (uintptr_t)arg * 2654435761u + 1, key;
+    uintptr_t sum = 0;
+    void *value;
+    long n;
+
+    pthread_barrier_wait(&bench_start);
+    for (n = 0; n < BENCH_OPS; n++) {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        key = (seed >> 33) % BENCH_KEYS;
+        switch ((seed >> 20) % 10) {
+        case 8:
+            gds_lockfree_hash_table_set_value_uint64(bench_lf, key, (void*)1);
+            break;
+        case 9:
+            gds_lockfree_hash_table_remove_value_uint64(bench_lf, key);
+            break;
+        default:
+            if (GDS_SUCCESS == gds_lockfree_hash_table_get_value_uint64(bench_lf, key, &value)) {
+                sum += (uintptr_t)value;
+            }
+            break;
+        }
+    }
+    bench_sink += sum;
+    return NULL;
+}
+
+static void* bench_mutex(void *arg)
+{
+    uint64_t seed = (uintptr_t)arg * 2654435761u + 1, key;
+    uintptr_t sum = 0;
+    void *value;
+    long n;
+
+    pthread_barrier_wait(&bench_start);
+    for (n = 0; n < BENCH_OPS; n++) {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        key = (seed >> 33) % BENCH_KEYS;
+        pthread_mutex_lock(&bench_lock);
+        switch ((seed >> 20) % 10) {
+        case 8:
+            gds_hash_table_set_value_uint64(&bench_ht, key, (void*)1);
+            break;
+        case 9:
+            gds_hash_table_remove_value_uint64(&bench_ht, key);
+            break;
+        default:
+            if (GDS_SUCCESS == gds_hash_table_get_value_uint64(&bench_ht, key, &value)) {
+                sum += (uintptr_t)value;
+            }
+            break;
+        }
+        pthread_mutex_unlock(&bench_lock);
+    }
+    bench_sink += sum;
+    return NULL;
+}
+
+/* run the mix on nthreads threads, in millions of operations a second */
+static double bench_run(void* (*fn)(void*), int nthreads)
+{
+    pthread_t threads[BENCH_MAX_THREADS];
+    struct timespec start, end;
+    double secs;
+    uint64_t key;
+    int n;
+
+    bench_lf = GDS_NEW(gds_lockfree_hash_table_t);
+    gds_lockfree_hash_table_init(bench_lf, BENCH_KEYS);
+    GDS_CONSTRUCT(&bench_ht, gds_hash_table_t);
+    gds_hash_table_init(&bench_ht, BENCH_KEYS);
+    for (key = 0; key < BENCH_KEYS; key += 2) {
+        gds_lockfree_hash_table_set_value_uint64(bench_lf, key, (void*)1);
+        gds_hash_table_set_value_uint64(&bench_ht, key, (void*)1);
+    }
+
+    pthread_barrier_init(&bench_start, NULL, nthreads + 1);
+    for (n = 0; n < nthreads; n++) {
+        if (0 != pthread_create(&threads[n], NULL, fn, (void*)(uintptr_t)n)) {
+            fprintf(stderr, "cannot start thread %d\n", n);
+            exit(1);
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    pthread_barrier_wait(&bench_start);
+    for (n = 0; n < nthreads; n++) {
+        pthread_join(threads[n], NULL);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    pthread_barrier_destroy(&bench_start);
+
+    GDS_RELEASE(bench_lf);
+    GDS_DESTRUCT(&bench_ht);
+    secs = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    return (double)nthreads * BENCH_OPS / secs / 1e6;
+}
+
+int main(int argc, char **argv)
+{
+    int max = BENCH_MAX_THREADS, n;
+
+    if (1 < argc) {
+        max = atoi(argv[1]);
+        if (max < 1 || BENCH_MAX_THREADS < max) {
+            fprintf(stderr, "usage: %s [1-%d threads]\n", argv[0], BENCH_MAX_THREADS);
+            return 1;
+        }
+    }
+    printf("threads   mutex Mops/s   lock-free Mops/s\n");
+    for (n = 1; n <= max; n *= 2) {
+        printf("%7d   %12.2f   %16.2f\n", n,
+               bench_run(bench_mutex, n), bench_run(bench_lockfree, n));
+    }
+    return 0;
+}
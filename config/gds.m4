@@ -804,6 +804,25 @@ AC_DEFINE_UNQUOTED([GDS_WANT_PRETTY_PRINT_STACKTRACE],
                    [$WANT_PRETTY_PRINT_STACKTRACE],
                    [if want pretty-print stack trace feature])
 
+#
+# Do we want objects that can be shared between threads?
+#
+
+AC_MSG_CHECKING([if want atomic object reference counts])
+AC_ARG_ENABLE([atomic-refcount],
+              [AC_HELP_STRING([--enable-atomic-refcount],
+                              [Use atomic operations for GDS_RETAIN/GDS_RELEASE, so that objects may be shared between threads (default: enabled)])])
+if test "$enable_atomic_refcount" = "no" ; then
+    AC_MSG_RESULT([no])
+    WANT_ATOMIC_REFCOUNT=0
+else
+    AC_MSG_RESULT([yes])
+    WANT_ATOMIC_REFCOUNT=1
+fi
+AC_DEFINE_UNQUOTED([GDS_ENABLE_ATOMIC_REFCOUNT],
+                   [$WANT_ATOMIC_REFCOUNT],
+                   [if want atomic object reference counts])
+
 #
 # Do we want the shared memory datastore usage?
 #
@@ -131,7 +131,10 @@
  * - Storage is composed of key-value pairs, where the value is an arbitrary
  *   sized object. Data provided via the GDS interface will be in the form
  *   of a gds_info_t - data store implementations are free to convert to/from
- *   that form as they choose.
+ *   that form as they choose. The GDS_ entry points, and the store, fetch
+ *   and delete functions of a datastore handle, also have _cinfo variants
+ *   taking the compact gds_cinfo_t form, for callers that already hold
+ *   their directives that way.
  *
  * - Underlying data store implementations are free from any requirement to
  *   support heterogeneity. Users are required to appropriately convert
@@ -179,6 +182,20 @@ extern "C" {
  * process by requesting optional behaviors. These will
  * be defined and extended over time. */
 gds_status_t GDS_Init(gds_info_t directives[], size_t ndirs);
+gds_status_t GDS_Init_cinfo(gds_cinfo_t directives[], size_t ndirs);
+
+/* Intern a key into the process-wide key dictionary, returning
+ * the atom assigned to it. The same key will always return the
+ * same atom for the life of the library. Callers that repeatedly
+ * reference the same keys can resolve them once and pass the atom
+ * in the gds_data_object_t so that implementations can skip
+ * hashing and comparing the key string */
+gds_status_t GDS_Intern_key(const char key[], gds_atom_t *atom);
+
+/* Return the key string for a previously interned atom, or NULL
+ * if the atom is unknown. The returned string is owned by the
+ * library and must NOT be free'd */
+const char* GDS_Atom_key(gds_atom_t atom);
 
 /* Query available datastores and support. Only data stores accessible
  * to the user/group will be included in the query. Directives can include:
@@ -191,6 +208,8 @@ gds_status_t GDS_Init(gds_info_t directives[], size_t ndirs);
  */
 gds_status_t GDS_Query(gds_info_t directives[], size_t ndirs,
                        gds_query_cbfunc_t cbfunc, void *cbdata);
+gds_status_t GDS_Query_cinfo(gds_cinfo_t directives[], size_t ndirs,
+                             gds_query_cbfunc_t cbfunc, void *cbdata);
 
 /* Attach to an existing Datastore by requesting a gds_dstor_handle_t
  * be returned for it. The name of the datastore is purely for the
@@ -206,6 +225,9 @@ gds_status_t GDS_Query(gds_info_t directives[], size_t ndirs,
 gds_status_t GDS_Attach(const char name[],
                         gds_info_t directives[], size_t ndirs,
                         gds_attach_cbfunc_t cbfunc, void *cbdata);
+gds_status_t GDS_Attach_cinfo(const char name[],
+                              gds_cinfo_t directives[], size_t ndirs,
+                              gds_attach_cbfunc_t cbfunc, void *cbdata);
 
 /* The following functions are all associated with a Datastore
  * handle returned in the GDS_Attach cbfunc.
@@ -215,6 +237,23 @@ gds_status_t GDS_Attach(const char name[],
 gds_status_t (*gds_store_fn_t)(gds_data_object_t *object,
                                gds_info_t directives[], size_t ndirs,
                                gds_release_cbfunc_t cbfunc, void *cbdata);
+gds_status_t (*gds_store_cinfo_fn_t)(gds_data_object_t *object,
+                                     gds_cinfo_t directives[], size_t ndirs,
+                                     gds_release_cbfunc_t cbfunc, void *cbdata);
+
+/* Store an array of objects into a Datastore. This is equivalent to
+ * storing each object in turn, except that the directives apply to
+ * (and are parsed once for) the entire array, and the cbfunc is called
+ * only once, when all the objects have been stored. Implementations
+ * are free to amortize lookups across the objects - callers posting
+ * many keys at once (e.g., wireup info) should prefer this over
+ * repeated calls to store */
+gds_status_t (*gds_store_multiple_fn_t)(gds_data_object_t objects[], size_t nobjs,
+                                        gds_info_t directives[], size_t ndirs,
+                                        gds_release_cbfunc_t cbfunc, void *cbdata);
+gds_status_t (*gds_store_multiple_cinfo_fn_t)(gds_data_object_t objects[], size_t nobjs,
+                                              gds_cinfo_t directives[], size_t ndirs,
+                                              gds_release_cbfunc_t cbfunc, void *cbdata);
 
 /* Fetch one or more objects from a Datastore
  *
@@ -237,11 +276,25 @@ gds_status_t (*gds_store_fn_t)(gds_data_object_t *object,
 gds_status_t (*gds_fetch_fn_t)(char **keys,
                                gds_info_t directives[], size_t ndirs,
                                gds_fetch_cbfunc_t cbfunc, void *cbdata);
+gds_status_t (*gds_fetch_cinfo_fn_t)(char **keys,
+                                     gds_cinfo_t directives[], size_t ndirs,
+                                     gds_fetch_cbfunc_t cbfunc, void *cbdata);
+
+/* Fetch one or more objects from a Datastore, letting it allocate
+ * the returned objects itself (e.g., from a gds_region_t) - the
+ * cbfunc is given the function that releases them. Directives are
+ * as for gds_fetch_fn_t */
+gds_status_t (*gds_fetch_region_fn_t)(char **keys,
+                                      gds_info_t directives[], size_t ndirs,
+                                      gds_fetch_region_cbfunc_t cbfunc, void *cbdata);
 
 /* Delete an object from its Datastore */
 gds_status_t (*gds_delete_fn_t)(gds_data_object_t *object,
                                 gds_info_t directives[], size_t ndirs,
                                 gds_release_cbfunc_t cbfunc, void *cbdata);
+gds_status_t (*gds_delete_cinfo_fn_t)(gds_data_object_t *object,
+                                      gds_cinfo_t directives[], size_t ndirs,
+                                      gds_release_cbfunc_t cbfunc, void *cbdata);
 
 /* Query lock status on a Datastore object. This returns information
  * regarding the status of all locks on the object, including estimated
@@ -307,6 +360,7 @@ typedef struct gds_dstor_handle {
     char                    name[GDS_MAX_DSLEN+1];         // user-provided name
     gds_metadata_t          metadata;
     gds_store_fn_t          store;
+    gds_store_multiple_fn_t store_multiple;
     gds_fetch_fn_t          fetch;
     gds_delete_fn_t         delete;
     gds_query_lock_fn_t     query_lock;
@@ -314,6 +368,14 @@ typedef struct gds_dstor_handle {
     gds_unlock_fn_t         unlock;
     gds_notify_fn_t         register_event_hdlr;
     gds_denotify_fn_t       deregister_event_hdlr;
+    /* the compact-directive forms of the data path - NULL if
+     * the plugin only takes gds_info_t directives */
+    gds_store_cinfo_fn_t            store_cinfo;
+    gds_store_multiple_cinfo_fn_t   store_multiple_cinfo;
+    gds_fetch_cinfo_fn_t            fetch_cinfo;
+    gds_delete_cinfo_fn_t           delete_cinfo;
+    /* NULL if the plugin only returns malloc'd fetch results */
+    gds_fetch_region_fn_t           fetch_region;
 } gds_dstor_handle_t;
 
 
@@ -321,11 +383,17 @@ typedef struct gds_dstor_handle {
 gds_status_t GDS_Detach(gds_dstor_handle_t *hdl,
                         gds_info_t directives[], size_t ndirs,
                         gds_release_cbfunc_t cbfunc, void *cbdata);
+gds_status_t GDS_Detach_cinfo(gds_dstor_handle_t *hdl,
+                              gds_cinfo_t directives[], size_t ndirs,
+                              gds_release_cbfunc_t cbfunc, void *cbdata);
 
 /* Destroy a Datastore */
 gds_status_t GDS_Destroy(gds_dstor_handle_t *hdl,
                          gds_info_t directives[], size_t ndirs,
                          gds_release_cbfunc_t cbfunc, void *cbdata);
+gds_status_t GDS_Destroy_cinfo(gds_dstor_handle_t *hdl,
+                               gds_cinfo_t directives[], size_t ndirs,
+                               gds_release_cbfunc_t cbfunc, void *cbdata);
 
 
 #if defined(c_plusplus) || defined(__cplusplus)
@@ -51,6 +51,7 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
+#include <time.h>
 #ifdef HAVE_SYS_TIME_H
 #include <sys/time.h> /* for struct timeval */
 #endif
@@ -341,6 +342,15 @@ gds_status_t gds_value_xfer(gds_value_t *kv, gds_value_t *src);
 
 
 
+/****    GDS KEY ATOM    ****/
+/* keys can be interned into a process-wide dictionary, which
+ * assigns each distinct key string a 32-bit "atom". Operations
+ * that are handed an atom can compare and hash it as an integer
+ * instead of working on the full key string */
+typedef uint32_t gds_atom_t;
+#define GDS_ATOM_INVALID    0
+
+
 /****    GDS INFO STRUCT    ****/
 struct gds_info_t {
     char key[GDS_MAX_KEYLEN+1];    // ensure room for the NULL terminator
@@ -378,14 +388,27 @@ struct gds_info_t {
         }                                       \
     } while (0)
 
+/* copy a key of at most GDS_MAX_KEYLEN characters into a buffer
+ * of GDS_MAX_KEYLEN+1, terminating it - unlike strncpy, this does
+ * not pad the rest of the buffer with zeroes. Returns the length */
+static inline size_t gds_key_copy(char *dst, const char *src)
+{
+    const char *end = (const char*)memchr(src, '\0', GDS_MAX_KEYLEN);
+    size_t len = (NULL == end) ? GDS_MAX_KEYLEN : (size_t)(end - src);
+
+    memcpy(dst, src, len);
+    dst[len] = '\0';
+    return len;
+}
+
 #define GDS_INFO_LOAD(m, k, v, t)                      \
     do {                                                \
-        (void)strncpy((m)->key, (k), GDS_MAX_KEYLEN);  \
+        (void)gds_key_copy((m)->key, (k));             \
         gds_value_load(&((m)->value), (v), (t));       \
     } while (0)
 #define GDS_INFO_XFER(d, s)                                \
     do {                                                    \
-        (void)strncpy((d)->key, (s)->key, GDS_MAX_KEYLEN); \
+        (void)gds_key_copy((d)->key, (s)->key);            \
         (d)->flags = (s)->flags;                            \
         gds_value_xfer(&(d)->value, &(s)->value);          \
     } while(0)
@@ -396,6 +419,198 @@ struct gds_info_t {
     (m)->flags &= ~GDS_INFO_REQD;
 
 
+/****    GDS COMPACT INFO STRUCT    ****/
+/* a gds_info_t has room inline for the longest possible key, which
+ * makes every directive over 500 bytes even though nearly all keys
+ * are short. A gds_cinfo_t keeps keys of up to GDS_CINFO_INLINE_KEYLEN
+ * characters inline, and longer ones out of line - pointing at the
+ * copy held by the key dictionary if the key has been interned,
+ * or else at a copy of its own on the heap. The GDS_ entry points and
+ * the data path of a datastore handle have _cinfo variants taking
+ * these in place of gds_info_t directives, and gds_info_to_cinfo and
+ * gds_cinfo_to_info convert between the two forms */
+#define GDS_CINFO_INLINE_KEYLEN    23
+
+/* where the key of a gds_cinfo_t is kept */
+#define GDS_CINFO_KEY_INLINE   0   // in key.inl
+#define GDS_CINFO_KEY_ATOM     1   // key.ptr is owned by the key dictionary
+#define GDS_CINFO_KEY_HEAP     2   // key.ptr is malloc'd, and ours to free
+
+typedef struct gds_cinfo {
+    union {
+        char inl[GDS_CINFO_INLINE_KEYLEN+1];
+        const char *ptr;
+    } key;
+    uint16_t keylen;               // length of the key
+    uint8_t keyloc;                // one of the GDS_CINFO_KEY_ values
+    gds_atom_t atom;               // the key's atom, or GDS_ATOM_INVALID if not known
+    gds_info_directives_t flags;   // bit-mask of flags
+    gds_value_t value;
+} gds_cinfo_t;
+
+/* set the key of a gds_cinfo_t, releasing any key it had. Keys
+ * longer than GDS_MAX_KEYLEN are truncated, as for gds_info_t */
+gds_status_t gds_cinfo_set_key(gds_cinfo_t *m, const char *key);
+
+/* set the key of a gds_cinfo_t to that of an interned atom -
+ * the key is not copied, and the atom is carried along so that
+ * it need not be looked up again */
+gds_status_t gds_cinfo_set_atom(gds_cinfo_t *m, gds_atom_t atom);
+
+/* convert between the two forms - the values are transferred
+ * as by gds_value_xfer, so the source keeps its own copies */
+gds_status_t gds_info_to_cinfo(gds_cinfo_t dst[], gds_info_t src[], size_t n);
+gds_status_t gds_cinfo_to_info(gds_info_t dst[], gds_cinfo_t src[], size_t n);
+
+#define GDS_CINFO_KEY(m)                                           \
+    (GDS_CINFO_KEY_INLINE == (m)->keyloc ? (m)->key.inl : (m)->key.ptr)
+
+/* utility macros for working with gds_cinfo_t structs */
+#define GDS_CINFO_CREATE(m, n)                                     \
+    do {                                                            \
+        (m) = (gds_cinfo_t*)calloc((n), sizeof(gds_cinfo_t));      \
+    } while (0)
+
+#define GDS_CINFO_CONSTRUCT(m)                 \
+    do {                                        \
+        memset((m), 0, sizeof(gds_cinfo_t));   \
+        (m)->value.type = GDS_UNDEF;           \
+    } while (0)
+
+#define GDS_CINFO_DESTRUCT(m)                                  \
+    do {                                                        \
+        if (GDS_CINFO_KEY_HEAP == (m)->keyloc) {               \
+            free((char*)(m)->key.ptr);                          \
+        }                                                       \
+        (m)->keyloc = GDS_CINFO_KEY_INLINE;                    \
+        (m)->key.inl[0] = '\0';                                 \
+        (m)->keylen = 0;                                        \
+        (m)->atom = GDS_ATOM_INVALID;                           \
+        GDS_VALUE_DESTRUCT(&(m)->value);                       \
+    } while (0)
+
+#define GDS_CINFO_FREE(m, n)                   \
+    do {                                        \
+        size_t _s;                              \
+        if (NULL != (m)) {                      \
+            for (_s=0; _s < (n); _s++) {        \
+                GDS_CINFO_DESTRUCT(&((m)[_s])); \
+            }                                   \
+            free((m));                          \
+            (m) = NULL;                         \
+        }                                       \
+    } while (0)
+
+#define GDS_CINFO_LOAD(m, k, v, t)                     \
+    do {                                                \
+        gds_cinfo_set_key((m), (k));                   \
+        gds_value_load(&((m)->value), (v), (t));       \
+    } while (0)
+#define GDS_CINFO_XFER(d, s)                               \
+    do {                                                    \
+        if (GDS_CINFO_KEY_HEAP == (s)->keyloc) {           \
+            gds_cinfo_set_key((d), (s)->key.ptr);          \
+        } else {                                            \
+            if (GDS_CINFO_KEY_HEAP == (d)->keyloc) {       \
+                free((char*)(d)->key.ptr);                  \
+            }                                               \
+            (d)->key = (s)->key;                            \
+            (d)->keylen = (s)->keylen;                      \
+            (d)->keyloc = (s)->keyloc;                      \
+        }                                                   \
+        (d)->atom = (s)->atom;                              \
+        (d)->flags = (s)->flags;                            \
+        gds_value_xfer(&(d)->value, &(s)->value);          \
+    } while(0)
+
+#define GDS_CINFO_REQUIRED(m)      \
+    (m)->flags |= GDS_INFO_REQD;
+#define GDS_CINFO_OPTIONAL(m)      \
+    (m)->flags &= ~GDS_INFO_REQD;
+
+
+/****    GDS REGION    ****/
+/* info and value arrays - along with every string, byte object
+ * and nested info array they carry - can be carved from a region
+ * rather than being malloc'd piece by piece. Nothing in a region is
+ * freed on its own: the whole region goes at once, in a single call
+ * to gds_region_release. That call is a gds_release_cbfunc_t, so a
+ * region can be handed over through any callback that takes one,
+ * with the region itself as the cbdata.
+ *
+ * Arrays created from a region must NOT be passed to
+ * GDS_VALUE_FREE, GDS_INFO_FREE or their DESTRUCT and RELEASE
+ * counterparts - and values loaded into them must only point at
+ * memory from the same region */
+typedef struct gds_region gds_region_t;
+
+/* create an empty region. Memory is taken from the system in blocks
+ * of chunk_size bytes - pass 0 for the default. Returns NULL if out
+ * of resources */
+gds_region_t* gds_region_create(size_t chunk_size);
+
+/* allocate memory from a region - returns NULL if out of resources */
+void* gds_region_alloc(gds_region_t *region, size_t size);
+
+/* release a region and everything allocated from it. The status
+ * is ignored - it is only there to make this a gds_release_cbfunc_t */
+void gds_region_release(gds_status_t status, void *region);
+
+/* the equivalents of gds_value_load and gds_value_xfer, except
+ * that any payload is copied into the region */
+gds_status_t gds_value_load_in(gds_value_t *v, void *data, gds_data_type_t type,
+                               gds_region_t *region);
+gds_status_t gds_value_xfer_in(gds_value_t *kv, gds_value_t *src,
+                               gds_region_t *region);
+
+/* allocate and initialize a specified number of value structs
+ * from a region - (m) is NULL if the region is out of resources */
+#define GDS_VALUE_CREATE_IN(m, n, r)                                   \
+    do {                                                                \
+        int _ii;                                                        \
+        (m) = (gds_value_t*)gds_region_alloc((r), (n) * sizeof(gds_value_t)); \
+        if (NULL != (m)) {                                              \
+            memset((m), 0, (n) * sizeof(gds_value_t));                 \
+            for (_ii=0; _ii < (int)(n); _ii++) {                        \
+                (m)[_ii].type = GDS_UNDEF;                             \
+            }                                                           \
+        }                                                               \
+    } while (0)
+
+/* allocate and initialize a specified number of info structs
+ * from a region - (m) is NULL if the region is out of resources */
+#define GDS_INFO_CREATE_IN(m, n, r)                                    \
+    do {                                                                \
+        (m) = (gds_info_t*)gds_region_alloc((r), (n) * sizeof(gds_info_t)); \
+        if (NULL != (m)) {                                              \
+            memset((m), 0, (n) * sizeof(gds_info_t));                  \
+        }                                                               \
+    } while (0)
+
+/* load or transfer an info struct whose payload goes in a region,
+ * returning the status of copying it there */
+static inline gds_status_t gds_info_load_in(gds_info_t *m, const char *key,
+                                            void *data, gds_data_type_t type,
+                                            gds_region_t *region)
+{
+    (void)gds_key_copy(m->key, key);
+    return gds_value_load_in(&m->value, data, type, region);
+}
+
+static inline gds_status_t gds_info_xfer_in(gds_info_t *dst, gds_info_t *src,
+                                            gds_region_t *region)
+{
+    (void)gds_key_copy(dst->key, src->key);
+    dst->flags = src->flags;
+    return gds_value_xfer_in(&dst->value, &src->value, region);
+}
+
+#define GDS_INFO_LOAD_IN(m, k, v, t, r)                        \
+    gds_info_load_in((m), (k), (v), (t), (r))
+#define GDS_INFO_XFER_IN(d, s, r)                              \
+    gds_info_xfer_in((d), (s), (r))
+
+
 /****    GDS QUERY RETURN STRUCT    ****/
 typedef struct gds_dstor_info {
     char name[GDS_MAX_DSLEN+1];  // ensure room for the NULL terminator
@@ -464,15 +679,15 @@ typedef struct gds_stamp {
     do {                                                        \
         time_t _t;                                              \
         if (NULL == (r)) {                                      \
-            (r) = (gds_stamp_t*)malloc(sizeof(gds_stamp_t));    \
+            (r) = (gds_stamp_t*)calloc(1, sizeof(gds_stamp_t)); \
         }                                                       \
         (r)->uid = (u);                                         \
         (r)->gid = (g);                                         \
         if (NULL != (r)->time) {                                \
             free((r)->time);                                    \
         }                                                       \
-        _t = time();                                            \
-        (r)->time = strdup(ctime(_t));                          \
+        _t = time(NULL);                                        \
+        (r)->time = strdup(ctime(&_t));                         \
     } while(0)
 
 
@@ -502,6 +717,7 @@ typedef struct gds_metadata {
 typedef gds_data_object {
     gds_metadata_t metadata;
     char key[GDS_MAX_KEYLEN+1]; // leave room for terminating NULL
+    gds_atom_t atom;            // optional pre-interned key, GDS_ATOM_INVALID if not used
     gds_value_t value;
 } gds_data_object_t;
 
@@ -535,6 +751,16 @@ typedef void (*gds_fetch_cbfunc_t)(gds_status_t status,
                                    gds_data_object_t objects[], size_t nobjs,
                                    void fetch_cbdata);
 
+/* define a callback function for returning found data objects that
+ * the datastore allocated itself - typically carved from a
+ * gds_region_t, with the region as the relcbdata. The objects must
+ * be released by calling the release_cbfunc when the fetch_cbfunc
+ * is done with them. */
+typedef void (*gds_fetch_region_cbfunc_t)(gds_status_t status,
+                                          gds_data_object_t objects[], size_t nobjs,
+                                          gds_release_cbfunc_t cbfunc, void *relcbdata,
+                                          void fetch_cbdata);
+
 /* define a callback function for returning info from a lock
  * query request.
  */
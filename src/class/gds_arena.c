@@ -0,0 +1,324 @@
+/* -*- Mode: C; c-basic-offset:4 ; -*- */
+/*
+ * Copyright (c) 2016      Intel, Inc. All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+#include <src/include/gds_config.h>
+
+#include <stddef.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "gds_common.h"
+#include "src/class/gds_arena.h"
+
+/* all allocations are rounded to this alignment */
+#define GDS_ARENA_ALIGN     16
+#define GDS_ARENA_ROUND(s)  (((s) + GDS_ARENA_ALIGN - 1) & ~((size_t)GDS_ARENA_ALIGN - 1))
+
+struct gds_arena_chunk_t {
+    gds_arena_chunk_t *next;
+    size_t size;        /**< usable bytes in this chunk */
+    size_t used;        /**< bytes handed out from this chunk */
+    /* keep the payload aligned */
+    union {
+        char bytes[1];
+        long double ld;
+        void *ptr;
+    } data;
+};
+
+static void gds_arena_construct(gds_arena_t *arena);
+static void gds_arena_destruct(gds_arena_t *arena);
+
+GDS_CLASS_INSTANCE(gds_arena_t, gds_object_t,
+                   gds_arena_construct,
+                   gds_arena_destruct);
+
+static void gds_arena_construct(gds_arena_t *arena)
+{
+    arena->ar_chunk_size = GDS_ARENA_CHUNK_SIZE;
+    arena->ar_chunks = NULL;
+    arena->ar_reserved = 0;
+    arena->ar_used = 0;
+}
+
+static void gds_arena_destruct(gds_arena_t *arena)
+{
+    gds_arena_reset(arena);
+}
+
+int gds_arena_init(gds_arena_t *arena, size_t chunk_size)
+{
+    if (0 == chunk_size) {
+        return GDS_ERR_BAD_PARAM;
+    }
+    arena->ar_chunk_size = GDS_ARENA_ROUND(chunk_size);
+    return GDS_SUCCESS;
+}
+
+static gds_arena_chunk_t* gds_arena_new_chunk(gds_arena_t *arena, size_t size)
+{
+    gds_arena_chunk_t *chunk;
+
+    chunk = (gds_arena_chunk_t*)malloc(offsetof(gds_arena_chunk_t, data) + size);
+    if (NULL == chunk) {
+        return NULL;
+    }
+    chunk->size = size;
+    chunk->used = 0;
+    arena->ar_reserved += size;
+    return chunk;
+}
+
+void* gds_arena_alloc(gds_arena_t *arena, size_t size)
+{
+    gds_arena_chunk_t *chunk = arena->ar_chunks;
+    void *ptr;
+
+    size = GDS_ARENA_ROUND(size);
+    if (0 == size) {
+        size = GDS_ARENA_ALIGN;
+    }
+
+    if (size > arena->ar_chunk_size / 4) {
+        /* big request - give it a chunk of its own and put it
+         * behind the current chunk so we keep filling that one */
+        if (NULL == (chunk = gds_arena_new_chunk(arena, size))) {
+            return NULL;
+        }
+        chunk->used = size;
+        if (NULL == arena->ar_chunks) {
+            chunk->next = NULL;
+            arena->ar_chunks = chunk;
+        } else {
+            chunk->next = arena->ar_chunks->next;
+            arena->ar_chunks->next = chunk;
+        }
+        arena->ar_used += size;
+        return chunk->data.bytes;
+    }
+
+    if (NULL == chunk || chunk->size - chunk->used < size) {
+        if (NULL == (chunk = gds_arena_new_chunk(arena, arena->ar_chunk_size))) {
+            return NULL;
+        }
+        chunk->next = arena->ar_chunks;
+        arena->ar_chunks = chunk;
+    }
+    ptr = chunk->data.bytes + chunk->used;
+    chunk->used += size;
+    arena->ar_used += size;
+    return ptr;
+}
+
+char* gds_arena_strdup(gds_arena_t *arena, const char *str)
+{
+    size_t len = strlen(str) + 1;
+    char *ptr;
+
+    if (NULL != (ptr = (char*)gds_arena_alloc(arena, len))) {
+        memcpy(ptr, str, len);
+    }
+    return ptr;
+}
+
+void gds_arena_reset(gds_arena_t *arena)
+{
+    gds_arena_chunk_t *chunk;
+
+    while (NULL != (chunk = arena->ar_chunks)) {
+        arena->ar_chunks = chunk->next;
+        free(chunk);
+    }
+    arena->ar_reserved = 0;
+    arena->ar_used = 0;
+}
+
+void gds_arena_swap(gds_arena_t *a, gds_arena_t *b)
+{
+    gds_arena_chunk_t *chunks;
+    size_t tmp;
+
+    chunks = a->ar_chunks;
+    a->ar_chunks = b->ar_chunks;
+    b->ar_chunks = chunks;
+    tmp = a->ar_chunk_size;
+    a->ar_chunk_size = b->ar_chunk_size;
+    b->ar_chunk_size = tmp;
+    tmp = a->ar_reserved;
+    a->ar_reserved = b->ar_reserved;
+    b->ar_reserved = tmp;
+    tmp = a->ar_used;
+    a->ar_used = b->ar_used;
+    b->ar_used = tmp;
+}
+
+
+/*
+ * Regions - the public face of an arena, through which info and
+ * value arrays and their payloads are allocated together
+ */
+
+struct gds_region {
+    gds_arena_t rg_arena;
+};
+
+gds_region_t* gds_region_create(size_t chunk_size)
+{
+    gds_region_t *region;
+
+    if (NULL == (region = (gds_region_t*)malloc(sizeof(gds_region_t)))) {
+        return NULL;
+    }
+    GDS_CONSTRUCT(&region->rg_arena, gds_arena_t);
+    if (0 < chunk_size) {
+        gds_arena_init(&region->rg_arena, chunk_size);
+    }
+    return region;
+}
+
+void* gds_region_alloc(gds_region_t *region, size_t size)
+{
+    return gds_arena_alloc(&region->rg_arena, size);
+}
+
+void gds_region_release(gds_status_t status, void *region)
+{
+    gds_region_t *rg = (gds_region_t*)region;
+
+    if (NULL != rg) {
+        GDS_DESTRUCT(&rg->rg_arena);
+        free(rg);
+    }
+}
+
+/* size of the data of a value of the given type, for the types
+ * whose data is held entirely within the gds_value_t */
+static size_t gds_region_fixed_size(gds_data_type_t type)
+{
+    gds_value_t *v;
+
+    switch (type) {
+    case GDS_BOOL:      return sizeof(v->data.flag);
+    case GDS_BYTE:      return sizeof(v->data.byte);
+    case GDS_SIZE:      return sizeof(v->data.size);
+    case GDS_PID:       return sizeof(v->data.pid);
+    case GDS_INT:       return sizeof(v->data.integer);
+    case GDS_INT8:      return sizeof(v->data.int8);
+    case GDS_INT16:     return sizeof(v->data.int16);
+    case GDS_INT32:     return sizeof(v->data.int32);
+    case GDS_INT64:     return sizeof(v->data.int64);
+    case GDS_UINT:      return sizeof(v->data.uint);
+    case GDS_UINT8:     return sizeof(v->data.uint8);
+    case GDS_UINT16:    return sizeof(v->data.uint16);
+    case GDS_UINT32:    return sizeof(v->data.uint32);
+    case GDS_UINT64:    return sizeof(v->data.uint64);
+    case GDS_FLOAT:     return sizeof(v->data.fval);
+    case GDS_DOUBLE:    return sizeof(v->data.dval);
+    case GDS_TIMEVAL:   return sizeof(v->data.tv);
+    case GDS_TIME:      return sizeof(v->data.time);
+    case GDS_STATUS:    return sizeof(v->data.status);
+    case GDS_PROC:      return sizeof(v->data.proc);
+    default:            return 0;
+    }
+}
+
+gds_status_t gds_value_xfer_in(gds_value_t *kv, gds_value_t *src,
+                               gds_region_t *region)
+{
+    gds_info_t *p;
+    size_t n;
+    gds_status_t rc;
+
+    kv->type = src->type;
+    switch (src->type) {
+    case GDS_STRING:
+        kv->data.string = NULL;
+        if (NULL != src->data.string &&
+            NULL == (kv->data.string = gds_arena_strdup(&region->rg_arena,
+                                                        src->data.string))) {
+            return GDS_ERR_OUT_OF_RESOURCE;
+        }
+        break;
+    case GDS_BYTE_OBJECT:
+        kv->data.bo.bytes = NULL;
+        kv->data.bo.size = 0;
+        if (NULL != src->data.bo.bytes && 0 < src->data.bo.size) {
+            if (NULL == (kv->data.bo.bytes = (char*)gds_arena_alloc(&region->rg_arena,
+                                                                    src->data.bo.size))) {
+                return GDS_ERR_OUT_OF_RESOURCE;
+            }
+            memcpy(kv->data.bo.bytes, src->data.bo.bytes, src->data.bo.size);
+            kv->data.bo.size = src->data.bo.size;
+        }
+        break;
+    case GDS_INFO_ARRAY:
+        kv->data.array.array = NULL;
+        kv->data.array.size = 0;
+        if (NULL != src->data.array.array && 0 < src->data.array.size) {
+            GDS_INFO_CREATE_IN(p, src->data.array.size, region);
+            if (NULL == p) {
+                return GDS_ERR_OUT_OF_RESOURCE;
+            }
+            for (n=0; n < src->data.array.size; n++) {
+                memcpy(p[n].key, src->data.array.array[n].key, sizeof(p[n].key));
+                p[n].flags = src->data.array.array[n].flags;
+                if (GDS_SUCCESS != (rc = gds_value_xfer_in(&p[n].value,
+                                                           &src->data.array.array[n].value,
+                                                           region))) {
+                    return rc;
+                }
+            }
+            kv->data.array.array = p;
+            kv->data.array.size = src->data.array.size;
+        }
+        break;
+    default:
+        /* everything else lives in the struct itself */
+        memcpy(&kv->data, &src->data, sizeof(kv->data));
+        break;
+    }
+    return GDS_SUCCESS;
+}
+
+gds_status_t gds_value_load_in(gds_value_t *v, void *data, gds_data_type_t type,
+                               gds_region_t *region)
+{
+    gds_value_t src;
+    size_t size;
+
+    memset(&src, 0, sizeof(src));
+    src.type = type;
+    switch (type) {
+    case GDS_STRING:
+        src.data.string = (char*)data;
+        break;
+    case GDS_BYTE_OBJECT:
+        if (NULL != data) {
+            src.data.bo = *(gds_byte_object_t*)data;
+        }
+        break;
+    case GDS_INFO_ARRAY:
+        if (NULL != data) {
+            src.data.array = *(gds_info_array_t*)data;
+        }
+        break;
+    case GDS_POINTER:
+        src.data.ptr = data;
+        break;
+    default:
+        if (0 == (size = gds_region_fixed_size(type))) {
+            v->type = GDS_UNDEF;
+            return GDS_ERR_NOT_SUPPORTED;
+        }
+        memcpy(&src.data, data, size);
+        break;
+    }
+    return gds_value_xfer_in(v, &src, region);
+}
@@ -0,0 +1,92 @@
+/* -*- Mode: C; c-basic-offset:4 ; -*- */
+/*
+ * Copyright (c) 2016      Intel, Inc. All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+/** @file
+ *
+ * Bump-pointer arena. Memory is carved sequentially from large
+ * chunks and is never returned individually - everything allocated
+ * from an arena is released at once by gds_arena_reset or when the
+ * arena is destructed. This suits data whose lifetime is bounded
+ * by some owning container (e.g., all the payloads stored for a
+ * single process).
+ *
+ * Callers outside the library see an arena as a gds_region_t (see
+ * gds_common.h), from which info and value arrays are carved.
+ */
+
+#ifndef GDS_ARENA_H
+#define GDS_ARENA_H
+
+#include <src/include/gds_config.h>
+
+#include "src/class/gds_object.h"
+
+BEGIN_C_DECLS
+
+/* default size of each chunk */
+#define GDS_ARENA_CHUNK_SIZE    4096
+
+typedef struct gds_arena_chunk_t gds_arena_chunk_t;
+
+struct gds_arena_t {
+    gds_object_t super;
+    size_t ar_chunk_size;           /**< size of regular chunks */
+    gds_arena_chunk_t *ar_chunks;   /**< chunk list, current chunk first */
+    size_t ar_reserved;             /**< total bytes held in chunks */
+    size_t ar_used;                 /**< total bytes handed out */
+};
+typedef struct gds_arena_t gds_arena_t;
+GDS_CLASS_DECLARATION(gds_arena_t);
+
+/**
+ * Set the size of the chunks the arena will allocate. Must
+ * be called before the first allocation - otherwise
+ * GDS_ARENA_CHUNK_SIZE is used.
+ */
+int gds_arena_init(gds_arena_t *arena, size_t chunk_size);
+
+/**
+ * Allocate memory from the arena. The returned memory is
+ * aligned for any basic type and is not initialized.
+ * Requests larger than a quarter of the chunk size are
+ * given a dedicated chunk so they don't waste the
+ * remainder of the current one.
+ *
+ * @return Pointer to the memory, or NULL if out of resources
+ */
+void* gds_arena_alloc(gds_arena_t *arena, size_t size);
+
+/**
+ * Duplicate a string into the arena
+ */
+char* gds_arena_strdup(gds_arena_t *arena, const char *str);
+
+/**
+ * Release everything allocated from the arena
+ */
+void gds_arena_reset(gds_arena_t *arena);
+
+/**
+ * Exchange the contents of two arenas. Useful for compacting:
+ * copy the live data into a fresh arena, swap, and then
+ * destruct the fresh one to release the stale memory.
+ */
+void gds_arena_swap(gds_arena_t *a, gds_arena_t *b);
+
+/**
+ * Total bytes handed out since the last reset
+ */
+static inline size_t gds_arena_get_used(gds_arena_t *arena)
+{
+    return arena->ar_used;
+}
+
+END_C_DECLS
+
+#endif /* GDS_ARENA_H */
@@ -0,0 +1,386 @@
+/* -*- Mode: C; c-basic-offset:4 ; -*- */
+/*
+ * Copyright (c) 2016      Intel, Inc. All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+#include <src/include/gds_config.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "gds_common.h"
+#include "src/class/gds_epoch.h"
+
+/* a reader's state is the epoch it entered in, shifted up by one,
+ * with the low bit set while it is inside a section. The fields
+ * other threads look at get a cache line to themselves so readers
+ * don't disturb each other - the rest is only touched by the thread
+ * holding the record */
+struct gds_epoch_record_t {
+    uint64_t er_state;
+    gds_epoch_record_t *er_next;
+    bool er_in_use;
+    char er_pad[64 - sizeof(uint64_t) - sizeof(void*) - sizeof(bool)];
+    gds_epoch_bag_t er_bag;             /* what this thread has retired */
+    gds_epoch_limbo_t *er_spares;       /* entries free for gds_epoch_retire */
+    size_t er_nspares;
+};
+
+static void gds_epoch_construct(gds_epoch_t *ep);
+static void gds_epoch_destruct(gds_epoch_t *ep);
+
+GDS_CLASS_INSTANCE(gds_epoch_t, gds_object_t,
+                   gds_epoch_construct,
+                   gds_epoch_destruct);
+
+/* hand the record of an exiting thread on to the next new one -
+ * whatever it retired is released by the next thread that reclaims
+ * anything, if the new one doesn't get to it first */
+static void gds_epoch_thread_exit(void *ptr)
+{
+    gds_epoch_record_t *rec = (gds_epoch_record_t*)ptr;
+
+    __atomic_store_n(&rec->er_in_use, false, __ATOMIC_RELEASE);
+}
+
+static void gds_epoch_construct(gds_epoch_t *ep)
+{
+    pthread_mutex_init(&ep->ep_lock, NULL);
+    ep->ep_key_valid = (0 == pthread_key_create(&ep->ep_key, gds_epoch_thread_exit));
+    ep->ep_global = 0;
+    ep->ep_records = NULL;
+    memset(&ep->ep_orphans, 0, sizeof(ep->ep_orphans));
+}
+
+/* run the releases, and hand back the spare entries among the
+ * items - an entry supplied by the caller may be gone once its
+ * item has been released, so look at it first */
+static gds_epoch_limbo_t* gds_epoch_release(gds_epoch_limbo_t *item)
+{
+    gds_epoch_limbo_t *next, *spares = NULL;
+    bool spare;
+
+    for (; NULL != item; item = next) {
+        next = item->el_next;
+        spare = item->el_spare;
+        item->el_fn(item->el_ctx, item->el_ptr);
+        if (spare) {
+            item->el_next = spares;
+            spares = item;
+        }
+    }
+    return spares;
+}
+
+static void gds_epoch_free_spares(gds_epoch_limbo_t *item)
+{
+    gds_epoch_limbo_t *next;
+
+    for (; NULL != item; item = next) {
+        next = item->el_next;
+        free(item);
+    }
+}
+
+/* put a list of items in front of another, returning its length */
+static size_t gds_epoch_splice(gds_epoch_limbo_t **head, gds_epoch_limbo_t *items)
+{
+    gds_epoch_limbo_t *tail;
+    size_t n = 1;
+
+    if (NULL == items) {
+        return 0;
+    }
+    for (tail = items; NULL != tail->el_next; tail = tail->el_next) {
+        n++;
+    }
+    tail->el_next = *head;
+    *head = items;
+    return n;
+}
+
+/* queue an item retired in the given epoch. A list last used three
+ * or more epochs ago is safe by now, so set it aside to be released
+ * rather than mixing the epochs */
+static void gds_epoch_bag_add(gds_epoch_bag_t *bag, gds_epoch_limbo_t *item,
+                              uint64_t epoch)
+{
+    int n = epoch % 3;
+
+    if (bag->eb_epoch[n] != epoch) {
+        gds_epoch_splice(&bag->eb_ready, bag->eb_items[n]);
+        bag->eb_items[n] = NULL;
+        bag->eb_epoch[n] = epoch;
+    }
+    item->el_next = bag->eb_items[n];
+    bag->eb_items[n] = item;
+    __atomic_fetch_add(&bag->eb_pending, 1, __ATOMIC_RELAXED);
+}
+
+/* take every item that no reader can reach once the epoch is global */
+static gds_epoch_limbo_t* gds_epoch_bag_take(gds_epoch_bag_t *bag, uint64_t global)
+{
+    gds_epoch_limbo_t *items = NULL;
+    size_t count = 0;
+    int n;
+
+    for (n=0; n < 3; n++) {
+        if (NULL != bag->eb_items[n] && bag->eb_epoch[n] + 2 <= global) {
+            count += gds_epoch_splice(&items, bag->eb_items[n]);
+            bag->eb_items[n] = NULL;
+        }
+    }
+    count += gds_epoch_splice(&items, bag->eb_ready);
+    bag->eb_ready = NULL;
+    __atomic_fetch_sub(&bag->eb_pending, count, __ATOMIC_RELAXED);
+    return items;
+}
+
+static size_t gds_epoch_bag_pending(gds_epoch_bag_t *bag)
+{
+    return __atomic_load_n(&bag->eb_pending, __ATOMIC_RELAXED);
+}
+
+/* no readers can be left, so everything goes */
+static void gds_epoch_bag_destruct(gds_epoch_bag_t *bag)
+{
+    gds_epoch_free_spares(gds_epoch_release(gds_epoch_bag_take(bag, UINT64_MAX)));
+    memset(bag->eb_epoch, 0, sizeof(bag->eb_epoch));
+}
+
+static void gds_epoch_destruct(gds_epoch_t *ep)
+{
+    gds_epoch_record_t *rec;
+
+    gds_epoch_bag_destruct(&ep->ep_orphans);
+    for (rec = ep->ep_records; NULL != rec; rec = rec->er_next) {
+        gds_epoch_bag_destruct(&rec->er_bag);
+    }
+    if (ep->ep_key_valid) {
+        pthread_key_delete(ep->ep_key);
+        ep->ep_key_valid = false;
+    }
+    while (NULL != (rec = ep->ep_records)) {
+        ep->ep_records = rec->er_next;
+        gds_epoch_free_spares(rec->er_spares);
+        free(rec);
+    }
+    pthread_mutex_destroy(&ep->ep_lock);
+}
+
+/* claim a record that no thread is holding */
+static inline bool gds_epoch_claim(gds_epoch_record_t *rec)
+{
+    bool expected = false;
+
+    return __atomic_compare_exchange_n(&rec->er_in_use, &expected, true, false,
+                                       __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+}
+
+/* find a record for the calling thread, recycling one left
+ * behind by an exited thread if we can */
+static gds_epoch_record_t* gds_epoch_register(gds_epoch_t *ep)
+{
+    gds_epoch_record_t *rec;
+
+    if (!ep->ep_key_valid) {
+        return NULL;
+    }
+    pthread_mutex_lock(&ep->ep_lock);
+    for (rec = ep->ep_records; NULL != rec; rec = rec->er_next) {
+        if (gds_epoch_claim(rec)) {
+            break;
+        }
+    }
+    if (NULL == rec) {
+        if (NULL == (rec = (gds_epoch_record_t*)calloc(1, sizeof(gds_epoch_record_t)))) {
+            pthread_mutex_unlock(&ep->ep_lock);
+            return NULL;
+        }
+        rec->er_in_use = true;
+        rec->er_next = ep->ep_records;
+        /* reclaimers walk the records without the lock */
+        __atomic_store_n(&ep->ep_records, rec, __ATOMIC_RELEASE);
+    }
+    __atomic_store_n(&rec->er_state, 0, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&ep->ep_lock);
+
+    if (0 != pthread_setspecific(ep->ep_key, rec)) {
+        __atomic_store_n(&rec->er_in_use, false, __ATOMIC_RELEASE);
+        return NULL;
+    }
+    return rec;
+}
+
+static inline gds_epoch_record_t* gds_epoch_self(gds_epoch_t *ep)
+{
+    gds_epoch_record_t *rec;
+
+    rec = (gds_epoch_record_t*)pthread_getspecific(ep->ep_key);
+    if (NULL == rec) {
+        rec = gds_epoch_register(ep);
+    }
+    return rec;
+}
+
+int gds_epoch_enter(gds_epoch_t *ep)
+{
+    gds_epoch_record_t *rec;
+    uint64_t epoch;
+
+    if (NULL == (rec = gds_epoch_self(ep))) {
+        return GDS_ERR_OUT_OF_RESOURCE;
+    }
+    /* announce ourselves before we look at anything - the fence
+     * ensures that either a reclaimer sees us, or we see the
+     * structure as it was after the writer unlinked its items */
+    epoch = __atomic_load_n(&ep->ep_global, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&rec->er_state, (epoch << 1) | 1, __ATOMIC_SEQ_CST);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    return GDS_SUCCESS;
+}
+
+void gds_epoch_exit(gds_epoch_t *ep)
+{
+    gds_epoch_record_t *rec;
+
+    rec = (gds_epoch_record_t*)pthread_getspecific(ep->ep_key);
+    if (NULL != rec) {
+        __atomic_store_n(&rec->er_state, 0, __ATOMIC_RELEASE);
+    }
+}
+
+/* move to the next epoch if every reader in a section has seen the
+ * current one, returning the epoch we are in afterwards */
+static uint64_t gds_epoch_advance(gds_epoch_t *ep)
+{
+    gds_epoch_record_t *rec;
+    uint64_t global, state;
+
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    global = __atomic_load_n(&ep->ep_global, __ATOMIC_SEQ_CST);
+    for (rec = __atomic_load_n(&ep->ep_records, __ATOMIC_ACQUIRE);
+         NULL != rec; rec = rec->er_next) {
+        state = __atomic_load_n(&rec->er_state, __ATOMIC_ACQUIRE);
+        if ((state & 1) && (state >> 1) != global) {
+            return global;
+        }
+    }
+    /* if another thread got there first, we are still in its epoch */
+    if (__atomic_compare_exchange_n(&ep->ep_global, &global, global + 1, false,
+                                    __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)) {
+        global++;
+    }
+    return global;
+}
+
+static void gds_epoch_queue(gds_epoch_t *ep, gds_epoch_limbo_t *item,
+                            gds_epoch_release_fn_t fn, void *ctx, void *ptr)
+{
+    gds_epoch_record_t *rec;
+    uint64_t epoch;
+
+    item->el_fn = fn;
+    item->el_ctx = ctx;
+    item->el_ptr = ptr;
+    /* the item was unlinked before this, so any reader that can
+     * still find it entered no later than the epoch we see here */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    epoch = __atomic_load_n(&ep->ep_global, __ATOMIC_SEQ_CST);
+    if (NULL != (rec = gds_epoch_self(ep))) {
+        gds_epoch_bag_add(&rec->er_bag, item, epoch);
+    } else {
+        pthread_mutex_lock(&ep->ep_lock);
+        gds_epoch_bag_add(&ep->ep_orphans, item, epoch);
+        pthread_mutex_unlock(&ep->ep_lock);
+    }
+}
+
+int gds_epoch_retire(gds_epoch_t *ep, gds_epoch_release_fn_t fn,
+                     void *ctx, void *ptr)
+{
+    gds_epoch_record_t *rec;
+    gds_epoch_limbo_t *item;
+
+    rec = gds_epoch_self(ep);
+    if (NULL != rec && NULL != (item = rec->er_spares)) {
+        rec->er_spares = item->el_next;
+        rec->er_nspares--;
+    } else {
+        if (NULL == (item = (gds_epoch_limbo_t*)malloc(sizeof(gds_epoch_limbo_t)))) {
+            return GDS_ERR_OUT_OF_RESOURCE;
+        }
+        item->el_spare = true;
+    }
+    gds_epoch_queue(ep, item, fn, ctx, ptr);
+    return GDS_SUCCESS;
+}
+
+void gds_epoch_retire_entry(gds_epoch_t *ep, gds_epoch_limbo_t *item,
+                            gds_epoch_release_fn_t fn, void *ctx, void *ptr)
+{
+    item->el_spare = false;
+    gds_epoch_queue(ep, item, fn, ctx, ptr);
+}
+
+size_t gds_epoch_get_pending(gds_epoch_t *ep)
+{
+    gds_epoch_record_t *rec;
+    size_t n;
+
+    n = gds_epoch_bag_pending(&ep->ep_orphans);
+    rec = (gds_epoch_record_t*)pthread_getspecific(ep->ep_key);
+    if (NULL != rec) {
+        n += gds_epoch_bag_pending(&rec->er_bag);
+    }
+    return n;
+}
+
+void gds_epoch_reclaim(gds_epoch_t *ep)
+{
+    gds_epoch_record_t *rec, *self;
+    gds_epoch_limbo_t *items = NULL, *next;
+    uint64_t global;
+
+    if (0 == gds_epoch_get_pending(ep)) {
+        return;
+    }
+    global = gds_epoch_advance(ep);
+    self = (gds_epoch_record_t*)pthread_getspecific(ep->ep_key);
+    if (NULL != self) {
+        items = gds_epoch_bag_take(&self->er_bag, global);
+    }
+    if (0 < gds_epoch_bag_pending(&ep->ep_orphans)) {
+        pthread_mutex_lock(&ep->ep_lock);
+        gds_epoch_splice(&items, gds_epoch_bag_take(&ep->ep_orphans, global));
+        pthread_mutex_unlock(&ep->ep_lock);
+    }
+    /* take over what exited threads left behind */
+    for (rec = __atomic_load_n(&ep->ep_records, __ATOMIC_ACQUIRE);
+         NULL != rec; rec = rec->er_next) {
+        if (rec != self && 0 < gds_epoch_bag_pending(&rec->er_bag) &&
+            !__atomic_load_n(&rec->er_in_use, __ATOMIC_RELAXED) &&
+            gds_epoch_claim(rec)) {
+            gds_epoch_splice(&items, gds_epoch_bag_take(&rec->er_bag, global));
+            __atomic_store_n(&rec->er_in_use, false, __ATOMIC_RELEASE);
+        }
+    }
+
+    if (NULL == (items = gds_epoch_release(items))) {
+        return;
+    }
+    /* keep the entries for the next retires, up to a point */
+    while (NULL != self && NULL != items && self->er_nspares < GDS_EPOCH_MAX_SPARES) {
+        next = items->el_next;
+        items->el_next = self->er_spares;
+        self->er_spares = items;
+        self->er_nspares++;
+        items = next;
+    }
+    gds_epoch_free_spares(items);
+}
@@ -0,0 +1,153 @@
+/* -*- Mode: C; c-basic-offset:4 ; -*- */
+/*
+ * Copyright (c) 2016      Intel, Inc. All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+/** @file
+ *
+ * Epoch-based reclamation. Lets readers traverse a shared structure
+ * without taking any lock, while writers defer releasing anything
+ * they unlink until no reader can still be looking at it.
+ *
+ * Readers bracket each traversal with gds_epoch_enter and
+ * gds_epoch_exit. A writer first unlinks an item so that no new
+ * reader can find it, and then hands it to gds_epoch_retire. The
+ * item is released (by calling the supplied function) once the
+ * global epoch has advanced twice - which it only does when every
+ * reader inside an epoch has caught up with it - so any reader that
+ * might have found the item has left by then.
+ *
+ * Each retired item needs a limbo entry to queue it on. Items that
+ * are retired often should carry one of their own and be handed to
+ * gds_epoch_retire_entry, which never allocates and cannot fail;
+ * gds_epoch_retire takes an entry from a list of spares kept by the
+ * calling thread, and only allocates when that runs dry.
+ *
+ * Retiring only queues the item - releases are run by
+ * gds_epoch_reclaim, in the calling thread and without any of the
+ * domain's locks held, so writers should call it from time to time
+ * once they have dropped their own locks.
+ *
+ * Each thread is given a record of its own the first time it enters
+ * or retires, so entering and leaving never write to shared memory.
+ * The record also holds the items the thread has retired, so neither
+ * retiring nor reclaiming takes a lock - a thread only releases its
+ * own items, plus any left behind by threads that have exited.
+ * Sections cannot be nested.
+ */
+
+#ifndef GDS_EPOCH_H
+#define GDS_EPOCH_H
+
+#include <src/include/gds_config.h>
+
+#ifdef HAVE_STDINT_H
+#include <stdint.h>
+#endif
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "src/class/gds_object.h"
+
+BEGIN_C_DECLS
+
+/* releases a retired item */
+typedef void (*gds_epoch_release_fn_t)(void *ctx, void *ptr);
+
+typedef struct gds_epoch_record_t gds_epoch_record_t;
+typedef struct gds_epoch_limbo_t gds_epoch_limbo_t;
+
+/* queues a retired item - its contents are private to the domain */
+struct gds_epoch_limbo_t {
+    gds_epoch_limbo_t *el_next;
+    gds_epoch_release_fn_t el_fn;
+    void *el_ctx;
+    void *el_ptr;
+    bool el_spare;                      /* one of the domain's own */
+};
+
+/* most spare entries kept for reuse by each thread */
+#define GDS_EPOCH_MAX_SPARES    1024
+
+/* retired items waiting for the epoch to move on - private to the domain */
+typedef struct {
+    gds_epoch_limbo_t *eb_items[3];     /**< items retired in each of the last three epochs */
+    uint64_t eb_epoch[3];               /**< the epoch each list was retired in */
+    gds_epoch_limbo_t *eb_ready;        /**< items that are safe to release */
+    size_t eb_pending;                  /**< number of items not yet released */
+} gds_epoch_bag_t;
+
+struct gds_epoch_t {
+    gds_object_t super;
+    pthread_mutex_t ep_lock;            /**< serializes adding records, and protects ep_orphans */
+    pthread_key_t ep_key;               /**< the calling thread's record */
+    bool ep_key_valid;
+    uint64_t ep_global;                 /**< the current epoch */
+    gds_epoch_record_t *ep_records;     /**< every record ever handed out */
+    gds_epoch_bag_t ep_orphans;         /**< items retired by threads that could not get a record */
+};
+typedef struct gds_epoch_t gds_epoch_t;
+GDS_CLASS_DECLARATION(gds_epoch_t);
+
+/**
+ * Begin a read-side section. Anything found from here until the
+ * matching gds_epoch_exit remains valid, even if it is retired in
+ * the meantime.
+ *
+ * @return GDS_SUCCESS, or GDS_ERR_OUT_OF_RESOURCE if a record
+ *         could not be allocated for this thread
+ */
+int gds_epoch_enter(gds_epoch_t *ep);
+
+/**
+ * End a read-side section
+ */
+void gds_epoch_exit(gds_epoch_t *ep);
+
+/**
+ * Queue an item to be released once no reader can still hold it.
+ * The item must already be unreachable for new readers.
+ *
+ * @param ep    The domain (IN)
+ * @param fn    Function to release the item (IN)
+ * @param ctx   Passed to fn (IN)
+ * @param ptr   The item (IN)
+ * @return      GDS return code - the item is never released if
+ *              it could not be queued
+ */
+int gds_epoch_retire(gds_epoch_t *ep, gds_epoch_release_fn_t fn,
+                     void *ctx, void *ptr);
+
+/**
+ * Queue an item on an entry supplied by the caller - usually one
+ * embedded in the item itself. The entry must stay put until fn
+ * has been called, but fn may free it.
+ *
+ * @param ep    The domain (IN)
+ * @param item  Entry to queue the item on (IN)
+ * @param fn    Function to release the item (IN)
+ * @param ctx   Passed to fn (IN)
+ * @param ptr   The item (IN)
+ */
+void gds_epoch_retire_entry(gds_epoch_t *ep, gds_epoch_limbo_t *item,
+                            gds_epoch_release_fn_t fn, void *ctx, void *ptr);
+
+/**
+ * Try to advance the epoch, and release whatever that makes safe
+ * among the items retired by the calling thread
+ */
+void gds_epoch_reclaim(gds_epoch_t *ep);
+
+/**
+ * Number of items retired by the calling thread (or by none in
+ * particular) that are waiting to be released
+ */
+size_t gds_epoch_get_pending(gds_epoch_t *ep);
+
+END_C_DECLS
+
+#endif /* GDS_EPOCH_H */
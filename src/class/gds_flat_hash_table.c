@@ -0,0 +1,366 @@
+/* -*- Mode: C; c-basic-offset:4 ; -*- */
+/*
+ * Copyright (c) 2016      Intel, Inc. All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+#include <src/include/gds_config.h>
+
+#include <string.h>
+#include <stdlib.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "src/include/hash_string.h"
+#include "src/class/gds_flat_hash_table.h"
+
+#include <gds.h>
+
+/* control tags. Full slots hold the low seven bits of their key's
+ * hash, so only the markers have the sign bit set */
+#define GDS_FLAT_HASH_EMPTY   ((int8_t)-128)
+#define GDS_FLAT_HASH_DELETED ((int8_t)-2)
+
+struct gds_flat_hash_slot_t {
+    uint64_t    hash;           /* kept so that growing needn't rehash the keys */
+    const void *key;
+    size_t      key_size;
+    void       *value;          /* the value - not owned by the table */
+};
+typedef struct gds_flat_hash_slot_t gds_flat_hash_slot_t;
+
+static void gds_flat_hash_table_construct(gds_flat_hash_table_t *ht);
+static void gds_flat_hash_table_destruct(gds_flat_hash_table_t *ht);
+
+GDS_CLASS_INSTANCE(
+    gds_flat_hash_table_t,
+    gds_object_t,
+    gds_flat_hash_table_construct,
+    gds_flat_hash_table_destruct
+);
+
+static void gds_flat_hash_table_construct(gds_flat_hash_table_t *ht)
+{
+    ht->fh_ctrl = NULL;
+    ht->fh_slots = NULL;
+    ht->fh_capacity = ht->fh_size = ht->fh_growth_left = 0;
+}
+
+static void gds_flat_hash_table_destruct(gds_flat_hash_table_t *ht)
+{
+    gds_flat_hash_table_remove_all(ht);
+    free(ht->fh_ctrl);
+    free(ht->fh_slots);
+}
+
+/* both the bits picking the group and those kept in the tag
+ * need to be well spread, which gds_hash_bytes provides */
+static inline uint64_t gds_flat_hash_key(const void *key, size_t key_size)
+{
+    return gds_hash_bytes(key, key_size, 0);
+}
+
+#define GDS_FLAT_HASH_POS(hash) ((size_t)((hash) >> 7))
+#define GDS_FLAT_HASH_TAG(hash) ((int8_t)((hash) & 0x7f))
+
+/* elements that may be filled before the table must grow - an
+ * eighth is always left empty to keep probes short */
+static inline size_t gds_flat_hash_max_load(size_t capacity)
+{
+    return capacity - capacity / 8;
+}
+
+/* bit i of the result is set if tag i of the group matches */
+static inline uint32_t gds_flat_hash_match(const int8_t *group, int8_t tag)
+{
+#if defined(__SSE2__)
+    __m128i tags = _mm_loadu_si128((const __m128i*)group);
+    return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(tags, _mm_set1_epi8(tag)));
+#else
+    uint32_t bits = 0;
+    int i;
+
+    for (i = 0; i < GDS_FLAT_HASH_GROUP; i++) {
+        if (group[i] == tag) {
+            bits |= 1u << i;
+        }
+    }
+    return bits;
+#endif
+}
+
+/* the same, for the tags that are empty or deleted */
+static inline uint32_t gds_flat_hash_match_free(const int8_t *group)
+{
+#if defined(__SSE2__)
+    return (uint32_t)_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)group));
+#else
+    uint32_t bits = 0;
+    int i;
+
+    for (i = 0; i < GDS_FLAT_HASH_GROUP; i++) {
+        if (group[i] < 0) {
+            bits |= 1u << i;
+        }
+    }
+    return bits;
+#endif
+}
+
+/* the tags of the first group are repeated after the last, so that
+ * a group can be loaded from any position without wrapping */
+static inline void gds_flat_hash_set_ctrl(int8_t *ctrl, size_t capacity,
+                                          size_t ii, int8_t tag)
+{
+    ctrl[ii] = tag;
+    if (ii < GDS_FLAT_HASH_GROUP) {
+        ctrl[capacity + ii] = tag;
+    }
+}
+
+/* groups are probed at triangular offsets, which visits every group
+ * of a power-of-two table */
+static inline int gds_flat_hash_find(gds_flat_hash_table_t *ht, uint64_t hash,
+                                     const void *key, size_t key_size,
+                                     size_t *slot)
+{
+    size_t mask = ht->fh_capacity - 1, pos = GDS_FLAT_HASH_POS(hash) & mask;
+    size_t stride = 0, ii;
+    int8_t tag = GDS_FLAT_HASH_TAG(hash);
+    gds_flat_hash_slot_t *s;
+    uint32_t bits;
+
+    for (;;) {
+        for (bits = gds_flat_hash_match(ht->fh_ctrl + pos, tag); 0 != bits; bits &= bits - 1) {
+            ii = (pos + __builtin_ctz(bits)) & mask;
+            s = &ht->fh_slots[ii];
+            if (s->key_size == key_size && 0 == memcmp(s->key, key, key_size)) {
+                *slot = ii;
+                return GDS_SUCCESS;
+            }
+        }
+        if (0 != gds_flat_hash_match(ht->fh_ctrl + pos, GDS_FLAT_HASH_EMPTY)) {
+            return GDS_ERR_NOT_FOUND;
+        }
+        stride += GDS_FLAT_HASH_GROUP;
+        pos = (pos + stride) & mask;
+    }
+}
+
+/* the first empty or deleted slot on the probe for a hash */
+static inline size_t gds_flat_hash_find_free(const int8_t *ctrl, size_t capacity,
+                                             uint64_t hash)
+{
+    size_t mask = capacity - 1, pos = GDS_FLAT_HASH_POS(hash) & mask;
+    size_t stride = 0;
+    uint32_t bits;
+
+    while (0 == (bits = gds_flat_hash_match_free(ctrl + pos))) {
+        stride += GDS_FLAT_HASH_GROUP;
+        pos = (pos + stride) & mask;
+    }
+    return (pos + __builtin_ctz(bits)) & mask;
+}
+
+/* move every element into a fresh table of the given capacity,
+ * which also clears out the deleted markers */
+static int gds_flat_hash_rebuild(gds_flat_hash_table_t *ht, size_t capacity)
+{
+    gds_flat_hash_slot_t *slots;
+    int8_t *ctrl;
+    size_t ii, jj;
+
+    slots = (gds_flat_hash_slot_t*)malloc(capacity * sizeof(gds_flat_hash_slot_t));
+    ctrl = (int8_t*)malloc(capacity + GDS_FLAT_HASH_GROUP);
+    if (NULL == slots || NULL == ctrl) {
+        free(slots);
+        free(ctrl);
+        return GDS_ERR_OUT_OF_RESOURCE;
+    }
+    memset(ctrl, GDS_FLAT_HASH_EMPTY, capacity + GDS_FLAT_HASH_GROUP);
+    for (ii = 0; ii < ht->fh_capacity; ii++) {
+        if (0 <= ht->fh_ctrl[ii]) {
+            jj = gds_flat_hash_find_free(ctrl, capacity, ht->fh_slots[ii].hash);
+            slots[jj] = ht->fh_slots[ii];
+            gds_flat_hash_set_ctrl(ctrl, capacity, jj, ht->fh_ctrl[ii]);
+        }
+    }
+    free(ht->fh_slots);
+    free(ht->fh_ctrl);
+    ht->fh_slots = slots;
+    ht->fh_ctrl = ctrl;
+    ht->fh_capacity = capacity;
+    ht->fh_growth_left = gds_flat_hash_max_load(capacity) - ht->fh_size;
+    return GDS_SUCCESS;
+}
+
+int gds_flat_hash_table_init(gds_flat_hash_table_t *ht, size_t estimated_max_size)
+{
+    size_t capacity;
+
+    for (capacity = GDS_FLAT_HASH_GROUP;
+         gds_flat_hash_max_load(capacity) < estimated_max_size;
+         capacity <<= 1);
+    free(ht->fh_slots);
+    free(ht->fh_ctrl);
+    ht->fh_slots = NULL;
+    ht->fh_ctrl = NULL;
+    ht->fh_capacity = ht->fh_size = 0;
+    return gds_flat_hash_rebuild(ht, capacity);
+}
+
+int gds_flat_hash_table_remove_all(gds_flat_hash_table_t *ht)
+{
+    size_t ii;
+
+    if (0 == ht->fh_capacity) {
+        return GDS_SUCCESS;
+    }
+    for (ii = 0; ii < ht->fh_capacity; ii++) {
+        if (0 <= ht->fh_ctrl[ii]) {
+            free((void*)ht->fh_slots[ii].key);
+        }
+    }
+    memset(ht->fh_ctrl, GDS_FLAT_HASH_EMPTY, ht->fh_capacity + GDS_FLAT_HASH_GROUP);
+    ht->fh_size = 0;
+    ht->fh_growth_left = gds_flat_hash_max_load(ht->fh_capacity);
+    return GDS_SUCCESS;
+}
+
+int gds_flat_hash_table_get_value_ptr(gds_flat_hash_table_t *ht, const void *key,
+                                      size_t keylen, void **ptr)
+{
+    size_t ii;
+
+    if (GDS_SUCCESS != gds_flat_hash_find(ht, gds_flat_hash_key(key, keylen),
+                                          key, keylen, &ii)) {
+        return GDS_ERR_NOT_FOUND;
+    }
+    *ptr = ht->fh_slots[ii].value;
+    return GDS_SUCCESS;
+}
+
+int gds_flat_hash_table_set_value_ptr(gds_flat_hash_table_t *ht, const void *key,
+                                      size_t keylen, void *value)
+{
+    uint64_t hash = gds_flat_hash_key(key, keylen);
+    gds_flat_hash_slot_t *s;
+    void *key_local;
+    size_t ii, capacity;
+    int rc;
+
+    if (GDS_SUCCESS == gds_flat_hash_find(ht, hash, key, keylen, &ii)) {
+        /* replace existing value */
+        ht->fh_slots[ii].value = value;
+        return GDS_SUCCESS;
+    }
+
+    /* new entry */
+    if (NULL == (key_local = malloc(keylen))) {
+        return GDS_ERR_OUT_OF_RESOURCE;
+    }
+    memcpy(key_local, key, keylen);
+
+    ii = gds_flat_hash_find_free(ht->fh_ctrl, ht->fh_capacity, hash);
+    /* reusing a deleted slot costs nothing - taking an empty one
+     * needs room. Once the room is gone, either the table is full
+     * enough to double or it is mostly deleted markers and need
+     * only be rebuilt at the same size */
+    if (0 == ht->fh_growth_left && GDS_FLAT_HASH_DELETED != ht->fh_ctrl[ii]) {
+        capacity = ht->fh_capacity;
+        if (ht->fh_size >= gds_flat_hash_max_load(capacity) / 2) {
+            capacity <<= 1;
+        }
+        if (GDS_SUCCESS != (rc = gds_flat_hash_rebuild(ht, capacity))) {
+            free(key_local);
+            return rc;
+        }
+        ii = gds_flat_hash_find_free(ht->fh_ctrl, ht->fh_capacity, hash);
+    }
+    if (GDS_FLAT_HASH_EMPTY == ht->fh_ctrl[ii]) {
+        ht->fh_growth_left--;
+    }
+    s = &ht->fh_slots[ii];
+    s->hash = hash;
+    s->key = key_local;
+    s->key_size = keylen;
+    s->value = value;
+    gds_flat_hash_set_ctrl(ht->fh_ctrl, ht->fh_capacity, ii, GDS_FLAT_HASH_TAG(hash));
+    ht->fh_size++;
+    return GDS_SUCCESS;
+}
+
+int gds_flat_hash_table_remove_value_ptr(gds_flat_hash_table_t *ht, const void *key,
+                                         size_t keylen)
+{
+    size_t ii, mask = ht->fh_capacity - 1;
+    uint32_t empty_before, empty_after;
+    int8_t tag = GDS_FLAT_HASH_DELETED;
+
+    if (GDS_SUCCESS != gds_flat_hash_find(ht, gds_flat_hash_key(key, keylen),
+                                          key, keylen, &ii)) {
+        return GDS_ERR_NOT_FOUND;
+    }
+    free((void*)ht->fh_slots[ii].key);
+
+    /* a probe only ever went past this slot if it was part of a run
+     * of a whole group of full slots. If it wasn't, the slot can be
+     * made empty again rather than left as a deleted marker */
+    empty_before = gds_flat_hash_match(ht->fh_ctrl + ((ii - GDS_FLAT_HASH_GROUP) & mask),
+                                       GDS_FLAT_HASH_EMPTY);
+    empty_after = gds_flat_hash_match(ht->fh_ctrl + ii, GDS_FLAT_HASH_EMPTY);
+    if (0 != empty_before && 0 != empty_after &&
+        (size_t)(__builtin_ctz(empty_after) + __builtin_clz(empty_before) - 16) < GDS_FLAT_HASH_GROUP) {
+        tag = GDS_FLAT_HASH_EMPTY;
+        ht->fh_growth_left++;
+    }
+    gds_flat_hash_set_ctrl(ht->fh_ctrl, ht->fh_capacity, ii, tag);
+    ht->fh_size--;
+    return GDS_SUCCESS;
+}
+
+/*
+ * Traversals
+ */
+
+static int gds_flat_hash_table_get_next_slot(gds_flat_hash_table_t *ht,
+                                             gds_flat_hash_slot_t *prev,
+                                             gds_flat_hash_slot_t **next)
+{
+    size_t ii;
+
+    for (ii = (NULL == prev ? 0 : (size_t)(prev - ht->fh_slots) + 1); ii < ht->fh_capacity; ii++) {
+        if (0 <= ht->fh_ctrl[ii]) {
+            *next = &ht->fh_slots[ii];
+            return GDS_SUCCESS;
+        }
+    }
+    return GDS_ERROR;
+}
+
+int gds_flat_hash_table_get_first_key_ptr(gds_flat_hash_table_t *ht, void **key,
+                                          size_t *key_size, void **value, void **node)
+{
+    return gds_flat_hash_table_get_next_key_ptr(ht, key, key_size, value, NULL, node);
+}
+
+int gds_flat_hash_table_get_next_key_ptr(gds_flat_hash_table_t *ht, void **key,
+                                         size_t *key_size, void **value,
+                                         void *in_node, void **out_node)
+{
+    gds_flat_hash_slot_t *s;
+
+    if (GDS_SUCCESS == gds_flat_hash_table_get_next_slot(ht, (gds_flat_hash_slot_t*)in_node, &s)) {
+        *key = (void*)s->key;
+        *key_size = s->key_size;
+        *value = s->value;
+        *out_node = s;
+        return GDS_SUCCESS;
+    }
+    return GDS_ERROR;
+}
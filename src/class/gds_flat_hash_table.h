@@ -0,0 +1,171 @@
+/* -*- Mode: C; c-basic-offset:4 ; -*- */
+/*
+ * Copyright (c) 2016      Intel, Inc. All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+/** @file
+ *
+ * An open-addressed hash table keyed by arbitrary binary keys, laid
+ * out for lookups that touch as little memory as possible.
+ *
+ * Next to the array of elements the table keeps an array of one-byte
+ * control tags - one per element, holding either seven bits of the
+ * key's hash or an empty/deleted marker. A lookup loads the tags for
+ * a group of 16 consecutive elements at once and compares them all
+ * against the key's tag (with SSE2 where available), so it normally
+ * reads a single element: the one whose key actually matches. A
+ * probe stops at the first group with an empty tag.
+ *
+ * The interface mirrors the pointer-keyed half of gds_hash_table_t.
+ * The table takes a copy of each key; it never owns the values.
+ */
+
+#ifndef GDS_FLAT_HASH_TABLE_H
+#define GDS_FLAT_HASH_TABLE_H
+
+#include <src/include/gds_config.h>
+
+#ifdef HAVE_STDINT_H
+#include <stdint.h>
+#endif
+
+#include "src/class/gds_object.h"
+
+BEGIN_C_DECLS
+
+/* number of control tags examined together */
+#define GDS_FLAT_HASH_GROUP 16
+
+struct gds_flat_hash_table_t
+{
+    gds_object_t        super;          /**< subclass of gds_object_t */
+    int8_t              *fh_ctrl;       /**< control tags, plus a copy of the first group at the end */
+    struct gds_flat_hash_slot_t * fh_slots; /**< elements (opaque to users) */
+    size_t               fh_capacity;    /**< number of elements - a power of two */
+    size_t               fh_size;        /**< number of extant entries */
+    size_t               fh_growth_left; /**< empty slots that may be filled before growing */
+};
+typedef struct gds_flat_hash_table_t gds_flat_hash_table_t;
+
+GDS_CLASS_DECLARATION(gds_flat_hash_table_t);
+
+/**
+ *  Initializes the table.
+ *
+ *  @param   table   The input hash table (IN).
+ *  @param   estimated_max_size  Number of elements expected - the
+ *                   table grows as needed (IN).
+ *  @return  GDS error code.
+ *
+ */
+
+int gds_flat_hash_table_init(gds_flat_hash_table_t *ht, size_t estimated_max_size);
+
+/**
+ *  Returns the number of elements currently stored in the table.
+ *
+ *  @param   table   The input hash table (IN).
+ *  @return  The number of elements in the table.
+ *
+ */
+
+static inline size_t gds_flat_hash_table_get_size(gds_flat_hash_table_t *ht)
+{
+    return ht->fh_size;
+}
+
+/**
+ *  Remove all elements from the table.
+ *
+ *  @param   table   The input hash table (IN).
+ *  @return  GDS return code.
+ *
+ */
+
+int gds_flat_hash_table_remove_all(gds_flat_hash_table_t *ht);
+
+/**
+ *  Retrieve value via arbitrary length binary key.
+ *
+ *  @param   table   The input hash table (IN).
+ *  @param   key     The input key (IN).
+ *  @param   ptr     The value associated with the key
+ *  @return  integer return code:
+ *           - GDS_SUCCESS       if key was found
+ *           - GDS_ERR_NOT_FOUND if key was not found
+ *
+ */
+
+int gds_flat_hash_table_get_value_ptr(gds_flat_hash_table_t *ht, const void *key,
+                                      size_t keylen, void **ptr);
+
+/**
+ *  Set value based on arbitrary length binary key.
+ *
+ *  @param   table   The input hash table (IN).
+ *  @param   key     The input key (IN).
+ *  @param   value   The value to be associated with the key (IN).
+ *  @return  GDS return code.
+ *
+ */
+
+int gds_flat_hash_table_set_value_ptr(gds_flat_hash_table_t *ht, const void *key,
+                                      size_t keylen, void *value);
+
+/**
+ *  Remove value based on arbitrary length binary key.
+ *
+ *  @param   table   The input hash table (IN).
+ *  @param   key     The input key (IN).
+ *  @return  GDS return code.
+ *
+ */
+
+int gds_flat_hash_table_remove_value_ptr(gds_flat_hash_table_t *ht, const void *key,
+                                         size_t keylen);
+
+/**
+ *  Get the first key from the table, which can be used later to get
+ *  the next key. As with gds_hash_table_t, the table must not be
+ *  modified while it is being traversed.
+ *
+ *  @param  table    The hash table pointer (IN)
+ *  @param  key      The first key (OUT)
+ *  @param  key_size The size of the first key (OUT)
+ *  @param  value    The value corresponding to this key (OUT)
+ *  @param  node     The pointer to the table's internal element for
+ *                   this key (required for subsequent calls to
+ *                   get_next_key) (OUT)
+ *  @return GDS error code
+ *
+ */
+
+int gds_flat_hash_table_get_first_key_ptr(gds_flat_hash_table_t *ht, void **key,
+                                          size_t *key_size, void **value, void **node);
+
+/**
+ *  Get the next key from the table, knowing the current key
+ *
+ *  @param  table    The hash table pointer (IN)
+ *  @param  key      The key (OUT)
+ *  @param  key_size The size of the key (OUT)
+ *  @param  value    The value corresponding to this key (OUT)
+ *  @param  in_node  The node pointer from previous call to either
+ *                   get_first or get_next (IN)
+ *  @param  out_node The pointer to the table's internal element for
+ *                   this key (OUT)
+ *  @return GDS error code
+ *
+ */
+
+int gds_flat_hash_table_get_next_key_ptr(gds_flat_hash_table_t *ht, void **key,
+                                         size_t *key_size, void **value,
+                                         void *in_node, void **out_node);
+
+END_C_DECLS
+
+#endif  /* GDS_FLAT_HASH_TABLE_H */
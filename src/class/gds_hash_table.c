@@ -24,6 +24,7 @@
 #include <string.h>
 #include <stdlib.h>
 
+#include "src/include/hash_string.h"
 #include "src/util/output.h"
 #include "src/util/crc.h"
 #include "src/class/gds_list.h"
@@ -35,14 +36,19 @@
  * gds_hash_table_t
  */
 
-#define HASH_MULTIPLIER 31
-
 /*
  * Define the structs that are opaque in the .h
  */
 
+/* values of gds_hash_element_t.valid other than 0 (empty) */
+#define GDS_HASH_ELT_VALID 1
+#define GDS_HASH_ELT_MOVED 2    /* gone from a table being resized away from */
+
 struct gds_hash_element_t {
     int         valid;          /* whether this element is valid */
+    int         psl;            /* distance from its home slot (Robin
+                                 * Hood tables only) - fills what would
+                                 * otherwise be padding */
     union {                     /* the key, in its various forms */
         uint32_t        u32;
         uint64_t        u64;
@@ -51,6 +57,9 @@ struct gds_hash_element_t {
             size_t      key_size;
         }       ptr;
     }           key;
+    uint64_t    hash;           /* the key's hash, so that moving the
+                                 * element never needs it recomputed, and
+                                 * most mismatched keys are never compared */
     void *      value;          /* the value */
 };
 typedef struct gds_hash_element_t gds_hash_element_t;
@@ -61,10 +70,17 @@ struct gds_hash_type_methods_t {
      * The key,key_size of pointer keys is
      */
     void        (*elt_destructor)(gds_hash_element_t * elt);
-    /* Hash the key of the element -- for growing and adjusting-after-removal */
-    uint64_t    (*hash_elt)(gds_hash_element_t * elt);
+    /* Compare the key of the element with the given one */
+    int         (*match_key)(gds_hash_element_t * elt, const void * key, size_t key_size);
+    /* Store the given key in the element, taking a copy if need be */
+    int         (*set_key)(gds_hash_element_t * elt, const void * key, size_t key_size);
 };
 
+static int gds_hash_rh_grow(gds_hash_table_t * ht);
+static int gds_hash_grow_incremental(gds_hash_table_t * ht);
+static int gds_hash_rh_remove_elt_at(gds_hash_table_t * ht, size_t ii);
+static void gds_hash_migrate(gds_hash_table_t * ht, size_t nslots);
+
 /* interact with the class-like mechanism */
 
 static void gds_hash_table_construct(gds_hash_table_t* ht);
@@ -85,6 +101,11 @@ gds_hash_table_construct(gds_hash_table_t* ht)
   ht->ht_density_numer = ht->ht_density_denom = 0;
   ht->ht_growth_numer = ht->ht_growth_denom = 0;
   ht->ht_type_methods = NULL;
+  ht->ht_mode = GDS_HASH_TABLE_LINEAR;
+  ht->ht_mask = 0;
+  ht->ht_old_table = NULL;
+  ht->ht_old_capacity = ht->ht_migrated = 0;
+  ht->ht_rehash_step = 0;
 }
 
 static void
@@ -135,6 +156,54 @@ gds_hash_table_init(gds_hash_table_t* ht, size_t table_size)
     return gds_hash_table_init2(ht, table_size, 1, 2, 2, 1);
 }
 
+int                             /* GDS_ return code */
+gds_hash_table_init_mode(gds_hash_table_t* ht, size_t estimated_max_size,
+                          int density_numer, int density_denom,
+                          gds_hash_table_mode_t mode)
+{
+    size_t est_capacity, capacity;
+
+    if (GDS_HASH_TABLE_ROBIN_HOOD != mode) {
+        return gds_hash_table_init2(ht, estimated_max_size,
+                                     density_numer, density_denom, 2, 1);
+    }
+
+    est_capacity = estimated_max_size * density_denom / density_numer;
+    for (capacity = 16; capacity <= est_capacity; capacity <<= 1);
+    ht->ht_table = (gds_hash_element_t*) calloc(capacity, sizeof(gds_hash_element_t));
+    if (NULL == ht->ht_table) {
+        return GDS_ERR_OUT_OF_RESOURCE;
+    }
+    ht->ht_mode           = GDS_HASH_TABLE_ROBIN_HOOD;
+    ht->ht_capacity       = capacity;
+    ht->ht_mask           = capacity - 1;
+    ht->ht_density_numer  = density_numer;
+    ht->ht_density_denom  = density_denom;
+    ht->ht_growth_numer   = 2;
+    ht->ht_growth_denom   = 1;
+    /* there must always be an empty slot to end a probe */
+    ht->ht_growth_trigger = capacity * density_numer / density_denom;
+    if (ht->ht_growth_trigger >= capacity) {
+        ht->ht_growth_trigger = capacity - 1;
+    }
+    ht->ht_type_methods   = NULL;
+    return GDS_SUCCESS;
+}
+
+void
+gds_hash_table_set_rehash_step(gds_hash_table_t* ht, size_t step)
+{
+    if (0 == step && NULL != ht->ht_old_table) {
+        gds_hash_migrate(ht, ht->ht_old_capacity);
+    }
+    /* a table being resized away from is still probed, so
+     * it must have an empty slot left to end the probes */
+    if (0 < step && ht->ht_growth_trigger >= ht->ht_capacity) {
+        ht->ht_growth_trigger = ht->ht_capacity - 1;
+    }
+    ht->ht_rehash_step = step;
+}
+
 int                             /* GDS_ return code */
 gds_hash_table_remove_all(gds_hash_table_t* ht)
 {
@@ -147,6 +216,15 @@ gds_hash_table_remove_all(gds_hash_table_t* ht)
         elt->valid = 0;
         elt->value = NULL;
     }
+    for (ii = ht->ht_migrated; ii < ht->ht_old_capacity; ii += 1) {
+        gds_hash_element_t * elt = &ht->ht_old_table[ii];
+        if (GDS_HASH_ELT_VALID == elt->valid && ht->ht_type_methods->elt_destructor) {
+            ht->ht_type_methods->elt_destructor(elt);
+        }
+    }
+    free(ht->ht_old_table);
+    ht->ht_old_table = NULL;
+    ht->ht_old_capacity = ht->ht_migrated = 0;
     ht->ht_size = 0;
     /* the tests reuse the hash table for different types after removing all */
     /* so we should allow that by forgetting what type it used to be */
@@ -163,6 +241,13 @@ gds_hash_grow(gds_hash_table_t * ht)
     size_t old_capacity;
     size_t new_capacity;
 
+    if (0 < ht->ht_rehash_step) {
+        return gds_hash_grow_incremental(ht);
+    }
+    if (GDS_HASH_TABLE_ROBIN_HOOD == ht->ht_mode) {
+        return gds_hash_rh_grow(ht);
+    }
+
     old_table    = ht->ht_table;
     old_capacity = ht->ht_capacity;
 
@@ -175,8 +260,8 @@ gds_hash_grow(gds_hash_table_t * ht)
     }
 
     /* for each element of the old table (indexed by jj), insert it
-       into the new table (indexed by ii), using the hash_elt method
-       to generically hash an element, then modulo the new capacity,
+       into the new table (indexed by ii), using the hash stored
+       in the element, then modulo the new capacity,
        and using struct-assignment to copy an old element into its
        place int he new table.  The hash table never owns the value,
        and in the case of ptr keys the old dlements will be blindly
@@ -187,7 +272,7 @@ gds_hash_grow(gds_hash_table_t * ht)
         gds_hash_element_t * new_elt;
         old_elt =  &old_table[jj];
         if (old_elt->valid) {
-            for (ii = (ht->ht_type_methods->hash_elt(old_elt)%new_capacity); ; ii += 1) {
+            for (ii = (old_elt->hash%new_capacity); ; ii += 1) {
                 if (ii == new_capacity) { ii = 0; }
                 new_elt = &new_table[ii];
                 if (! new_elt->valid) {
@@ -216,6 +301,10 @@ gds_hash_table_remove_elt_at(gds_hash_table_t * ht, size_t ii)
     gds_hash_element_t* elts = ht->ht_table;
     gds_hash_element_t * elt;
 
+    if (GDS_HASH_TABLE_ROBIN_HOOD == ht->ht_mode) {
+        return gds_hash_rh_remove_elt_at(ht, ii);
+    }
+
     elt = &elts[ii];
 
     if (! elt->valid) {
@@ -245,7 +334,7 @@ gds_hash_table_remove_elt_at(gds_hash_table_t * ht, size_t ii)
             break;              /* done */
         }
         /* rehash it and move it if necessary */
-        for (jj = ht->ht_type_methods->hash_elt(elt)%capacity; ; jj += 1) {
+        for (jj = elt->hash%capacity; ; jj += 1) {
             if (jj == capacity) { jj = 0; }
             if (jj == ii) {
                 /* already in place, either ideal or best-for-now */
@@ -264,19 +353,388 @@ gds_hash_table_remove_elt_at(gds_hash_table_t * ht, size_t ii)
     return GDS_SUCCESS;
 }
 
+/***************************************************************************/
+/* Robin Hood tables, and tables part way through an incremental resize */
+
+/* spread the bits of a hash so that its low bits - all that a
+ * power-of-two table looks at - depend on all of them. Without
+ * this, dense integer keys would fill runs of adjacent slots */
+static inline uint64_t
+gds_hash_mix(uint64_t hash)
+{
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+/* look for a key in a Robin Hood table. If it isn't there, return
+ * where the probe stopped and how far that is from home, which is
+ * where an insert of the key has to start displacing elements */
+static inline int               /* GDS_ return code */
+gds_hash_rh_find(gds_hash_element_t * table, size_t mask,
+                  const struct gds_hash_type_methods_t * methods,
+                  uint64_t hash, const void * key, size_t key_size,
+                  size_t *slot, int *psl)
+{
+    size_t ii;
+    gds_hash_element_t * elt;
+    int dist;
+
+    for (ii = gds_hash_mix(hash) & mask, dist = 0; ; ii = (ii + 1) & mask, dist += 1) {
+        elt = &table[ii];
+        /* every element between the key's home and the key itself
+         * is at least as far from home as the key would be - so an
+         * element nearer its own home means the key isn't here */
+        if (! elt->valid || elt->psl < dist) {
+            *slot = ii;
+            *psl = dist;
+            return GDS_ERR_NOT_FOUND;
+        }
+        if (GDS_HASH_ELT_VALID == elt->valid && elt->hash == hash &&
+            methods->match_key(elt, key, key_size)) {
+            *slot = ii;
+            return GDS_SUCCESS;
+        }
+    }
+}
+
+/* the same for a linear table - if the key isn't there, the
+ * probe stops at the empty slot it would be inserted in */
+static inline int               /* GDS_ return code */
+gds_hash_linear_find(gds_hash_element_t * table, size_t capacity,
+                      const struct gds_hash_type_methods_t * methods,
+                      uint64_t hash, const void * key, size_t key_size,
+                      size_t *slot)
+{
+    size_t ii;
+    gds_hash_element_t * elt;
+
+    for (ii = hash%capacity; ; ii += 1) {
+        if (ii == capacity) { ii = 0; }
+        elt = &table[ii];
+        if (! elt->valid) {
+            *slot = ii;
+            return GDS_ERR_NOT_FOUND;
+        }
+        if (GDS_HASH_ELT_VALID == elt->valid && elt->hash == hash &&
+            methods->match_key(elt, key, key_size)) {
+            *slot = ii;
+            return GDS_SUCCESS;
+        }
+    }
+}
+
+static inline int               /* GDS_ return code */
+gds_hash_find(gds_hash_table_t * ht,
+               const struct gds_hash_type_methods_t * methods,
+               uint64_t hash, const void * key, size_t key_size,
+               size_t *slot, int *psl)
+{
+    if (GDS_HASH_TABLE_ROBIN_HOOD == ht->ht_mode) {
+        return gds_hash_rh_find(ht->ht_table, ht->ht_mask, methods,
+                                 hash, key, key_size, slot, psl);
+    }
+    *psl = 0;
+    return gds_hash_linear_find(ht->ht_table, ht->ht_capacity, methods,
+                                 hash, key, key_size, slot);
+}
+
+/* look for a key among the elements still waiting to be moved
+ * out of the old table */
+static inline int               /* GDS_ return code */
+gds_hash_old_find(gds_hash_table_t * ht,
+                   const struct gds_hash_type_methods_t * methods,
+                   uint64_t hash, const void * key, size_t key_size,
+                   size_t *slot)
+{
+    int psl;
+
+    if (GDS_HASH_TABLE_ROBIN_HOOD == ht->ht_mode) {
+        return gds_hash_rh_find(ht->ht_old_table, ht->ht_old_capacity - 1, methods,
+                                 hash, key, key_size, slot, &psl);
+    }
+    return gds_hash_linear_find(ht->ht_old_table, ht->ht_old_capacity, methods,
+                                 hash, key, key_size, slot);
+}
+
+/* put an element that isn't in the table yet at slot ii,
+ * handing each element it displaces on down the probe */
+static void
+gds_hash_rh_place(gds_hash_element_t * table, size_t mask,
+                   gds_hash_element_t * carry, size_t ii)
+{
+    gds_hash_element_t tmp;
+
+    for (; ; ii = (ii + 1) & mask, carry->psl += 1) {
+        if (! table[ii].valid) {
+            table[ii] = *carry;
+            return;
+        }
+        if (table[ii].psl < carry->psl) {
+            tmp = table[ii];
+            table[ii] = *carry;
+            *carry = tmp;
+        }
+    }
+}
+
+/* move up to nslots slots of the old table across to the new one.
+ * Each element moved leaves a marker behind rather than an empty
+ * slot, so that probes for the elements after it still reach them -
+ * nothing is ever added to the old table, so they never build up */
+static void
+gds_hash_migrate(gds_hash_table_t * ht, size_t nslots)
+{
+    gds_hash_element_t * elt;
+    gds_hash_element_t carry;
+    size_t ii;
+
+    for (; 0 < nslots && ht->ht_migrated < ht->ht_old_capacity; nslots -= 1) {
+        elt = &ht->ht_old_table[ht->ht_migrated++];
+        if (GDS_HASH_ELT_VALID != elt->valid) {
+            continue;
+        }
+        carry = *elt;
+        if (GDS_HASH_TABLE_ROBIN_HOOD == ht->ht_mode) {
+            carry.psl = 0;
+            gds_hash_rh_place(ht->ht_table, ht->ht_mask, &carry,
+                               gds_hash_mix(carry.hash) & ht->ht_mask);
+        } else {
+            ii = carry.hash%ht->ht_capacity;
+            while (ht->ht_table[ii].valid) {
+                if (++ii == ht->ht_capacity) { ii = 0; }
+            }
+            ht->ht_table[ii] = carry;
+        }
+        /* the key storage (if any) now belongs to the new element */
+        elt->valid = GDS_HASH_ELT_MOVED;
+    }
+    if (ht->ht_migrated == ht->ht_old_capacity) {
+        free(ht->ht_old_table);
+        ht->ht_old_table = NULL;
+        ht->ht_old_capacity = 0;
+        ht->ht_migrated = 0;
+    }
+}
+
+/* the get, set and remove used by Robin Hood tables, and by linear
+ * ones while they are being resized */
+static inline int               /* GDS_ return code */
+gds_hash_get_generic(gds_hash_table_t * ht,
+                      const struct gds_hash_type_methods_t * methods,
+                      uint64_t hash, const void * key, size_t key_size,
+                      void * *value)
+{
+    size_t ii;
+    int psl;
+
+    if (GDS_SUCCESS == gds_hash_find(ht, methods, hash, key, key_size, &ii, &psl)) {
+        *value = ht->ht_table[ii].value;
+        return GDS_SUCCESS;
+    }
+    if (NULL != ht->ht_old_table &&
+        GDS_SUCCESS == gds_hash_old_find(ht, methods, hash, key, key_size, &ii)) {
+        *value = ht->ht_old_table[ii].value;
+        return GDS_SUCCESS;
+    }
+    return GDS_ERR_NOT_FOUND;
+}
+
+static inline int               /* GDS_ return code */
+gds_hash_set_generic(gds_hash_table_t * ht,
+                      const struct gds_hash_type_methods_t * methods,
+                      uint64_t hash, const void * key, size_t key_size,
+                      void * value)
+{
+    gds_hash_element_t carry;
+    size_t ii, jj;
+    int psl, rc;
+
+    if (GDS_SUCCESS == gds_hash_find(ht, methods, hash, key, key_size, &ii, &psl)) {
+        /* replace existing value */
+        ht->ht_table[ii].value = value;
+    } else if (NULL != ht->ht_old_table &&
+               GDS_SUCCESS == gds_hash_old_find(ht, methods, hash, key, key_size, &jj)) {
+        /* replace it where it is - it will be moved in its turn */
+        ht->ht_old_table[jj].value = value;
+    } else {
+        /* new entry */
+        if (GDS_SUCCESS != (rc = methods->set_key(&carry, key, key_size))) {
+            return rc;
+        }
+        carry.valid = GDS_HASH_ELT_VALID;
+        carry.psl = psl;
+        carry.hash = hash;
+        carry.value = value;
+        if (GDS_HASH_TABLE_ROBIN_HOOD == ht->ht_mode) {
+            gds_hash_rh_place(ht->ht_table, ht->ht_mask, &carry, ii);
+        } else {
+            ht->ht_table[ii] = carry;
+        }
+        ht->ht_size += 1;
+    }
+    if (NULL != ht->ht_old_table) {
+        gds_hash_migrate(ht, ht->ht_rehash_step);
+    }
+    if (ht->ht_size >= ht->ht_growth_trigger) {
+        return gds_hash_grow(ht);
+    }
+    return GDS_SUCCESS;
+}
+
+static inline int               /* GDS_ return code */
+gds_hash_remove_generic(gds_hash_table_t * ht,
+                         const struct gds_hash_type_methods_t * methods,
+                         uint64_t hash, const void * key, size_t key_size)
+{
+    gds_hash_element_t * elt;
+    size_t ii;
+    int psl, rc;
+
+    if (GDS_SUCCESS == gds_hash_find(ht, methods, hash, key, key_size, &ii, &psl)) {
+        rc = gds_hash_table_remove_elt_at(ht, ii);
+    } else if (NULL != ht->ht_old_table &&
+               GDS_SUCCESS == gds_hash_old_find(ht, methods, hash, key, key_size, &ii)) {
+        elt = &ht->ht_old_table[ii];
+        if (methods->elt_destructor) {
+            methods->elt_destructor(elt);
+        }
+        elt->valid = GDS_HASH_ELT_MOVED;
+        elt->value = NULL;
+        ht->ht_size -= 1;
+        rc = GDS_SUCCESS;
+    } else {
+        return GDS_ERR_NOT_FOUND;
+    }
+    if (NULL != ht->ht_old_table) {
+        gds_hash_migrate(ht, ht->ht_rehash_step);
+    }
+    return rc;
+}
+
+static int                      /* GDS_ return code */
+gds_hash_rh_grow(gds_hash_table_t * ht)
+{
+    gds_hash_element_t * new_table;
+    gds_hash_element_t carry;
+    size_t jj, new_capacity, new_mask;
+
+    new_capacity = ht->ht_capacity * 2;
+    new_mask = new_capacity - 1;
+    new_table = (gds_hash_element_t*) calloc(new_capacity, sizeof(new_table[0]));
+    if (NULL == new_table) {
+        return GDS_ERR_OUT_OF_RESOURCE;
+    }
+    /* as in the linear case, the elements (and any key storage
+     * they own) simply move across */
+    for (jj = 0; jj < ht->ht_capacity; jj += 1) {
+        if (ht->ht_table[jj].valid) {
+            carry = ht->ht_table[jj];
+            carry.psl = 0;
+            gds_hash_rh_place(new_table, new_mask, &carry,
+                               gds_hash_mix(carry.hash) & new_mask);
+        }
+    }
+    free(ht->ht_table);
+    ht->ht_table = new_table;
+    ht->ht_capacity = new_capacity;
+    ht->ht_mask = new_mask;
+    ht->ht_growth_trigger = new_capacity * ht->ht_density_numer / ht->ht_density_denom;
+    if (ht->ht_growth_trigger >= new_capacity) {
+        ht->ht_growth_trigger = new_capacity - 1;
+    }
+    return GDS_SUCCESS;
+}
+
+/* start moving to a larger table, leaving the current one in
+ * place until the updates that follow have moved everything out */
+static int                      /* GDS_ return code */
+gds_hash_grow_incremental(gds_hash_table_t * ht)
+{
+    gds_hash_element_t * new_table;
+    size_t new_capacity;
+
+    /* a step too small for the density means that the last
+     * resize is still going - finish it off */
+    if (NULL != ht->ht_old_table) {
+        gds_hash_migrate(ht, ht->ht_old_capacity);
+    }
+    if (GDS_HASH_TABLE_ROBIN_HOOD == ht->ht_mode) {
+        new_capacity = ht->ht_capacity * 2;
+    } else {
+        new_capacity = ht->ht_capacity * ht->ht_growth_numer / ht->ht_growth_denom;
+        new_capacity = gds_hash_round_capacity_up(new_capacity);
+    }
+    new_table = (gds_hash_element_t*) calloc(new_capacity, sizeof(new_table[0]));
+    if (NULL == new_table) {
+        return GDS_ERR_OUT_OF_RESOURCE;
+    }
+    ht->ht_old_table = ht->ht_table;
+    ht->ht_old_capacity = ht->ht_capacity;
+    ht->ht_migrated = 0;
+    ht->ht_table = new_table;
+    ht->ht_capacity = new_capacity;
+    ht->ht_mask = (GDS_HASH_TABLE_ROBIN_HOOD == ht->ht_mode) ? new_capacity - 1 : 0;
+    /* lookups probe the old table until an empty slot,
+     * so neither table may ever fill up */
+    ht->ht_growth_trigger = new_capacity * ht->ht_density_numer / ht->ht_density_denom;
+    if (ht->ht_growth_trigger >= new_capacity) {
+        ht->ht_growth_trigger = new_capacity - 1;
+    }
+    gds_hash_migrate(ht, ht->ht_rehash_step);
+    return GDS_SUCCESS;
+}
+
+/* rather than rehashing the elements that follow the one removed,
+ * shift them back a slot until reaching one that is already home
+ * (or an empty slot) - which keeps the table as though the removed
+ * element had never been inserted */
+static int                      /* GDS_ return code */
+gds_hash_rh_remove_elt_at(gds_hash_table_t * ht, size_t ii)
+{
+    gds_hash_element_t* elts = ht->ht_table;
+    size_t jj, mask = ht->ht_mask;
+
+    if (! elts[ii].valid) {
+        return GDS_ERROR;
+    }
+    if (ht->ht_type_methods->elt_destructor) {
+        ht->ht_type_methods->elt_destructor(&elts[ii]);
+    }
+    for (jj = (ii + 1) & mask; elts[jj].valid && 0 < elts[jj].psl; jj = (jj + 1) & mask) {
+        elts[ii] = elts[jj];
+        elts[ii].psl -= 1;
+        ii = jj;
+    }
+    elts[ii].valid = 0;
+    elts[ii].value = NULL;
+    ht->ht_size -= 1;
+    return GDS_SUCCESS;
+}
+
 
 /***************************************************************************/
+static int
+gds_hash_match_key_uint32(gds_hash_element_t * elt, const void * key, size_t key_size)
+{
+  return elt->key.u32 == *(const uint32_t*)key;
+}
 
-static uint64_t
-gds_hash_hash_elt_uint32(gds_hash_element_t * elt)
+static int
+gds_hash_set_key_uint32(gds_hash_element_t * elt, const void * key, size_t key_size)
 {
-  return elt->key.u32;
+  elt->key.u32 = *(const uint32_t*)key;
+  return GDS_SUCCESS;
 }
 
 static const struct gds_hash_type_methods_t
 gds_hash_type_methods_uint32 = {
     NULL,
-    gds_hash_hash_elt_uint32
+    gds_hash_match_key_uint32,
+    gds_hash_set_key_uint32
 };
 
 int                             /* GDS_ return code */
@@ -299,7 +757,12 @@ gds_hash_table_get_value_uint32(gds_hash_table_t* ht, uint32_t key, void * *valu
     }
 #endif
 
-    ht->ht_type_methods = &gds_hash_type_methods_uint32;
+    /* lookups leave the table untouched so that they can be
+     * made concurrently (e.g., under a shared lock) */
+    if (GDS_HASH_TABLE_ROBIN_HOOD == ht->ht_mode || NULL != ht->ht_old_table) {
+        return gds_hash_get_generic(ht, &gds_hash_type_methods_uint32,
+                                    key, &key, sizeof(key), value);
+    }
     for (ii = key%capacity; ; ii += 1) {
         if (ii == capacity) { ii = 0; }
         elt = &ht->ht_table[ii];
@@ -337,12 +800,17 @@ gds_hash_table_set_value_uint32(gds_hash_table_t * ht, uint32_t key, void * valu
 #endif
 
     ht->ht_type_methods = &gds_hash_type_methods_uint32;
+    if (GDS_HASH_TABLE_ROBIN_HOOD == ht->ht_mode || NULL != ht->ht_old_table) {
+        return gds_hash_set_generic(ht, &gds_hash_type_methods_uint32,
+                                    key, &key, sizeof(key), value);
+    }
     for (ii = key%capacity; ; ii += 1) {
         if (ii == capacity) { ii = 0; }
         elt = &ht->ht_table[ii];
         if (! elt->valid) {
             /* new entry */
             elt->key.u32 = key;
+            elt->hash = key;
             elt->value = value;
             elt->valid = 1;
             ht->ht_size += 1;
@@ -382,6 +850,10 @@ gds_hash_table_remove_value_uint32(gds_hash_table_t * ht, uint32_t key)
 #endif
 
     ht->ht_type_methods = &gds_hash_type_methods_uint32;
+    if (GDS_HASH_TABLE_ROBIN_HOOD == ht->ht_mode || NULL != ht->ht_old_table) {
+        return gds_hash_remove_generic(ht, &gds_hash_type_methods_uint32,
+                                       key, &key, sizeof(key));
+    }
     for (ii = key%capacity; ; ii += 1) {
         gds_hash_element_t * elt;
         if (ii == capacity) ii = 0;
@@ -400,16 +872,24 @@ gds_hash_table_remove_value_uint32(gds_hash_table_t * ht, uint32_t key)
 /***************************************************************************/
 
 
-static uint64_t
-gds_hash_hash_elt_uint64(gds_hash_element_t * elt)
+static int
+gds_hash_match_key_uint64(gds_hash_element_t * elt, const void * key, size_t key_size)
+{
+  return elt->key.u64 == *(const uint64_t*)key;
+}
+
+static int
+gds_hash_set_key_uint64(gds_hash_element_t * elt, const void * key, size_t key_size)
 {
-  return elt->key.u64;
+  elt->key.u64 = *(const uint64_t*)key;
+  return GDS_SUCCESS;
 }
 
 static const struct gds_hash_type_methods_t
 gds_hash_type_methods_uint64 = {
     NULL,
-    gds_hash_hash_elt_uint64
+    gds_hash_match_key_uint64,
+    gds_hash_set_key_uint64
 };
 
 int                             /* GDS_ return code */
@@ -433,7 +913,12 @@ gds_hash_table_get_value_uint64(gds_hash_table_t * ht, uint64_t key, void * *val
     }
 #endif
 
-    ht->ht_type_methods = &gds_hash_type_methods_uint64;
+    /* lookups leave the table untouched so that they can be
+     * made concurrently (e.g., under a shared lock) */
+    if (GDS_HASH_TABLE_ROBIN_HOOD == ht->ht_mode || NULL != ht->ht_old_table) {
+        return gds_hash_get_generic(ht, &gds_hash_type_methods_uint64,
+                                    key, &key, sizeof(key), value);
+    }
     for (ii = key%capacity; ; ii += 1) {
         if (ii == capacity) { ii = 0; }
         elt = &ht->ht_table[ii];
@@ -471,12 +956,17 @@ gds_hash_table_set_value_uint64(gds_hash_table_t * ht, uint64_t key, void * valu
 #endif
 
     ht->ht_type_methods = &gds_hash_type_methods_uint64;
+    if (GDS_HASH_TABLE_ROBIN_HOOD == ht->ht_mode || NULL != ht->ht_old_table) {
+        return gds_hash_set_generic(ht, &gds_hash_type_methods_uint64,
+                                    key, &key, sizeof(key), value);
+    }
     for (ii = key%capacity; ; ii += 1) {
         if (ii == capacity) { ii = 0; }
         elt = &ht->ht_table[ii];
         if (! elt->valid) {
             /* new entry */
             elt->key.u64 = key;
+            elt->hash = key;
             elt->value = value;
             elt->valid = 1;
             ht->ht_size += 1;
@@ -516,6 +1006,10 @@ gds_hash_table_remove_value_uint64(gds_hash_table_t * ht, uint64_t key)
 #endif
 
     ht->ht_type_methods = &gds_hash_type_methods_uint64;
+    if (GDS_HASH_TABLE_ROBIN_HOOD == ht->ht_mode || NULL != ht->ht_old_table) {
+        return gds_hash_remove_generic(ht, &gds_hash_type_methods_uint64,
+                                       key, &key, sizeof(key));
+    }
     for (ii = key%capacity; ; ii += 1) {
         gds_hash_element_t * elt;
         if (ii == capacity) { ii = 0; }
@@ -537,16 +1031,7 @@ gds_hash_table_remove_value_uint64(gds_hash_table_t * ht, uint64_t key)
 static uint64_t
 gds_hash_hash_key_ptr(const void * key, size_t key_size)
 {
-    uint64_t hash;
-    const unsigned char *scanner;
-    size_t ii;
-
-    hash = 0;
-    scanner = (const unsigned char *)key;
-    for (ii = 0; ii < key_size; ii += 1) {
-        hash = HASH_MULTIPLIER*hash + *scanner++;
-    }
-    return hash;
+    return gds_hash_bytes(key, key_size, 0);
 }
 
 /* ptr methods */
@@ -562,16 +1047,31 @@ gds_hash_destruct_elt_ptr(gds_hash_element_t * elt)
     }
 }
 
-static uint64_t
-gds_hash_hash_elt_ptr(gds_hash_element_t * elt)
+static int
+gds_hash_match_key_ptr(gds_hash_element_t * elt, const void * key, size_t key_size)
 {
-    return gds_hash_hash_key_ptr(elt->key.ptr.key, elt->key.ptr.key_size);
+    return (elt->key.ptr.key_size == key_size &&
+            0 == memcmp(elt->key.ptr.key, key, key_size));
+}
+
+static int
+gds_hash_set_key_ptr(gds_hash_element_t * elt, const void * key, size_t key_size)
+{
+    void * key_local = malloc(key_size);
+    if (NULL == key_local) {
+        return GDS_ERR_OUT_OF_RESOURCE;
+    }
+    memcpy(key_local, key, key_size);
+    elt->key.ptr.key      = key_local;
+    elt->key.ptr.key_size = key_size;
+    return GDS_SUCCESS;
 }
 
 static const struct gds_hash_type_methods_t
 gds_hash_type_methods_ptr = {
     gds_hash_destruct_elt_ptr,
-    gds_hash_hash_elt_ptr
+    gds_hash_match_key_ptr,
+    gds_hash_set_key_ptr
 };
 
 int                             /* GDS_ return code */
@@ -581,6 +1081,7 @@ gds_hash_table_get_value_ptr(gds_hash_table_t * ht,
 {
     size_t ii, capacity = ht->ht_capacity;
     gds_hash_element_t * elt;
+    uint64_t hash;
 
 #if GDS_ENABLE_DEBUG
     if(capacity == 0) {
@@ -596,13 +1097,20 @@ gds_hash_table_get_value_ptr(gds_hash_table_t * ht,
     }
 #endif
 
-    ht->ht_type_methods = &gds_hash_type_methods_ptr;
-    for (ii = gds_hash_hash_key_ptr(key, key_size)%capacity; ; ii += 1) {
+    /* lookups leave the table untouched so that they can be
+     * made concurrently (e.g., under a shared lock) */
+    hash = gds_hash_hash_key_ptr(key, key_size);
+    if (GDS_HASH_TABLE_ROBIN_HOOD == ht->ht_mode || NULL != ht->ht_old_table) {
+        return gds_hash_get_generic(ht, &gds_hash_type_methods_ptr,
+                                    hash, key, key_size, value);
+    }
+    for (ii = hash%capacity; ; ii += 1) {
         if (ii == capacity) { ii = 0; }
         elt = &ht->ht_table[ii];
         if (! elt->valid) {
             return GDS_ERR_NOT_FOUND;
-        } else if (elt->key.ptr.key_size == key_size &&
+        } else if (elt->hash == hash &&
+                   elt->key.ptr.key_size == key_size &&
                    0 == memcmp(elt->key.ptr.key, key, key_size)) {
             *value = elt->value;
             return GDS_SUCCESS;
@@ -620,6 +1128,7 @@ gds_hash_table_set_value_ptr(gds_hash_table_t * ht,
     int rc;
     size_t ii, capacity = ht->ht_capacity;
     gds_hash_element_t * elt;
+    uint64_t hash;
 
 #if GDS_ENABLE_DEBUG
     if(capacity == 0) {
@@ -636,7 +1145,12 @@ gds_hash_table_set_value_ptr(gds_hash_table_t * ht,
 #endif
 
     ht->ht_type_methods = &gds_hash_type_methods_ptr;
-    for (ii = gds_hash_hash_key_ptr(key, key_size)%capacity; ; ii += 1) {
+    hash = gds_hash_hash_key_ptr(key, key_size);
+    if (GDS_HASH_TABLE_ROBIN_HOOD == ht->ht_mode || NULL != ht->ht_old_table) {
+        return gds_hash_set_generic(ht, &gds_hash_type_methods_ptr,
+                                    hash, key, key_size, value);
+    }
+    for (ii = hash%capacity; ; ii += 1) {
         if (ii == capacity) { ii = 0; }
         elt = &ht->ht_table[ii];
         if (! elt->valid) {
@@ -645,6 +1159,7 @@ gds_hash_table_set_value_ptr(gds_hash_table_t * ht,
             memcpy(key_local, key, key_size);
             elt->key.ptr.key      = key_local;
             elt->key.ptr.key_size = key_size;
+            elt->hash = hash;
             elt->value = value;
             elt->valid = 1;
             ht->ht_size += 1;
@@ -654,7 +1169,8 @@ gds_hash_table_set_value_ptr(gds_hash_table_t * ht,
                 }
             }
             return GDS_SUCCESS;
-        } else if (elt->key.ptr.key_size == key_size &&
+        } else if (elt->hash == hash &&
+                   elt->key.ptr.key_size == key_size &&
                    0 == memcmp(elt->key.ptr.key, key, key_size)) {
             /* replace existing value */
             elt->value = value;
@@ -670,6 +1186,7 @@ gds_hash_table_remove_value_ptr(gds_hash_table_t * ht,
                                  const void * key, size_t key_size)
 {
     size_t ii, capacity = ht->ht_capacity;
+    uint64_t hash;
 
 #if GDS_ENABLE_DEBUG
     if(capacity == 0) {
@@ -686,13 +1203,19 @@ gds_hash_table_remove_value_ptr(gds_hash_table_t * ht,
 #endif
 
     ht->ht_type_methods = &gds_hash_type_methods_ptr;
-    for (ii = gds_hash_hash_key_ptr(key, key_size)%capacity; ; ii += 1) {
+    hash = gds_hash_hash_key_ptr(key, key_size);
+    if (GDS_HASH_TABLE_ROBIN_HOOD == ht->ht_mode || NULL != ht->ht_old_table) {
+        return gds_hash_remove_generic(ht, &gds_hash_type_methods_ptr,
+                                       hash, key, key_size);
+    }
+    for (ii = hash%capacity; ; ii += 1) {
         gds_hash_element_t * elt;
         if (ii == capacity) { ii = 0; }
         elt = &ht->ht_table[ii];
         if (! elt->valid) {
             return GDS_ERR_NOT_FOUND;
-        } else if (elt->key.ptr.key_size == key_size &&
+        } else if (elt->hash == hash &&
+                   elt->key.ptr.key_size == key_size &&
                    0 == memcmp(elt->key.ptr.key, key, key_size)) {
             return gds_hash_table_remove_elt_at(ht, ii);
         } else {
@@ -712,6 +1235,21 @@ gds_hash_table_get_next_elt(gds_hash_table_t *ht,
   gds_hash_element_t* elts = ht->ht_table;
   size_t ii, capacity = ht->ht_capacity;
 
+  /* while a resize is going, the elements still in the old table
+   * come first */
+  if (NULL != ht->ht_old_table &&
+      (NULL == prev_elt || (ht->ht_old_table <= prev_elt &&
+                            prev_elt < ht->ht_old_table + ht->ht_old_capacity))) {
+    for (ii = (NULL == prev_elt ? ht->ht_migrated : (size_t)(prev_elt-ht->ht_old_table)+1);
+         ii < ht->ht_old_capacity; ii += 1) {
+      if (GDS_HASH_ELT_VALID == ht->ht_old_table[ii].valid) {
+        *next_elt = &ht->ht_old_table[ii];
+        return GDS_SUCCESS;
+      }
+    }
+    prev_elt = NULL;
+  }
+
   for (ii = (NULL == prev_elt ? 0 : (prev_elt-elts)+1); ii < capacity; ii += 1) {
     gds_hash_element_t * elt = &elts[ii];
     if (elt->valid) {
@@ -792,5 +1330,114 @@ gds_hash_table_get_next_key_uint64(gds_hash_table_t * ht,
   return GDS_ERROR;
 }
 
+/* states of a gds_hash_table_cursor_t */
+#define GDS_HASH_CURSOR_START 0
+#define GDS_HASH_CURSOR_OLD   1
+#define GDS_HASH_CURSOR_TABLE 2
+#define GDS_HASH_CURSOR_DONE  3
+
+/* how far ahead of a batched traversal to prefetch, in slots */
+#define GDS_HASH_PREFETCH_SLOTS 16
+
+static inline gds_hash_element_t *
+gds_hash_cursor_next(gds_hash_table_t *ht, gds_hash_table_cursor_t *cursor)
+{
+  gds_hash_element_t * elts;
+  size_t ii, capacity;
+
+  if (GDS_HASH_CURSOR_START == cursor->hc_state) {
+    cursor->hc_state = (NULL != ht->ht_old_table) ? GDS_HASH_CURSOR_OLD : GDS_HASH_CURSOR_TABLE;
+    cursor->hc_slot = (NULL != ht->ht_old_table) ? ht->ht_migrated : 0;
+  }
+  if (GDS_HASH_CURSOR_OLD == cursor->hc_state) {
+    elts = ht->ht_old_table;
+    capacity = ht->ht_old_capacity;
+    for (ii = cursor->hc_slot; ii < capacity; ii += 1) {
+      if (ii + GDS_HASH_PREFETCH_SLOTS < capacity) {
+        GDS_PREFETCH(&elts[ii + GDS_HASH_PREFETCH_SLOTS], 0, 0);
+      }
+      if (GDS_HASH_ELT_VALID == elts[ii].valid) {
+        cursor->hc_slot = ii + 1;
+        return &elts[ii];
+      }
+    }
+    cursor->hc_state = GDS_HASH_CURSOR_TABLE;
+    cursor->hc_slot = 0;
+  }
+  if (GDS_HASH_CURSOR_TABLE == cursor->hc_state) {
+    elts = ht->ht_table;
+    capacity = ht->ht_capacity;
+    for (ii = cursor->hc_slot; ii < capacity; ii += 1) {
+      if (ii + GDS_HASH_PREFETCH_SLOTS < capacity) {
+        GDS_PREFETCH(&elts[ii + GDS_HASH_PREFETCH_SLOTS], 0, 0);
+      }
+      if (elts[ii].valid) {
+        cursor->hc_slot = ii + 1;
+        return &elts[ii];
+      }
+    }
+    cursor->hc_state = GDS_HASH_CURSOR_DONE;
+  }
+  return NULL;
+}
+
+int                             /* GDS_ return code */
+gds_hash_table_get_batch_uint32(gds_hash_table_t * ht,
+                                 gds_hash_table_cursor_t * cursor,
+                                 uint32_t *keys, void * *values,
+                                 size_t max, size_t *count)
+{
+  gds_hash_element_t * elt;
+  size_t n = 0;
+
+  while (n < max && NULL != (elt = gds_hash_cursor_next(ht, cursor))) {
+    GDS_PREFETCH(elt->value, 0, 3);
+    keys[n]   = elt->key.u32;
+    values[n] = elt->value;
+    n += 1;
+  }
+  *count = n;
+  return (0 < n) ? GDS_SUCCESS : GDS_ERROR;
+}
+
+int                             /* GDS_ return code */
+gds_hash_table_get_batch_uint64(gds_hash_table_t * ht,
+                                 gds_hash_table_cursor_t * cursor,
+                                 uint64_t *keys, void * *values,
+                                 size_t max, size_t *count)
+{
+  gds_hash_element_t * elt;
+  size_t n = 0;
+
+  while (n < max && NULL != (elt = gds_hash_cursor_next(ht, cursor))) {
+    GDS_PREFETCH(elt->value, 0, 3);
+    keys[n]   = elt->key.u64;
+    values[n] = elt->value;
+    n += 1;
+  }
+  *count = n;
+  return (0 < n) ? GDS_SUCCESS : GDS_ERROR;
+}
+
+int                             /* GDS_ return code */
+gds_hash_table_get_batch_ptr(gds_hash_table_t * ht,
+                              gds_hash_table_cursor_t * cursor,
+                              const void * *keys, size_t *key_sizes,
+                              void * *values, size_t max, size_t *count)
+{
+  gds_hash_element_t * elt;
+  size_t n = 0;
+
+  while (n < max && NULL != (elt = gds_hash_cursor_next(ht, cursor))) {
+    GDS_PREFETCH(elt->value, 0, 3);
+    keys[n]      = elt->key.ptr.key;
+    key_sizes[n] = elt->key.ptr.key_size;
+    values[n]    = elt->value;
+    n += 1;
+  }
+  *count = n;
+  return (0 < n) ? GDS_SUCCESS : GDS_ERROR;
+}
+
 /* there was/is no traversal for the ptr case; it would go here */
 /* interact with the class-like mechanism */
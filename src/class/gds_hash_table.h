@@ -49,6 +49,15 @@ BEGIN_C_DECLS
 
 GDS_CLASS_DECLARATION(gds_hash_table_t);
 
+/**
+ * Probing schemes a table can use - chosen when the table is
+ * initialized, and fixed from then on
+ */
+typedef enum {
+    GDS_HASH_TABLE_LINEAR,      /**< linear probing, capacity kept at 1 mod 30 */
+    GDS_HASH_TABLE_ROBIN_HOOD   /**< Robin Hood probing, power-of-two capacity */
+} gds_hash_table_mode_t;
+
 struct gds_hash_table_t
 {
     gds_object_t        super;          /**< subclass of gds_object_t */
@@ -58,6 +67,12 @@ struct gds_hash_table_t
     size_t               ht_growth_trigger; /**< size hits this and table is grown  */
     int                  ht_density_numer, ht_density_denom; /**< max allowed density of table */
     int                  ht_growth_numer, ht_growth_denom;   /**< growth factor when grown  */
+    gds_hash_table_mode_t ht_mode;       /**< probing scheme */
+    size_t               ht_mask;        /**< capacity - 1 (Robin Hood tables only) */
+    struct gds_hash_element_t * ht_old_table;   /**< table being moved out of during an incremental resize */
+    size_t               ht_old_capacity; /**< its capacity */
+    size_t               ht_migrated;    /**< slots of it moved so far */
+    size_t               ht_rehash_step; /**< slots moved per update (0 = resize all at once) */
     const struct gds_hash_type_methods_t * ht_type_methods;
 };
 typedef struct gds_hash_table_t gds_hash_table_t;
@@ -82,6 +97,54 @@ int gds_hash_table_init2(gds_hash_table_t* ht, size_t estimated_max_size,
                                         int density_numer, int density_denom,
                                         int growth_numer, int growth_denom);
 
+/**
+ *  Initializes a table that uses the given probing scheme.
+ *
+ *  Robin Hood tables keep a power-of-two capacity, so a probe is a
+ *  mask rather than a division, and pass every key (integers
+ *  included) through a mixing hash. An insert displaces any element
+ *  lying closer to its home slot than the one being inserted, and a
+ *  removal shifts the following elements back, so probe lengths stay
+ *  short even when the table is mostly full - these tables can run
+ *  at a much higher density than the default of 1/2. They always
+ *  double in size when they grow.
+ *
+ *  @param   table   The input hash table (IN).
+ *  @param   estimated_max_size  Number of elements expected (IN).
+ *  @param   density_numer, density_denom  Density at which
+ *                   the table grows (IN).
+ *  @param   mode    The probing scheme (IN).
+ *  @return  GDS error code.
+ *
+ */
+
+int gds_hash_table_init_mode(gds_hash_table_t* ht, size_t estimated_max_size,
+                             int density_numer, int density_denom,
+                             gds_hash_table_mode_t mode);
+
+/**
+ *  Sets how the table resizes.
+ *
+ *  By default a table that has to grow moves every element into the
+ *  new, larger table there and then, stalling the insert that
+ *  triggered it. With a non-zero step it instead keeps the old table
+ *  alongside the new one: each later set or remove moves that many
+ *  slots of the old table across, and lookups check both tables
+ *  until it is empty. Lookups never move anything, so they can
+ *  still be made concurrently under a shared lock.
+ *
+ *  The step should be at least density_denom/density_numer for the
+ *  old table to be emptied before the new one needs to grow in turn
+ *  - if it is not, what is left is moved all at once at that point.
+ *  Setting a step of zero finishes any resize that is going.
+ *
+ *  @param   table   The input hash table (IN).
+ *  @param   step    Slots to move per update (IN).
+ *
+ */
+
+void gds_hash_table_set_rehash_step(gds_hash_table_t* ht, size_t step);
+
 /**
  *  Returns the number of elements currently stored in the table.
  *
@@ -342,6 +405,86 @@ int gds_hash_table_get_next_key_ptr(gds_hash_table_t *table, void* *key,
                                        void *in_node, void **out_node);
 
 
+/* Batched traversal - rather than one element per call, each call
+   copies as many (key, value) pairs as the caller has room for,
+   and prefetches the values on the way so that the caller's first
+   look at each is a cache hit. As with the calls above, the table
+   must not be changed while a traversal is in progress. */
+
+/**
+ * Where a batched traversal has got to. Its contents are private
+ * to the table - set it up with gds_hash_table_cursor_init before
+ * the first batch.
+ */
+typedef struct {
+    int         hc_state;       /**< not started, in the old table of a
+                                     resize, in the table, or done */
+    size_t      hc_slot;        /**< next slot to look at */
+} gds_hash_table_cursor_t;
+
+static inline void gds_hash_table_cursor_init(gds_hash_table_cursor_t *cursor)
+{
+    cursor->hc_state = 0;
+    cursor->hc_slot = 0;
+}
+
+/**
+ *  Get the next batch of 32 bit keys from the hash table
+ *  @param  table   The hash table pointer (IN)
+ *  @param  cursor  Where the traversal has got to (IN/OUT)
+ *  @param  keys    Array of at least max keys (OUT)
+ *  @param  values  Array of at least max values (OUT)
+ *  @param  max     Most pairs to return (IN)
+ *  @param  count   Number of pairs returned (OUT)
+ *  @return GDS_SUCCESS if any pairs were returned, GDS_ERROR once
+ *          the traversal is complete
+ *
+ */
+
+int gds_hash_table_get_batch_uint32(gds_hash_table_t *table,
+                                    gds_hash_table_cursor_t *cursor,
+                                    uint32_t *keys, void **values,
+                                    size_t max, size_t *count);
+
+/**
+ *  Get the next batch of 64 bit keys from the hash table
+ *  @param  table   The hash table pointer (IN)
+ *  @param  cursor  Where the traversal has got to (IN/OUT)
+ *  @param  keys    Array of at least max keys (OUT)
+ *  @param  values  Array of at least max values (OUT)
+ *  @param  max     Most pairs to return (IN)
+ *  @param  count   Number of pairs returned (OUT)
+ *  @return GDS_SUCCESS if any pairs were returned, GDS_ERROR once
+ *          the traversal is complete
+ *
+ */
+
+int gds_hash_table_get_batch_uint64(gds_hash_table_t *table,
+                                    gds_hash_table_cursor_t *cursor,
+                                    uint64_t *keys, void **values,
+                                    size_t max, size_t *count);
+
+/**
+ *  Get the next batch of ptr keys from the hash table
+ *  @param  table     The hash table pointer (IN)
+ *  @param  cursor    Where the traversal has got to (IN/OUT)
+ *  @param  keys      Array of at least max keys - these point into
+ *                    the table (OUT)
+ *  @param  key_sizes Array of at least max key sizes (OUT)
+ *  @param  values    Array of at least max values (OUT)
+ *  @param  max       Most pairs to return (IN)
+ *  @param  count     Number of pairs returned (OUT)
+ *  @return GDS_SUCCESS if any pairs were returned, GDS_ERROR once
+ *          the traversal is complete
+ *
+ */
+
+int gds_hash_table_get_batch_ptr(gds_hash_table_t *table,
+                                 gds_hash_table_cursor_t *cursor,
+                                 const void **keys, size_t *key_sizes,
+                                 void **values, size_t max, size_t *count);
+
+
 /**
  * @brief Returns next power-of-two of the given value.
  *
@@ -0,0 +1,337 @@
+/* -*- Mode: C; c-basic-offset:4 ; -*- */
+/*
+ * Copyright (c) 2016      Intel, Inc. All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+#include <src/include/gds_config.h>
+
+#include <string.h>
+#include <stdlib.h>
+
+#include "gds_common.h"
+#include "src/class/gds_key_index.h"
+
+/* initial capacity of the table once we leave inline mode - must
+ * be a power of two */
+#define GDS_KEY_INDEX_MIN_CAPACITY  16
+
+static void gds_key_index_construct(gds_key_index_t *ki);
+static void gds_key_index_destruct(gds_key_index_t *ki);
+
+GDS_CLASS_INSTANCE(gds_key_index_t, gds_object_t,
+                   gds_key_index_construct,
+                   gds_key_index_destruct);
+
+static void gds_key_index_construct(gds_key_index_t *ki)
+{
+    ki->ki_size = 0;
+    ki->ki_capacity = 0;
+    ki->ki_table = NULL;
+    memset(ki->ki_inline, 0, sizeof(ki->ki_inline));
+    ki->ki_release = NULL;
+    ki->ki_release_ctx = NULL;
+}
+
+static void gds_key_index_destruct(gds_key_index_t *ki)
+{
+    if (NULL != ki->ki_table) {
+        free(ki->ki_table);
+        ki->ki_table = NULL;
+    }
+    ki->ki_capacity = 0;
+    ki->ki_size = 0;
+}
+
+/* atoms are assigned sequentially, so spread them across
+ * the table with a multiplicative (Fibonacci) hash */
+static inline uint32_t gds_key_index_hash(gds_atom_t atom)
+{
+    uint32_t hash = atom * 0x9e3779b1U;
+    return hash ^ (hash >> 16);
+}
+
+/* locate the table slot holding the key, or the empty slot
+ * that terminates its probe sequence */
+static size_t gds_key_index_probe(gds_key_index_t *ki,
+                                  uint32_t hash, gds_atom_t atom)
+{
+    size_t mask = ki->ki_capacity - 1;
+    size_t ii;
+
+    for (ii = hash & mask; ; ii = (ii + 1) & mask) {
+        gds_key_index_slot_t *slot = &ki->ki_table[ii];
+        if (NULL == slot->value || slot->atom == atom) {
+            return ii;
+        }
+    }
+}
+
+/* slots are written field by field so that gds_key_index_peek
+ * never sees a torn atom or value - a fresh slot's value is written
+ * last, so a reader that finds it also finds its atom */
+static inline void gds_key_index_slot_store(gds_key_index_slot_t *slot, gds_atom_t atom,
+                                            uint32_t hash, void *value)
+{
+    __atomic_store_n(&slot->atom, atom, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->hash, hash, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->value, value, __ATOMIC_RELEASE);
+}
+
+static inline void gds_key_index_slot_clear(gds_key_index_slot_t *slot)
+{
+    __atomic_store_n(&slot->value, NULL, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->atom, GDS_ATOM_INVALID, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->hash, 0, __ATOMIC_RELAXED);
+}
+
+/* hand back a table that has been taken out of service */
+static void gds_key_index_release_table(gds_key_index_t *ki,
+                                        gds_key_index_slot_t *table)
+{
+    if (NULL != ki->ki_release) {
+        ki->ki_release(ki->ki_release_ctx, table);
+    } else {
+        free(table);
+    }
+}
+
+/* place a slot known not to be present - used when (re)building the table */
+static void gds_key_index_place(gds_key_index_slot_t *table, size_t capacity,
+                                gds_key_index_slot_t *src)
+{
+    size_t mask = capacity - 1;
+    size_t ii;
+
+    for (ii = src->hash & mask; NULL != table[ii].value; ii = (ii + 1) & mask);
+    table[ii] = *src;
+}
+
+static int gds_key_index_resize(gds_key_index_t *ki, size_t capacity)
+{
+    gds_key_index_slot_t *table, *old;
+    size_t ii, nold;
+
+    table = (gds_key_index_slot_t*)calloc(capacity, sizeof(gds_key_index_slot_t));
+    if (NULL == table) {
+        return GDS_ERR_OUT_OF_RESOURCE;
+    }
+
+    if (0 == ki->ki_capacity) {
+        old = ki->ki_inline;
+        nold = ki->ki_size;
+    } else {
+        old = ki->ki_table;
+        nold = ki->ki_capacity;
+    }
+    /* the cached hashes let us move everything without rehashing */
+    for (ii = 0; ii < nold; ii++) {
+        if (NULL != old[ii].value) {
+            gds_key_index_place(table, capacity, &old[ii]);
+        }
+    }
+
+    /* publish the table before its capacity, so a reader that
+     * sees the new capacity also sees the new table */
+    old = ki->ki_table;
+    nold = ki->ki_capacity;
+    __atomic_store_n(&ki->ki_table, table, __ATOMIC_RELEASE);
+    __atomic_store_n(&ki->ki_capacity, capacity, __ATOMIC_RELEASE);
+    if (0 == nold) {
+        for (ii = 0; ii < GDS_KEY_INDEX_INLINE_MAX; ii++) {
+            gds_key_index_slot_clear(&ki->ki_inline[ii]);
+        }
+    } else {
+        gds_key_index_release_table(ki, old);
+    }
+    return GDS_SUCCESS;
+}
+
+void* gds_key_index_get(gds_key_index_t *ki, gds_atom_t atom)
+{
+    size_t ii;
+
+    if (0 == ki->ki_capacity) {
+        for (ii = 0; ii < ki->ki_size; ii++) {
+            if (ki->ki_inline[ii].atom == atom) {
+                return ki->ki_inline[ii].value;
+            }
+        }
+        return NULL;
+    }
+
+    ii = gds_key_index_probe(ki, gds_key_index_hash(atom), atom);
+    return ki->ki_table[ii].value;
+}
+
+int gds_key_index_set(gds_key_index_t *ki, gds_atom_t atom, void *value)
+{
+    uint32_t hash = gds_key_index_hash(atom);
+    gds_key_index_slot_t *slot;
+    size_t ii;
+    int rc;
+
+    if (NULL == value || GDS_ATOM_INVALID == atom) {
+        return GDS_ERR_BAD_PARAM;
+    }
+
+    if (0 == ki->ki_capacity) {
+        /* inline entries are kept packed at the front */
+        for (ii = 0; ii < ki->ki_size; ii++) {
+            slot = &ki->ki_inline[ii];
+            if (slot->atom == atom) {
+                __atomic_store_n(&slot->value, value, __ATOMIC_RELEASE);
+                return GDS_SUCCESS;
+            }
+        }
+        if (ki->ki_size < GDS_KEY_INDEX_INLINE_MAX) {
+            gds_key_index_slot_store(&ki->ki_inline[ki->ki_size], atom, hash, value);
+            ki->ki_size++;
+            return GDS_SUCCESS;
+        }
+        /* out of inline room - convert to a table */
+        if (GDS_SUCCESS != (rc = gds_key_index_resize(ki, GDS_KEY_INDEX_MIN_CAPACITY))) {
+            return rc;
+        }
+    }
+
+    ii = gds_key_index_probe(ki, hash, atom);
+    slot = &ki->ki_table[ii];
+    if (NULL != slot->value) {
+        /* replace the existing entry */
+        __atomic_store_n(&slot->value, value, __ATOMIC_RELEASE);
+        return GDS_SUCCESS;
+    }
+
+    /* hold the density at or below 1/2 - growing first, so that
+     * a failure leaves the index without the new entry */
+    if ((ki->ki_size + 1) * 2 > ki->ki_capacity) {
+        if (GDS_SUCCESS != (rc = gds_key_index_resize(ki, ki->ki_capacity * 2))) {
+            return rc;
+        }
+        ii = gds_key_index_probe(ki, hash, atom);
+        slot = &ki->ki_table[ii];
+    }
+    gds_key_index_slot_store(slot, atom, hash, value);
+    ki->ki_size++;
+    return GDS_SUCCESS;
+}
+
+void* gds_key_index_remove(gds_key_index_t *ki, gds_atom_t atom)
+{
+    gds_key_index_slot_t *slot;
+    size_t ii, jj, ideal, mask;
+    void *value;
+
+    if (0 == ki->ki_capacity) {
+        for (ii = 0; ii < ki->ki_size; ii++) {
+            if (ki->ki_inline[ii].atom == atom) {
+                value = ki->ki_inline[ii].value;
+                /* keep the inline vector packed */
+                ki->ki_size--;
+                if (ii < ki->ki_size) {
+                    slot = &ki->ki_inline[ki->ki_size];
+                    gds_key_index_slot_store(&ki->ki_inline[ii], slot->atom,
+                                             slot->hash, slot->value);
+                }
+                gds_key_index_slot_clear(&ki->ki_inline[ki->ki_size]);
+                return value;
+            }
+        }
+        return NULL;
+    }
+
+    ii = gds_key_index_probe(ki, gds_key_index_hash(atom), atom);
+    if (NULL == (value = ki->ki_table[ii].value)) {
+        return NULL;
+    }
+
+    /* backward-shift any followers into the gap so that no
+     * tombstones are required - the cached hash tells us where
+     * each follower would ideally live */
+    mask = ki->ki_capacity - 1;
+    for (jj = (ii + 1) & mask; NULL != ki->ki_table[jj].value; jj = (jj + 1) & mask) {
+        ideal = ki->ki_table[jj].hash & mask;
+        /* move the follower only if the gap lies between its
+         * ideal position and where it currently sits */
+        if (((jj - ideal) & mask) >= ((jj - ii) & mask)) {
+            slot = &ki->ki_table[jj];
+            gds_key_index_slot_store(&ki->ki_table[ii], slot->atom,
+                                     slot->hash, slot->value);
+            ii = jj;
+        }
+    }
+    gds_key_index_slot_clear(&ki->ki_table[ii]);
+    ki->ki_size--;
+    return value;
+}
+
+void gds_key_index_remove_all(gds_key_index_t *ki)
+{
+    gds_key_index_slot_t *table = ki->ki_table;
+    size_t ii;
+
+    /* drop the capacity first - see gds_key_index_resize */
+    __atomic_store_n(&ki->ki_capacity, 0, __ATOMIC_RELEASE);
+    __atomic_store_n(&ki->ki_table, NULL, __ATOMIC_RELEASE);
+    if (NULL != table) {
+        gds_key_index_release_table(ki, table);
+    }
+    ki->ki_size = 0;
+    for (ii = 0; ii < GDS_KEY_INDEX_INLINE_MAX; ii++) {
+        gds_key_index_slot_clear(&ki->ki_inline[ii]);
+    }
+}
+
+void gds_key_index_set_release(gds_key_index_t *ki,
+                               gds_key_index_release_fn_t fn, void *ctx)
+{
+    ki->ki_release = fn;
+    ki->ki_release_ctx = ctx;
+}
+
+void* gds_key_index_peek(gds_key_index_t *ki, gds_atom_t atom)
+{
+    gds_key_index_slot_t *table;
+    size_t capacity, mask, ii, n;
+    void *value;
+
+    if (GDS_ATOM_INVALID == atom) {
+        return NULL;
+    }
+
+    /* the capacity goes first - see gds_key_index_resize */
+    capacity = __atomic_load_n(&ki->ki_capacity, __ATOMIC_ACQUIRE);
+    if (0 == capacity) {
+        /* the size may be changing, but unused slots are empty */
+        for (ii = 0; ii < GDS_KEY_INDEX_INLINE_MAX; ii++) {
+            value = __atomic_load_n(&ki->ki_inline[ii].value, __ATOMIC_ACQUIRE);
+            if (NULL != value &&
+                atom == __atomic_load_n(&ki->ki_inline[ii].atom, __ATOMIC_RELAXED)) {
+                return value;
+            }
+        }
+        return NULL;
+    }
+
+    if (NULL == (table = __atomic_load_n(&ki->ki_table, __ATOMIC_ACQUIRE))) {
+        return NULL;
+    }
+    /* a table caught mid-change could lack the usual empty slot
+     * that ends the probe, so never go round more than once */
+    mask = capacity - 1;
+    for (ii = gds_key_index_hash(atom) & mask, n = 0; n < capacity;
+         ii = (ii + 1) & mask, n++) {
+        if (NULL == (value = __atomic_load_n(&table[ii].value, __ATOMIC_ACQUIRE))) {
+            return NULL;
+        }
+        if (atom == __atomic_load_n(&table[ii].atom, __ATOMIC_RELAXED)) {
+            return value;
+        }
+    }
+    return NULL;
+}
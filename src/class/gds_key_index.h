@@ -0,0 +1,139 @@
+/* -*- Mode: C; c-basic-offset:4 ; -*- */
+/*
+ * Copyright (c) 2016      Intel, Inc. All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+/** @file
+ *
+ * A small index used to locate the values stored for a single
+ * process. Keys are interned atoms (see src/util/atom.h), so all
+ * comparisons are integer compares. Datastores typically hold a
+ * few dozen keys per process, so the index starts out as an inline
+ * vector of slots and converts itself to an open-addressed table
+ * (with the hash of each atom cached in its slot) once the number
+ * of keys exceeds GDS_KEY_INDEX_INLINE_MAX.
+ *
+ * The index never owns the value - the caller is responsible for
+ * removing the entry before releasing it. NULL values cannot be
+ * stored.
+ *
+ * Changes must be serialized by the caller, but gds_key_index_peek
+ * may run alongside them - see its description for what that
+ * requires of the caller.
+ */
+
+#ifndef GDS_KEY_INDEX_H
+#define GDS_KEY_INDEX_H
+
+#include <src/include/gds_config.h>
+
+#ifdef HAVE_STDINT_H
+#include <stdint.h>
+#endif
+
+#include "src/class/gds_object.h"
+
+#include <gds_common.h>
+
+BEGIN_C_DECLS
+
+/* number of keys held in the inline vector before we
+ * switch to a hashed table */
+#define GDS_KEY_INDEX_INLINE_MAX    4
+
+typedef struct {
+    gds_atom_t atom;        /**< interned key */
+    uint32_t hash;          /**< cached hash of the atom */
+    void *value;            /**< NULL marks an empty slot */
+} gds_key_index_slot_t;
+
+/* releases a table the index no longer uses */
+typedef void (*gds_key_index_release_fn_t)(void *ctx, void *table);
+
+struct gds_key_index_t {
+    gds_object_t super;
+    size_t ki_size;                     /**< number of extant entries */
+    size_t ki_capacity;                 /**< size of ki_table, 0 while inline */
+    gds_key_index_slot_t *ki_table;     /**< open-addressed table */
+    gds_key_index_slot_t ki_inline[GDS_KEY_INDEX_INLINE_MAX];
+    gds_key_index_release_fn_t ki_release;  /**< releases replaced tables, or NULL to free them */
+    void *ki_release_ctx;
+};
+typedef struct gds_key_index_t gds_key_index_t;
+GDS_CLASS_DECLARATION(gds_key_index_t);
+
+/**
+ * Returns the number of entries currently in the index.
+ */
+static inline size_t gds_key_index_get_size(gds_key_index_t *ki)
+{
+    return ki->ki_size;
+}
+
+/**
+ * Retrieve the value associated with a key.
+ *
+ * @param ki    The index (IN)
+ * @param atom  The key to find (IN)
+ * @return      The value, or NULL if the key is not present
+ */
+void* gds_key_index_get(gds_key_index_t *ki, gds_atom_t atom);
+
+/**
+ * Associate a value with a key, replacing any existing value.
+ *
+ * @param ki    The index (IN)
+ * @param atom  The key (IN)
+ * @param value The value - cannot be NULL (IN)
+ * @return      GDS return code
+ */
+int gds_key_index_set(gds_key_index_t *ki, gds_atom_t atom, void *value);
+
+/**
+ * Remove a key from the index.
+ *
+ * @param ki    The index (IN)
+ * @param atom  The key to remove (IN)
+ * @return      The value that was removed, or NULL if the key
+ *              was not present
+ */
+void* gds_key_index_remove(gds_key_index_t *ki, gds_atom_t atom);
+
+/**
+ * Remove all entries from the index, returning it to inline mode.
+ */
+void gds_key_index_remove_all(gds_key_index_t *ki);
+
+/**
+ * Have the tables replaced as the index grows (or emptied by
+ * gds_key_index_remove_all) handed to a function rather than
+ * freed - e.g., to defer freeing them until concurrent readers
+ * are done with them. The index's final table is always freed
+ * when the index is destructed.
+ */
+void gds_key_index_set_release(gds_key_index_t *ki,
+                               gds_key_index_release_fn_t fn, void *ctx);
+
+/**
+ * Retrieve the value associated with a key while another thread
+ * may be changing the index. The lookup itself is always safe
+ * provided replaced tables outlive the call (see
+ * gds_key_index_set_release), but entries moving about under it
+ * can make it miss the key or return the value of another one -
+ * so the caller must be able to detect a concurrent change and
+ * retry (e.g., with a sequence lock), and must also defer
+ * releasing any value it removes.
+ *
+ * @param ki    The index (IN)
+ * @param atom  The key to find (IN)
+ * @return      The value, or NULL if the key was not found
+ */
+void* gds_key_index_peek(gds_key_index_t *ki, gds_atom_t atom);
+
+END_C_DECLS
+
+#endif /* GDS_KEY_INDEX_H */
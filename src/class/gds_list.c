@@ -31,7 +31,7 @@
 static void gds_list_item_construct(gds_list_item_t*);
 static void gds_list_item_destruct(gds_list_item_t*);
 
-GDS_CLASS_INSTANCE(
+GDS_CLASS_INSTANCE_POOLED(
     gds_list_item_t,
     gds_object_t,
     gds_list_item_construct,
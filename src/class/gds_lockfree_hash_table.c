@@ -0,0 +1,470 @@
+/* -*- Mode: C; c-basic-offset:4 ; -*- */
+/*
+ * Copyright (c) 2016      Intel, Inc. All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+#include <src/include/gds_config.h>
+
+#include <string.h>
+#include <stdlib.h>
+
+#include "src/include/hash_string.h"
+#include "src/include/prefetch.h"
+#include "src/class/gds_lockfree_hash_table.h"
+
+#include <gds.h>
+
+/* elements per bucket, on average, before the buckets double */
+#define GDS_LOCKFREE_HASH_LOAD 2
+/* removed elements to let build up before trying to free them -
+ * reclaiming means taking the epoch domain's lock */
+#define GDS_LOCKFREE_HASH_RECLAIM 64
+
+struct gds_lockfree_hash_node_t {
+    uintptr_t   next;           /* the next node - the low bit is set
+                                 * once this one has been removed */
+    uint64_t    so_key;         /* bit-reversed hash - odd for elements,
+                                 * even for bucket markers */
+    void       *value;          /* the value - not owned by the table */
+    gds_epoch_limbo_t retire;   /* queues the node for freeing once
+                                 * it has been unlinked */
+    size_t      key_size;
+    unsigned char key[];        /* copy of the key (empty for markers) */
+};
+typedef struct gds_lockfree_hash_node_t gds_lockfree_hash_node_t;
+
+#define GDS_LOCKFREE_HASH_MARKED(p) (0 != ((p) & 1))
+#define GDS_LOCKFREE_HASH_NODE(p)   ((gds_lockfree_hash_node_t*)((p) & ~(uintptr_t)1))
+
+static void gds_lockfree_hash_table_construct(gds_lockfree_hash_table_t *ht);
+static void gds_lockfree_hash_table_destruct(gds_lockfree_hash_table_t *ht);
+
+GDS_CLASS_INSTANCE(
+    gds_lockfree_hash_table_t,
+    gds_object_t,
+    gds_lockfree_hash_table_construct,
+    gds_lockfree_hash_table_destruct
+);
+
+static void gds_lockfree_hash_table_construct(gds_lockfree_hash_table_t *ht)
+{
+    GDS_CONSTRUCT(&ht->lf_epoch, gds_epoch_t);
+    memset(ht->lf_segments, 0, sizeof(ht->lf_segments));
+    ht->lf_nbuckets = 0;
+    ht->lf_size = 0;
+}
+
+/* no other thread can be using the table by now. Every node still
+ * on the list is freed here - those that were unlinked belong to
+ * the epoch domain, which frees them in turn */
+static void gds_lockfree_hash_table_destruct(gds_lockfree_hash_table_t *ht)
+{
+    gds_lockfree_hash_node_t *node, *next;
+    int s;
+
+    node = (NULL == ht->lf_segments[0]) ? NULL : ht->lf_segments[0][0];
+    for (; NULL != node; node = next) {
+        next = GDS_LOCKFREE_HASH_NODE(node->next);
+        free(node);
+    }
+    for (s = 0; s < GDS_LOCKFREE_HASH_SEGMENTS; s++) {
+        free(ht->lf_segments[s]);
+        ht->lf_segments[s] = NULL;
+    }
+    GDS_DESTRUCT(&ht->lf_epoch);
+}
+
+static void gds_lockfree_hash_free_node(void *ctx, void *ptr)
+{
+    free(ptr);
+}
+
+static inline uint64_t gds_lockfree_hash_reverse(uint64_t x)
+{
+    x = ((x >> 1) & 0x5555555555555555ULL) | ((x & 0x5555555555555555ULL) << 1);
+    x = ((x >> 2) & 0x3333333333333333ULL) | ((x & 0x3333333333333333ULL) << 2);
+    x = ((x >> 4) & 0x0f0f0f0f0f0f0f0fULL) | ((x & 0x0f0f0f0f0f0f0f0fULL) << 4);
+    return __builtin_bswap64(x);
+}
+
+/* the directory entry for a bucket, allocating its segment if
+ * need be. Racing threads may both allocate - the loser frees */
+static gds_lockfree_hash_node_t** gds_lockfree_hash_slot(gds_lockfree_hash_table_t *ht,
+                                                         size_t bucket)
+{
+    gds_lockfree_hash_node_t **seg, **expected = NULL;
+    size_t base;
+    int s;
+
+    s = (0 == bucket) ? 0 : 64 - __builtin_clzll((unsigned long long)bucket);
+    base = (0 == s) ? 0 : (size_t)1 << (s - 1);
+    seg = __atomic_load_n(&ht->lf_segments[s], __ATOMIC_ACQUIRE);
+    if (NULL == seg) {
+        seg = (gds_lockfree_hash_node_t**)calloc((0 == s) ? 1 : base, sizeof(*seg));
+        if (NULL == seg) {
+            return NULL;
+        }
+        if (!__atomic_compare_exchange_n(&ht->lf_segments[s], &expected, seg, false,
+                                         __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            free(seg);
+            seg = expected;
+        }
+    }
+    return &seg[bucket - base];
+}
+
+/* find where a key is, or would go, on the list after the given
+ * node - *prevp is left pointing at the link to *curp. Nodes met on
+ * the way that have been removed are unlinked, and whoever unlinks
+ * a node is the one to retire it */
+static bool gds_lockfree_hash_find(gds_lockfree_hash_table_t *ht,
+                                   gds_lockfree_hash_node_t *start, uint64_t so_key,
+                                   const void *key, size_t key_size,
+                                   uintptr_t **prevp, gds_lockfree_hash_node_t **curp)
+{
+    gds_lockfree_hash_node_t *cur;
+    uintptr_t *prev, next, expected;
+
+  retry:
+    prev = &start->next;
+    cur = GDS_LOCKFREE_HASH_NODE(__atomic_load_n(prev, __ATOMIC_ACQUIRE));
+    while (NULL != cur) {
+        next = __atomic_load_n(&cur->next, __ATOMIC_ACQUIRE);
+        if (GDS_LOCKFREE_HASH_MARKED(next)) {
+            expected = (uintptr_t)cur;
+            if (!__atomic_compare_exchange_n(prev, &expected, next & ~(uintptr_t)1, false,
+                                             __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+                /* the node before changed under us */
+                goto retry;
+            }
+            gds_epoch_retire_entry(&ht->lf_epoch, &cur->retire,
+                                   gds_lockfree_hash_free_node, NULL, cur);
+            cur = GDS_LOCKFREE_HASH_NODE(next);
+            continue;
+        }
+        if (cur->so_key > so_key) {
+            break;
+        }
+        if (cur->so_key == so_key && cur->key_size == key_size &&
+            (0 == key_size || 0 == memcmp(cur->key, key, key_size))) {
+            *prevp = prev;
+            *curp = cur;
+            return true;
+        }
+        prev = &cur->next;
+        cur = GDS_LOCKFREE_HASH_NODE(next);
+    }
+    *prevp = prev;
+    *curp = cur;
+    return false;
+}
+
+/* the marker node heading a bucket, inserting it (and those of its
+ * parent buckets) if this is the first time the bucket is used */
+static gds_lockfree_hash_node_t* gds_lockfree_hash_bucket(gds_lockfree_hash_table_t *ht,
+                                                          size_t bucket)
+{
+    gds_lockfree_hash_node_t **slot, *marker, *parent, *cur;
+    uintptr_t *prev, expected;
+    uint64_t so_key;
+
+    if (NULL == (slot = gds_lockfree_hash_slot(ht, bucket))) {
+        return NULL;
+    }
+    if (NULL != (marker = __atomic_load_n(slot, __ATOMIC_ACQUIRE))) {
+        return marker;
+    }
+    /* a bucket splits off from the one without its top bit, so
+     * its marker goes in that bucket's part of the list */
+    parent = gds_lockfree_hash_bucket(ht, bucket & ~((size_t)1 << (63 - __builtin_clzll((unsigned long long)bucket))));
+    if (NULL == parent) {
+        return NULL;
+    }
+    if (NULL == (marker = (gds_lockfree_hash_node_t*)malloc(sizeof(gds_lockfree_hash_node_t)))) {
+        return NULL;
+    }
+    so_key = gds_lockfree_hash_reverse(bucket);
+    marker->so_key = so_key;
+    marker->value = NULL;
+    marker->key_size = 0;
+    for (;;) {
+        if (gds_lockfree_hash_find(ht, parent, so_key, NULL, 0, &prev, &cur)) {
+            /* someone else got there first */
+            free(marker);
+            marker = cur;
+            break;
+        }
+        marker->next = (uintptr_t)cur;
+        expected = (uintptr_t)cur;
+        if (__atomic_compare_exchange_n(prev, &expected, (uintptr_t)marker, false,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            break;
+        }
+    }
+    /* everyone racing to get here stores the same node */
+    __atomic_store_n(slot, marker, __ATOMIC_RELEASE);
+    return marker;
+}
+
+static inline gds_lockfree_hash_node_t* gds_lockfree_hash_start(gds_lockfree_hash_table_t *ht,
+                                                                uint64_t hash)
+{
+    size_t nbuckets = __atomic_load_n(&ht->lf_nbuckets, __ATOMIC_ACQUIRE);
+
+    return gds_lockfree_hash_bucket(ht, hash & (nbuckets - 1));
+}
+
+int gds_lockfree_hash_table_init(gds_lockfree_hash_table_t *ht, size_t estimated_max_size)
+{
+    gds_lockfree_hash_node_t **slot, *head;
+    size_t nbuckets;
+
+    for (nbuckets = 2;
+         nbuckets * GDS_LOCKFREE_HASH_LOAD < estimated_max_size &&
+         nbuckets < ((size_t)1 << (GDS_LOCKFREE_HASH_SEGMENTS - 1));
+         nbuckets <<= 1);
+    if (NULL == (slot = gds_lockfree_hash_slot(ht, 0))) {
+        return GDS_ERR_OUT_OF_RESOURCE;
+    }
+    if (NULL == *slot) {
+        if (NULL == (head = (gds_lockfree_hash_node_t*)malloc(sizeof(gds_lockfree_hash_node_t)))) {
+            return GDS_ERR_OUT_OF_RESOURCE;
+        }
+        head->next = 0;
+        head->so_key = 0;
+        head->value = NULL;
+        head->key_size = 0;
+        *slot = head;
+    }
+    ht->lf_nbuckets = nbuckets;
+    return GDS_SUCCESS;
+}
+
+static int gds_lockfree_hash_get(gds_lockfree_hash_table_t *ht,
+                                 const void *key, size_t key_size, void **value)
+{
+    uint64_t hash = gds_hash_bytes(key, key_size, 0);
+    gds_lockfree_hash_node_t *start, *cur;
+    uintptr_t *prev;
+    int rc;
+
+    if (GDS_SUCCESS != (rc = gds_epoch_enter(&ht->lf_epoch))) {
+        return rc;
+    }
+    if (NULL == (start = gds_lockfree_hash_start(ht, hash))) {
+        rc = GDS_ERR_OUT_OF_RESOURCE;
+    } else if (gds_lockfree_hash_find(ht, start, gds_lockfree_hash_reverse(hash | (1ULL << 63)),
+                                      key, key_size, &prev, &cur)) {
+        *value = __atomic_load_n(&cur->value, __ATOMIC_ACQUIRE);
+        rc = GDS_SUCCESS;
+    } else {
+        rc = GDS_ERR_NOT_FOUND;
+    }
+    gds_epoch_exit(&ht->lf_epoch);
+    return rc;
+}
+
+static int gds_lockfree_hash_set(gds_lockfree_hash_table_t *ht,
+                                 const void *key, size_t key_size, void *value)
+{
+    uint64_t hash = gds_hash_bytes(key, key_size, 0);
+    uint64_t so_key = gds_lockfree_hash_reverse(hash | (1ULL << 63));
+    gds_lockfree_hash_node_t *start, *cur, *node = NULL;
+    uintptr_t *prev, expected;
+    size_t size, nbuckets;
+    int rc;
+
+    if (GDS_SUCCESS != (rc = gds_epoch_enter(&ht->lf_epoch))) {
+        return rc;
+    }
+    if (NULL == (start = gds_lockfree_hash_start(ht, hash))) {
+        gds_epoch_exit(&ht->lf_epoch);
+        return GDS_ERR_OUT_OF_RESOURCE;
+    }
+    for (;;) {
+        if (gds_lockfree_hash_find(ht, start, so_key, key, key_size, &prev, &cur)) {
+            /* replace existing value */
+            __atomic_store_n(&cur->value, value, __ATOMIC_RELEASE);
+            free(node);
+            break;
+        }
+        /* new entry */
+        if (NULL == node) {
+            node = (gds_lockfree_hash_node_t*)malloc(sizeof(gds_lockfree_hash_node_t) + key_size);
+            if (NULL == node) {
+                rc = GDS_ERR_OUT_OF_RESOURCE;
+                break;
+            }
+            node->so_key = so_key;
+            node->value = value;
+            node->key_size = key_size;
+            memcpy(node->key, key, key_size);
+        }
+        node->next = (uintptr_t)cur;
+        expected = (uintptr_t)cur;
+        if (__atomic_compare_exchange_n(prev, &expected, (uintptr_t)node, false,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            size = __atomic_add_fetch(&ht->lf_size, 1, __ATOMIC_RELAXED);
+            /* doubling the buckets moves nothing - the new ones
+             * are filled in as they are first used */
+            nbuckets = __atomic_load_n(&ht->lf_nbuckets, __ATOMIC_RELAXED);
+            if (size > nbuckets * GDS_LOCKFREE_HASH_LOAD &&
+                nbuckets < ((size_t)1 << (GDS_LOCKFREE_HASH_SEGMENTS - 1))) {
+                (void)__atomic_compare_exchange_n(&ht->lf_nbuckets, &nbuckets, nbuckets * 2, false,
+                                                  __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+            }
+            break;
+        }
+    }
+    gds_epoch_exit(&ht->lf_epoch);
+    return rc;
+}
+
+static int gds_lockfree_hash_remove(gds_lockfree_hash_table_t *ht,
+                                    const void *key, size_t key_size)
+{
+    uint64_t hash = gds_hash_bytes(key, key_size, 0);
+    uint64_t so_key = gds_lockfree_hash_reverse(hash | (1ULL << 63));
+    gds_lockfree_hash_node_t *start, *cur;
+    uintptr_t *prev, next, expected;
+    int rc;
+
+    if (GDS_SUCCESS != (rc = gds_epoch_enter(&ht->lf_epoch))) {
+        return rc;
+    }
+    if (NULL == (start = gds_lockfree_hash_start(ht, hash))) {
+        gds_epoch_exit(&ht->lf_epoch);
+        return GDS_ERR_OUT_OF_RESOURCE;
+    }
+    for (;;) {
+        if (!gds_lockfree_hash_find(ht, start, so_key, key, key_size, &prev, &cur)) {
+            rc = GDS_ERR_NOT_FOUND;
+            break;
+        }
+        /* marking the node is what removes it - whoever manages
+         * that has removed the key, even if someone else ends up
+         * doing the unlinking */
+        next = __atomic_load_n(&cur->next, __ATOMIC_ACQUIRE);
+        if (GDS_LOCKFREE_HASH_MARKED(next) ||
+            !__atomic_compare_exchange_n(&cur->next, &next, next | 1, false,
+                                         __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            continue;
+        }
+        expected = (uintptr_t)cur;
+        if (__atomic_compare_exchange_n(prev, &expected, next, false,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            gds_epoch_retire_entry(&ht->lf_epoch, &cur->retire,
+                                   gds_lockfree_hash_free_node, NULL, cur);
+        } else {
+            /* leave it to a search to unlink */
+            (void)gds_lockfree_hash_find(ht, start, so_key, key, key_size, &prev, &cur);
+        }
+        __atomic_sub_fetch(&ht->lf_size, 1, __ATOMIC_RELAXED);
+        break;
+    }
+    gds_epoch_exit(&ht->lf_epoch);
+
+    if (GDS_LOCKFREE_HASH_RECLAIM <= gds_epoch_get_pending(&ht->lf_epoch)) {
+        gds_epoch_reclaim(&ht->lf_epoch);
+    }
+    return rc;
+}
+
+int gds_lockfree_hash_table_get_value_uint64(gds_lockfree_hash_table_t *ht, uint64_t key,
+                                             void **ptr)
+{
+    return gds_lockfree_hash_get(ht, &key, sizeof(key), ptr);
+}
+
+int gds_lockfree_hash_table_set_value_uint64(gds_lockfree_hash_table_t *ht, uint64_t key,
+                                             void *value)
+{
+    return gds_lockfree_hash_set(ht, &key, sizeof(key), value);
+}
+
+int gds_lockfree_hash_table_remove_value_uint64(gds_lockfree_hash_table_t *ht, uint64_t key)
+{
+    return gds_lockfree_hash_remove(ht, &key, sizeof(key));
+}
+
+int gds_lockfree_hash_table_get_value_ptr(gds_lockfree_hash_table_t *ht, const void *key,
+                                          size_t keylen, void **ptr)
+{
+    return gds_lockfree_hash_get(ht, key, keylen, ptr);
+}
+
+int gds_lockfree_hash_table_set_value_ptr(gds_lockfree_hash_table_t *ht, const void *key,
+                                          size_t keylen, void *value)
+{
+    return gds_lockfree_hash_set(ht, key, keylen, value);
+}
+
+int gds_lockfree_hash_table_remove_value_ptr(gds_lockfree_hash_table_t *ht, const void *key,
+                                             size_t keylen)
+{
+    return gds_lockfree_hash_remove(ht, key, keylen);
+}
+
+int gds_lockfree_hash_table_get_batch_uint64(gds_lockfree_hash_table_t *ht,
+                                             gds_lockfree_hash_table_cursor_t *cursor,
+                                             uint64_t *keys, void **values,
+                                             size_t max, size_t *count)
+{
+    gds_lockfree_hash_node_t *start, *cur;
+    uint64_t last = cursor->lc_so_key, run_so_key = 0;
+    size_t n = 0, run = 0;
+    uintptr_t next;
+    int rc;
+
+    *count = 0;
+    if (GDS_SUCCESS != (rc = gds_epoch_enter(&ht->lf_epoch))) {
+        return rc;
+    }
+    /* pick up again from the bucket the last key returned was in */
+    if (0 == last) {
+        start = __atomic_load_n(&ht->lf_segments[0][0], __ATOMIC_ACQUIRE);
+    } else {
+        start = gds_lockfree_hash_start(ht, gds_lockfree_hash_reverse(last) & ~(1ULL << 63));
+    }
+    if (NULL == start) {
+        gds_epoch_exit(&ht->lf_epoch);
+        return GDS_ERR_OUT_OF_RESOURCE;
+    }
+    for (cur = GDS_LOCKFREE_HASH_NODE(__atomic_load_n(&start->next, __ATOMIC_ACQUIRE));
+         NULL != cur; cur = GDS_LOCKFREE_HASH_NODE(next)) {
+        next = __atomic_load_n(&cur->next, __ATOMIC_ACQUIRE);
+        GDS_PREFETCH(GDS_LOCKFREE_HASH_NODE(next), 0, 3);
+        if (GDS_LOCKFREE_HASH_MARKED(next) || 0 == (cur->so_key & 1) ||
+            cur->so_key <= cursor->lc_so_key) {
+            continue;
+        }
+        if (n == max) {
+            /* the cursor can only say which hash it got to, so a
+             * batch must not end part way through keys whose
+             * hashes collide - unless they alone fill it */
+            if (cur->so_key == last && 0 < run) {
+                n = run;
+                last = run_so_key;
+            }
+            break;
+        }
+        if (0 == n || cur->so_key != last) {
+            run = n;
+            run_so_key = last;
+        }
+        memcpy(&keys[n], cur->key, sizeof(uint64_t));
+        values[n] = __atomic_load_n(&cur->value, __ATOMIC_ACQUIRE);
+        last = cur->so_key;
+        n++;
+    }
+    gds_epoch_exit(&ht->lf_epoch);
+
+    cursor->lc_so_key = last;
+    *count = n;
+    return (0 < n) ? GDS_SUCCESS : GDS_ERROR;
+}
@@ -0,0 +1,219 @@
+/* -*- Mode: C; c-basic-offset:4 ; -*- */
+/*
+ * Copyright (c) 2016      Intel, Inc. All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+/** @file
+ *
+ * A hash table that any number of threads may use at once, with
+ * no locks - gets, sets and removes all proceed concurrently.
+ *
+ * It is a split-ordered list (Shalev and Shavit): every element
+ * lives on a single lock-free linked list (Harris and Michael),
+ * sorted by the bit-reversed hash of its key, and the buckets are
+ * no more than shortcuts into that list. Doubling the number of
+ * buckets therefore never moves an element - each new bucket just
+ * inserts a marker node at the point in the list where its
+ * elements start. The bucket directory is split into segments of
+ * doubling size that are allocated as buckets are first used.
+ *
+ * Removed elements are handed to an epoch domain (gds_epoch_t)
+ * owned by the table, and freed once no thread can still be
+ * looking at them. Every call enters the domain, so none of them
+ * may be made from inside another section of the same domain.
+ *
+ * The interface mirrors the uint64 and pointer keyed parts of
+ * gds_hash_table_t. The table takes a copy of each key, but never
+ * owns the values. A table should only ever be used with one type
+ * of key.
+ *
+ * Traversals go a batch at a time, in split order. Since an element
+ * never moves once it is on the list, a cursor need only remember
+ * the split-order key it stopped at - so a traversal returns every
+ * element that is in the table throughout, exactly once, however
+ * many inserts and removes happen alongside it.
+ */
+
+#ifndef GDS_LOCKFREE_HASH_TABLE_H
+#define GDS_LOCKFREE_HASH_TABLE_H
+
+#include <src/include/gds_config.h>
+
+#ifdef HAVE_STDINT_H
+#include <stdint.h>
+#endif
+
+#include "src/class/gds_object.h"
+#include "src/class/gds_epoch.h"
+
+BEGIN_C_DECLS
+
+/* segment 0 holds bucket 0, and segment s > 0 buckets [2^(s-1), 2^s) */
+#define GDS_LOCKFREE_HASH_SEGMENTS 48
+
+struct gds_lockfree_hash_table_t
+{
+    gds_object_t        super;          /**< subclass of gds_object_t */
+    gds_epoch_t         lf_epoch;       /**< defers freeing removed elements */
+    struct gds_lockfree_hash_node_t ** lf_segments[GDS_LOCKFREE_HASH_SEGMENTS]; /**< bucket directory */
+    size_t              lf_nbuckets;    /**< number of buckets in use - a power of two */
+    size_t              lf_size;        /**< number of extant entries */
+};
+typedef struct gds_lockfree_hash_table_t gds_lockfree_hash_table_t;
+
+GDS_CLASS_DECLARATION(gds_lockfree_hash_table_t);
+
+/**
+ *  Initializes the table. This must complete before the table is
+ *  shared with other threads.
+ *
+ *  @param   table   The input hash table (IN).
+ *  @param   estimated_max_size  Number of elements expected - the
+ *                   table grows as needed (IN).
+ *  @return  GDS error code.
+ *
+ */
+
+int gds_lockfree_hash_table_init(gds_lockfree_hash_table_t *ht, size_t estimated_max_size);
+
+/**
+ *  Returns the number of elements currently stored in the table -
+ *  which, with other threads making changes, may already be stale.
+ *
+ *  @param   table   The input hash table (IN).
+ *  @return  The number of elements in the table.
+ *
+ */
+
+static inline size_t gds_lockfree_hash_table_get_size(gds_lockfree_hash_table_t *ht)
+{
+    return __atomic_load_n(&ht->lf_size, __ATOMIC_RELAXED);
+}
+
+/**
+ *  Retrieve value via uint64_t key.
+ *
+ *  @param   table   The input hash table (IN).
+ *  @param   key     The input key (IN).
+ *  @param   ptr     The value associated with the key
+ *  @return  integer return code:
+ *           - GDS_SUCCESS       if key was found
+ *           - GDS_ERR_NOT_FOUND if key was not found
+ *           - GDS_ERR_OUT_OF_RESOURCE if the calling thread
+ *             could not be registered with the epoch domain
+ *
+ */
+
+int gds_lockfree_hash_table_get_value_uint64(gds_lockfree_hash_table_t *ht, uint64_t key,
+                                             void **ptr);
+
+/**
+ *  Set value based on uint64_t key.
+ *
+ *  @param   table   The input hash table (IN).
+ *  @param   key     The input key (IN).
+ *  @param   value   The value to be associated with the key (IN).
+ *  @return  GDS return code.
+ *
+ */
+
+int gds_lockfree_hash_table_set_value_uint64(gds_lockfree_hash_table_t *ht, uint64_t key,
+                                             void *value);
+
+/**
+ *  Remove value based on uint64_t key.
+ *
+ *  @param   table   The input hash table (IN).
+ *  @param   key     The input key (IN).
+ *  @return  GDS return code.
+ *
+ */
+
+int gds_lockfree_hash_table_remove_value_uint64(gds_lockfree_hash_table_t *ht, uint64_t key);
+
+/**
+ *  Retrieve value via arbitrary length binary key.
+ *
+ *  @param   table   The input hash table (IN).
+ *  @param   key     The input key (IN).
+ *  @param   ptr     The value associated with the key
+ *  @return  integer return code:
+ *           - GDS_SUCCESS       if key was found
+ *           - GDS_ERR_NOT_FOUND if key was not found
+ *           - GDS_ERR_OUT_OF_RESOURCE if the calling thread
+ *             could not be registered with the epoch domain
+ *
+ */
+
+int gds_lockfree_hash_table_get_value_ptr(gds_lockfree_hash_table_t *ht, const void *key,
+                                          size_t keylen, void **ptr);
+
+/**
+ *  Set value based on arbitrary length binary key.
+ *
+ *  @param   table   The input hash table (IN).
+ *  @param   key     The input key (IN).
+ *  @param   value   The value to be associated with the key (IN).
+ *  @return  GDS return code.
+ *
+ */
+
+int gds_lockfree_hash_table_set_value_ptr(gds_lockfree_hash_table_t *ht, const void *key,
+                                          size_t keylen, void *value);
+
+/**
+ *  Remove value based on arbitrary length binary key.
+ *
+ *  @param   table   The input hash table (IN).
+ *  @param   key     The input key (IN).
+ *  @return  GDS return code.
+ *
+ */
+
+int gds_lockfree_hash_table_remove_value_ptr(gds_lockfree_hash_table_t *ht, const void *key,
+                                             size_t keylen);
+
+/**
+ * Where a batched traversal has got to. Its contents are private
+ * to the table - set it up with gds_lockfree_hash_table_cursor_init
+ * before the first batch.
+ */
+typedef struct {
+    uint64_t    lc_so_key;      /**< split-order key last returned */
+} gds_lockfree_hash_table_cursor_t;
+
+static inline void gds_lockfree_hash_table_cursor_init(gds_lockfree_hash_table_cursor_t *cursor)
+{
+    cursor->lc_so_key = 0;
+}
+
+/**
+ *  Get the next batch of uint64_t keys from the hash table. Other
+ *  threads may change the table between, and during, calls.
+ *
+ *  @param   table   The input hash table (IN).
+ *  @param   cursor  Where the traversal has got to (IN/OUT).
+ *  @param   keys    Array of at least max keys (OUT).
+ *  @param   values  Array of at least max values (OUT).
+ *  @param   max     Most pairs to return (IN).
+ *  @param   count   Number of pairs returned (OUT).
+ *  @return  integer return code:
+ *           - GDS_SUCCESS       if any pairs were returned
+ *           - GDS_ERROR         once the traversal is complete
+ *           - GDS_ERR_OUT_OF_RESOURCE if the calling thread
+ *             could not be registered with the epoch domain
+ *
+ */
+
+int gds_lockfree_hash_table_get_batch_uint64(gds_lockfree_hash_table_t *ht,
+                                             gds_lockfree_hash_table_cursor_t *cursor,
+                                             uint64_t *keys, void **values,
+                                             size_t max, size_t *count);
+
+END_C_DECLS
+
+#endif  /* GDS_LOCKFREE_HASH_TABLE_H */
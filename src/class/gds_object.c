@@ -28,8 +28,11 @@
 
 
 #include <stdio.h>
+#include <pthread.h>
+#include <sched.h>
 
 #include "src/class/gds_object.h"
+#include "src/include/prefetch.h"
 
 /*
  * Instantiation of class descriptor for the base class.  This is
@@ -45,7 +48,8 @@ gds_class_t gds_object_t_class = {
     0,                    /* class hierarchy depth */
     NULL,                 /* array of constructors */
     NULL,                 /* array of destructors */
-    sizeof(gds_object_t) /* size of the gds object */
+    sizeof(gds_object_t), /* size of the gds object */
+    NULL                  /* not pooled */
 };
 
 /*
@@ -62,6 +66,7 @@ static const int increment = 10;
  */
 static void save_class(gds_class_t *cls);
 static void expand_array(void);
+static void gds_obj_pool_finalize(void);
 
 
 /*
@@ -155,6 +160,8 @@ int gds_class_finalize(void)
 {
     int i;
 
+    gds_obj_pool_finalize();
+
     if (NULL != classes) {
         for (i = 0; i < num_classes; ++i) {
             if (NULL != classes[i]) {
@@ -197,3 +204,280 @@ static void expand_array(void)
     }
 }
 
+
+/*
+ * Object pools.
+ *
+ * Each thread keeps, for every pooled class, a list of up to
+ * GDS_OBJ_POOL_BATCH free objects it is handing out and taking back,
+ * plus at most one full batch in reserve. Only when both are full
+ * (or both empty) does it go to the depot in the class's pool, and
+ * then it trades a whole batch at once. Objects may be released by a
+ * different thread from the one that created them - they simply join
+ * the releasing thread's cache.
+ *
+ * With debugging enabled, objects are always malloc'd and freed, so
+ * that memory checkers can still see use after release.
+ */
+
+#if GDS_ENABLE_DEBUG
+
+void *gds_obj_pool_get(gds_class_t *cls)
+{
+    return malloc(cls->cls_sizeof);
+}
+
+void gds_obj_pool_put(gds_object_t *object)
+{
+    free(object);
+}
+
+static void gds_obj_pool_finalize(void)
+{
+}
+
+#else
+
+#define GDS_OBJ_POOL_MAX    32  /* most pooled classes in a process */
+#define GDS_OBJ_POOL_BATCH  32  /* objects moved to or from the depot at once */
+#define GDS_OBJ_POOL_DEPOT  16  /* most batches kept in a depot */
+
+/* a free object is overlaid with the links that hold it in the pool -
+ * every class is at least as big as gds_object_t, which has room */
+typedef struct gds_obj_free_t {
+    struct gds_obj_free_t *of_next;         /* next object in its batch */
+    struct gds_obj_free_t *of_next_batch;   /* first object of the next batch */
+} gds_obj_free_t;
+
+typedef struct {
+    gds_obj_free_t *oc_cur;     /* objects being handed out and taken back */
+    int oc_ncur;                /* number of them */
+    gds_obj_free_t *oc_full;    /* a full batch in reserve, or NULL */
+} gds_obj_cache_t;
+
+/* a thread's caches, indexed by pool id. The key is only there so
+ * that they are flushed when the thread exits */
+static __thread gds_obj_cache_t gds_obj_caches[GDS_OBJ_POOL_MAX + 1];
+static __thread int gds_obj_caches_active = 0;
+static pthread_key_t gds_obj_cache_key;
+static pthread_once_t gds_obj_cache_once = PTHREAD_ONCE_INIT;
+static int gds_obj_cache_key_valid = 0;
+
+static gds_obj_pool_t *gds_obj_pools[GDS_OBJ_POOL_MAX + 1];
+static int gds_obj_npools = 0;
+/* set by gds_class_finalize - from then on nothing is pooled */
+static int gds_obj_pools_closed = 0;
+static pthread_mutex_t gds_obj_pools_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void gds_obj_depot_lock(gds_obj_pool_t *pool)
+{
+    while (__atomic_exchange_n(&pool->op_lock, 1, __ATOMIC_ACQUIRE)) {
+        while (__atomic_load_n(&pool->op_lock, __ATOMIC_RELAXED)) {
+            sched_yield();
+        }
+    }
+}
+
+static void gds_obj_depot_unlock(gds_obj_pool_t *pool)
+{
+    __atomic_store_n(&pool->op_lock, 0, __ATOMIC_RELEASE);
+}
+
+static void gds_obj_free_list(gds_obj_free_t *item)
+{
+    gds_obj_free_t *next;
+
+    for (; NULL != item; item = next) {
+        next = item->of_next;
+        free(item);
+    }
+}
+
+/* park a full batch in the depot - or, if that is full too or the
+ * pools have been finalized, give it back to malloc */
+static void gds_obj_depot_push(gds_obj_pool_t *pool, gds_obj_free_t *batch)
+{
+    gds_obj_depot_lock(pool);
+    if (pool->op_ndepot < GDS_OBJ_POOL_DEPOT &&
+        !__atomic_load_n(&gds_obj_pools_closed, __ATOMIC_RELAXED)) {
+        batch->of_next_batch = (gds_obj_free_t*)pool->op_depot;
+        pool->op_depot = batch;
+        pool->op_ndepot++;
+        batch = NULL;
+    }
+    gds_obj_depot_unlock(pool);
+    gds_obj_free_list(batch);
+}
+
+static gds_obj_free_t *gds_obj_depot_pop(gds_obj_pool_t *pool)
+{
+    gds_obj_free_t *batch;
+
+    /* an unlocked peek saves taking the lock for an empty depot */
+    if (0 == __atomic_load_n(&pool->op_ndepot, __ATOMIC_RELAXED)) {
+        return NULL;
+    }
+    gds_obj_depot_lock(pool);
+    batch = (gds_obj_free_t*)pool->op_depot;
+    if (NULL != batch) {
+        pool->op_depot = batch->of_next_batch;
+        pool->op_ndepot--;
+    }
+    gds_obj_depot_unlock(pool);
+    return batch;
+}
+
+/* hand what an exiting thread had cached on to the depots */
+static void gds_obj_cache_flush(gds_obj_cache_t *caches)
+{
+    gds_obj_pool_t *pool;
+    int id, npools;
+
+    npools = __atomic_load_n(&gds_obj_npools, __ATOMIC_ACQUIRE);
+    for (id = 1; id <= npools && id <= GDS_OBJ_POOL_MAX; id++) {
+        pool = gds_obj_pools[id];
+        if (NULL != caches[id].oc_full) {
+            gds_obj_depot_push(pool, caches[id].oc_full);
+        }
+        if (GDS_OBJ_POOL_BATCH == caches[id].oc_ncur) {
+            gds_obj_depot_push(pool, caches[id].oc_cur);
+        } else {
+            gds_obj_free_list(caches[id].oc_cur);
+        }
+        caches[id].oc_cur = caches[id].oc_full = NULL;
+        caches[id].oc_ncur = 0;
+    }
+}
+
+static void gds_obj_thread_exit(void *ptr)
+{
+    gds_obj_cache_flush((gds_obj_cache_t*)ptr);
+    gds_obj_caches_active = 0;
+}
+
+static void gds_obj_cache_key_create(void)
+{
+    gds_obj_cache_key_valid =
+        (0 == pthread_key_create(&gds_obj_cache_key, gds_obj_thread_exit));
+}
+
+/* a thread may only keep objects once it is sure to hand them back
+ * when it exits */
+static int gds_obj_caches_activate(void)
+{
+    pthread_once(&gds_obj_cache_once, gds_obj_cache_key_create);
+    if (!gds_obj_cache_key_valid ||
+        0 != pthread_setspecific(gds_obj_cache_key, gds_obj_caches)) {
+        return 0;
+    }
+    gds_obj_caches_active = 1;
+    return 1;
+}
+
+/* the pool's slot in every thread's caches, given out the first time
+ * the pool is used - or -1 once they have all gone, in which case
+ * the class is just malloc'd and freed */
+static int gds_obj_pool_id(gds_obj_pool_t *pool)
+{
+    int id;
+
+    id = __atomic_load_n(&pool->op_id, __ATOMIC_ACQUIRE);
+    if (GDS_LIKELY(0 != id)) {
+        return id;
+    }
+    pthread_mutex_lock(&gds_obj_pools_lock);
+    if (0 == (id = pool->op_id)) {
+        if (gds_obj_npools < GDS_OBJ_POOL_MAX) {
+            id = gds_obj_npools + 1;
+            gds_obj_pools[id] = pool;
+            __atomic_store_n(&gds_obj_npools, id, __ATOMIC_RELEASE);
+        } else {
+            id = -1;
+        }
+        __atomic_store_n(&pool->op_id, id, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&gds_obj_pools_lock);
+    return id;
+}
+
+void *gds_obj_pool_get(gds_class_t *cls)
+{
+    gds_obj_cache_t *c;
+    gds_obj_free_t *item;
+    int id;
+
+    id = gds_obj_pool_id(cls->cls_pool);
+    if (GDS_UNLIKELY(id < 0)) {
+        return malloc(cls->cls_sizeof);
+    }
+    c = &gds_obj_caches[id];
+    if (NULL == c->oc_cur) {
+        if (NULL != c->oc_full) {
+            c->oc_cur = c->oc_full;
+            c->oc_full = NULL;
+        } else if (GDS_UNLIKELY(!gds_obj_caches_active && !gds_obj_caches_activate()) ||
+                   NULL == (c->oc_cur = gds_obj_depot_pop(cls->cls_pool))) {
+            /* a batch is only taken by a thread that will hand
+             * back what is left of it when it exits */
+            return malloc(cls->cls_sizeof);
+        }
+        c->oc_ncur = GDS_OBJ_POOL_BATCH;
+    }
+    item = c->oc_cur;
+    c->oc_cur = item->of_next;
+    c->oc_ncur--;
+    return item;
+}
+
+void gds_obj_pool_put(gds_object_t *object)
+{
+    gds_obj_pool_t *pool = object->obj_class->cls_pool;
+    gds_obj_cache_t *c;
+    gds_obj_free_t *item = (gds_obj_free_t*)object;
+    int id;
+
+    id = gds_obj_pool_id(pool);
+    if (GDS_UNLIKELY(id < 0 || (!gds_obj_caches_active && !gds_obj_caches_activate()))) {
+        free(object);
+        return;
+    }
+    c = &gds_obj_caches[id];
+    if (GDS_OBJ_POOL_BATCH == c->oc_ncur) {
+        if (NULL != c->oc_full) {
+            gds_obj_depot_push(pool, c->oc_full);
+        }
+        c->oc_full = c->oc_cur;
+        c->oc_cur = NULL;
+        c->oc_ncur = 0;
+    }
+    item->of_next = c->oc_cur;
+    c->oc_cur = item;
+    c->oc_ncur++;
+}
+
+/* stop pooling, and return everything this thread has cached, and
+ * every depot, to malloc. The caches of other threads still running
+ * cannot be reached from here - they are freed as each of those
+ * threads exits, since the depots no longer take anything */
+static void gds_obj_pool_finalize(void)
+{
+    gds_obj_free_t *batch;
+    int id, npools;
+
+    pthread_mutex_lock(&gds_obj_pools_lock);
+    npools = gds_obj_npools;
+    for (id = 1; id <= npools; id++) {
+        __atomic_store_n(&gds_obj_pools[id]->op_id, -1, __ATOMIC_RELEASE);
+    }
+    __atomic_store_n(&gds_obj_pools_closed, 1, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&gds_obj_pools_lock);
+
+    gds_obj_cache_flush(gds_obj_caches);
+    for (id = 1; id <= npools; id++) {
+        while (NULL != (batch = gds_obj_depot_pop(gds_obj_pools[id]))) {
+            gds_obj_free_list(batch);
+        }
+    }
+}
+
+#endif  /* GDS_ENABLE_DEBUG */
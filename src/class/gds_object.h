@@ -62,7 +62,8 @@
  *     sally_construct,
  *     sally_destruct,
  *     0, 0, NULL, NULL,
- *     sizeof ("sally_t")
+ *     sizeof ("sally_t"),
+ *     NULL
  *   };
  * @endcode
  * This variable should be declared in the interface (.h) file using
@@ -94,9 +95,27 @@
  * When the reference count reaches zero, the class's destructor, and
  * those of its parents, are run and the memory is freed.
  *
+ * Unless GDS was configured with --disable-atomic-refcount, the count
+ * is updated atomically, so an object may be retained and released
+ * by several threads at once. Objects that never leave the thread
+ * that made them can use GDS_RETAIN_LOCAL and GDS_RELEASE_LOCAL
+ * instead, which skip the atomic operations. An object must not be
+ * updated both ways at the same time.
+ *
  * N.B. There is no explicit free/delete method for dynamic objects in
  * this model.
  *
+ * Classes whose objects are created and released at a high rate can
+ * have their memory recycled rather than returned to malloc, by
+ * instantiating the descriptor with GDS_CLASS_INSTANCE_POOLED instead:
+ * @code
+ *   GDS_CLASS_INSTANCE_POOLED(sally_t, parent_t, sally_construct, sally_destruct);
+ * @endcode
+ * The final GDS_RELEASE of such an object then runs the destructors as
+ * usual, and keeps the memory in a cache private to the calling thread,
+ * from which the next GDS_NEW of the class is served. Only objects of
+ * exactly that class are pooled - subclasses need pooling of their own.
+ *
  * (c) Class instantiation: static
  *
  * For an object with static (or stack) allocation, it is only
@@ -137,6 +156,7 @@ BEGIN_C_DECLS
 
 typedef struct gds_object_t gds_object_t;
 typedef struct gds_class_t gds_class_t;
+typedef struct gds_obj_pool_t gds_obj_pool_t;
 typedef void (*gds_construct_t) (gds_object_t *);
 typedef void (*gds_destruct_t) (gds_object_t *);
 
@@ -161,6 +181,21 @@ struct gds_class_t {
     gds_destruct_t *cls_destruct_array;
                                     /**< array of parent class destructors */
     size_t cls_sizeof;              /**< size of an object instance */
+    gds_obj_pool_t *cls_pool;       /**< free objects kept for reuse, or
+                                         NULL if the class is not pooled */
+};
+
+/**
+ * Free objects of a pooled class. Each thread caches up to a couple
+ * of batches of them, and trades whole batches with the shared depot
+ * here - so the lock is only taken once per batch.
+ */
+struct gds_obj_pool_t {
+    int op_id;                      /**< which of each thread's caches is
+                                         ours - 0 until first used */
+    int op_lock;                    /**< protects the depot */
+    void *op_depot;                 /**< batches no thread is caching */
+    int op_ndepot;                  /**< number of batches in the depot */
 };
 
 /**
@@ -222,7 +257,31 @@ struct gds_object_t {
         (gds_construct_t) CONSTRUCTOR,                                 \
         (gds_destruct_t) DESTRUCTOR,                                   \
         0, 0, NULL, NULL,                                               \
-        sizeof(NAME)                                                    \
+        sizeof(NAME),                                                   \
+        NULL                                                            \
+    }
+
+
+/**
+ * Static initializer for the descriptor of a pooled class - one
+ * whose released objects are kept for reuse rather than freed
+ *
+ * @param NAME          Name of class
+ * @param PARENT        Name of parent class
+ * @param CONSTRUCTOR   Pointer to constructor
+ * @param DESTRUCTOR    Pointer to destructor
+ *
+ * Put this in NAME.c
+ */
+#define GDS_CLASS_INSTANCE_POOLED(NAME, PARENT, CONSTRUCTOR, DESTRUCTOR) \
+    gds_class_t NAME ## _class = {                                     \
+        # NAME,                                                         \
+        GDS_CLASS(PARENT),                                              \
+        (gds_construct_t) CONSTRUCTOR,                                 \
+        (gds_destruct_t) DESTRUCTOR,                                   \
+        0, 0, NULL, NULL,                                               \
+        sizeof(NAME),                                                   \
+        &(gds_obj_pool_t){ 0, 0, NULL, 0 }                             \
     }
 
 
@@ -266,16 +325,26 @@ static inline gds_object_t *gds_obj_new_debug(gds_class_t* type, const char* fil
  *
  * @param object        Pointer to the object
  */
+#define GDS_RETAIN(object)  GDS_RETAIN_INTERNAL(object, gds_obj_update)
+
+/**
+ * Retain an object that only the calling thread can see, without
+ * the cost of an atomic update
+ *
+ * @param object        Pointer to the object
+ */
+#define GDS_RETAIN_LOCAL(object)  GDS_RETAIN_INTERNAL(object, gds_obj_update_local)
+
 #if GDS_ENABLE_DEBUG
-#define GDS_RETAIN(object)                                              \
+#define GDS_RETAIN_INTERNAL(object, update)                             \
     do {                                                                \
         assert(NULL != ((gds_object_t *) (object))->obj_class);        \
         assert(GDS_OBJ_MAGIC_ID == ((gds_object_t *) (object))->obj_magic_id); \
-        gds_obj_update((gds_object_t *) (object), 1);                 \
+        update((gds_object_t *) (object), 1);                           \
         assert(((gds_object_t *) (object))->obj_reference_count >= 0); \
     } while (0)
 #else
-#define GDS_RETAIN(object)  gds_obj_update((gds_object_t *) (object), 1);
+#define GDS_RETAIN_INTERNAL(object, update)  update((gds_object_t *) (object), 1);
 #endif
 
 /**
@@ -307,25 +376,35 @@ static inline gds_object_t *gds_obj_new_debug(gds_class_t* type, const char* fil
  *
  * @param object        Pointer to the object
  */
+#define GDS_RELEASE(object)  GDS_RELEASE_INTERNAL(object, gds_obj_update)
+
+/**
+ * Release an object that only the calling thread can see, without
+ * the cost of an atomic update
+ *
+ * @param object        Pointer to the object
+ */
+#define GDS_RELEASE_LOCAL(object)  GDS_RELEASE_INTERNAL(object, gds_obj_update_local)
+
 #if GDS_ENABLE_DEBUG
-#define GDS_RELEASE(object)                                             \
+#define GDS_RELEASE_INTERNAL(object, update)                            \
     do {                                                                \
         assert(NULL != ((gds_object_t *) (object))->obj_class);        \
         assert(GDS_OBJ_MAGIC_ID == ((gds_object_t *) (object))->obj_magic_id); \
-        if (0 == gds_obj_update((gds_object_t *) (object), -1)) {     \
+        if (0 == update((gds_object_t *) (object), -1)) {               \
             GDS_SET_MAGIC_ID((object), 0);                              \
             gds_obj_run_destructors((gds_object_t *) (object));       \
             GDS_REMEMBER_FILE_AND_LINENO( object, __FILE__, __LINE__ ); \
-            free(object);                                               \
+            gds_obj_free((gds_object_t *) (object));                  \
             object = NULL;                                              \
         }                                                               \
     } while (0)
 #else
-#define GDS_RELEASE(object)                                             \
+#define GDS_RELEASE_INTERNAL(object, update)                            \
     do {                                                                \
-        if (0 == gds_obj_update((gds_object_t *) (object), -1)) {     \
+        if (0 == update((gds_object_t *) (object), -1)) {               \
             gds_obj_run_destructors((gds_object_t *) (object));       \
-            free(object);                                               \
+            gds_obj_free((gds_object_t *) (object));                  \
             object = NULL;                                              \
         }                                                               \
     } while (0)
@@ -400,9 +479,53 @@ void gds_class_initialize(gds_class_t *);
  * classes, rendering all of them inoperable.  It is here so that
  * tools like valgrind and purify don't report still-reachable memory
  * upon process termination.
+ *
+ * The free objects of pooled classes are returned to malloc too -
+ * those cached by the calling thread and those in the shared depots.
+ * Other threads' caches cannot be reached: those are freed as each
+ * thread exits, and from here on pooled classes are simply malloc'd
+ * and freed.
  */
 int gds_class_finalize(void);
 
+/**
+ * Take memory for an object of a pooled class, from the calling
+ * thread's cache if there is any there.
+ *
+ * Do not use this function directly: use GDS_NEW() instead.
+ *
+ * @param cls           Pointer to the class descriptor
+ * @return              Uninitialized memory for the object
+ */
+void *gds_obj_pool_get(gds_class_t *cls);
+
+/**
+ * Give the memory of a destructed object of a pooled class back to
+ * the calling thread's cache.
+ *
+ * Do not use this function directly: use GDS_RELEASE() instead.
+ *
+ * @param object        Pointer to the object
+ */
+void gds_obj_pool_put(gds_object_t *object);
+
+/**
+ * Free the memory of a destructed object, or keep it for reuse if
+ * its class is pooled.
+ *
+ * Do not use this function directly: use GDS_RELEASE() instead.
+ *
+ * @param object        Pointer to the object
+ */
+static inline void gds_obj_free(gds_object_t *object)
+{
+    if (NULL == object->obj_class->cls_pool) {
+        free(object);
+    } else {
+        gds_obj_pool_put(object);
+    }
+}
+
 /**
  * Run the hierarchy of class constructors for this object, in a
  * parent-first order.
@@ -466,7 +589,11 @@ static inline gds_object_t *gds_obj_new(gds_class_t * cls)
     gds_object_t *object;
     assert(cls->cls_sizeof >= sizeof(gds_object_t));
 
-    object = (gds_object_t *) malloc(cls->cls_sizeof);
+    if (NULL == cls->cls_pool) {
+        object = (gds_object_t *) malloc(cls->cls_sizeof);
+    } else {
+        object = (gds_object_t *) gds_obj_pool_get(cls);
+    }
     if (0 == cls->cls_initialized) {
         gds_class_initialize(cls);
     }
@@ -482,6 +609,11 @@ static inline gds_object_t *gds_obj_new(gds_class_t * cls)
 /**
  * Atomically update the object's reference count by some increment.
  *
+ * Taking a reference needs no ordering, as the caller already holds
+ * one. Dropping one is a release, so that this thread's writes to
+ * the object happen before whichever thread destructs it - and an
+ * acquire, for when that is this thread.
+ *
  * This function should not be used directly: it is called via the
  * macros GDS_RETAIN and GDS_RELEASE
  *
@@ -491,6 +623,29 @@ static inline gds_object_t *gds_obj_new(gds_class_t * cls)
  */
 static inline int gds_obj_update(gds_object_t *object, int inc) __gds_attribute_always_inline__;
 static inline int gds_obj_update(gds_object_t *object, int inc)
+{
+#if GDS_ENABLE_ATOMIC_REFCOUNT
+    if (inc > 0) {
+        return __atomic_add_fetch(&object->obj_reference_count, inc, __ATOMIC_RELAXED);
+    }
+    return __atomic_add_fetch(&object->obj_reference_count, inc, __ATOMIC_ACQ_REL);
+#else
+    return object->obj_reference_count += inc;
+#endif
+}
+
+/**
+ * Update the reference count of an object no other thread can see.
+ *
+ * This function should not be used directly: it is called via the
+ * macros GDS_RETAIN_LOCAL and GDS_RELEASE_LOCAL
+ *
+ * @param object        Pointer to the object
+ * @param inc           Increment by which to update reference count
+ * @return              New value of the reference count
+ */
+static inline int gds_obj_update_local(gds_object_t *object, int inc) __gds_attribute_always_inline__;
+static inline int gds_obj_update_local(gds_object_t *object, int inc)
 {
     return object->obj_reference_count += inc;
 }
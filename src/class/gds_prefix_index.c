@@ -0,0 +1,166 @@
+/* -*- Mode: C; c-basic-offset:4 ; -*- */
+/*
+ * Copyright (c) 2016      Intel, Inc. All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+#include <src/include/gds_config.h>
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include "gds_common.h"
+#include "src/class/gds_prefix_index.h"
+
+/* initial number of entries to allocate */
+#define GDS_PREFIX_INDEX_MIN_CAPACITY   8
+
+static void gds_prefix_index_construct(gds_prefix_index_t *pi);
+static void gds_prefix_index_destruct(gds_prefix_index_t *pi);
+
+GDS_CLASS_INSTANCE(gds_prefix_index_t, gds_object_t,
+                   gds_prefix_index_construct,
+                   gds_prefix_index_destruct);
+
+static void gds_prefix_index_construct(gds_prefix_index_t *pi)
+{
+    pi->pi_size = 0;
+    pi->pi_capacity = 0;
+    pi->pi_entries = NULL;
+}
+
+static void gds_prefix_index_destruct(gds_prefix_index_t *pi)
+{
+    if (NULL != pi->pi_entries) {
+        free(pi->pi_entries);
+        pi->pi_entries = NULL;
+    }
+    pi->pi_capacity = 0;
+    pi->pi_size = 0;
+}
+
+/* position of the first entry whose key is not less than the
+ * given key, and whether that entry is an exact match */
+static size_t gds_prefix_index_search(gds_prefix_index_t *pi,
+                                      const char *key, bool *found)
+{
+    size_t lo = 0, hi = pi->pi_size, mid;
+    int cmp;
+
+    *found = false;
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        cmp = strcmp(pi->pi_entries[mid].key, key);
+        if (cmp < 0) {
+            lo = mid + 1;
+        } else {
+            if (0 == cmp) {
+                *found = true;
+                return mid;
+            }
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+int gds_prefix_index_set(gds_prefix_index_t *pi, const char *key, void *value)
+{
+    gds_prefix_index_entry_t *entries;
+    size_t idx, capacity;
+    bool found;
+
+    if (NULL == key) {
+        return GDS_ERR_BAD_PARAM;
+    }
+
+    idx = gds_prefix_index_search(pi, key, &found);
+    if (found) {
+        pi->pi_entries[idx].key = key;
+        pi->pi_entries[idx].value = value;
+        return GDS_SUCCESS;
+    }
+
+    if (pi->pi_size == pi->pi_capacity) {
+        capacity = (0 == pi->pi_capacity) ? GDS_PREFIX_INDEX_MIN_CAPACITY : 2 * pi->pi_capacity;
+        entries = (gds_prefix_index_entry_t*)realloc(pi->pi_entries,
+                                                     capacity * sizeof(gds_prefix_index_entry_t));
+        if (NULL == entries) {
+            return GDS_ERR_OUT_OF_RESOURCE;
+        }
+        pi->pi_entries = entries;
+        pi->pi_capacity = capacity;
+    }
+
+    memmove(&pi->pi_entries[idx+1], &pi->pi_entries[idx],
+            (pi->pi_size - idx) * sizeof(gds_prefix_index_entry_t));
+    pi->pi_entries[idx].key = key;
+    pi->pi_entries[idx].value = value;
+    pi->pi_size++;
+    return GDS_SUCCESS;
+}
+
+void* gds_prefix_index_remove(gds_prefix_index_t *pi, const char *key)
+{
+    void *value;
+    size_t idx;
+    bool found;
+
+    if (NULL == key) {
+        return NULL;
+    }
+    idx = gds_prefix_index_search(pi, key, &found);
+    if (!found) {
+        return NULL;
+    }
+    value = pi->pi_entries[idx].value;
+    pi->pi_size--;
+    memmove(&pi->pi_entries[idx], &pi->pi_entries[idx+1],
+            (pi->pi_size - idx) * sizeof(gds_prefix_index_entry_t));
+    return value;
+}
+
+void gds_prefix_index_remove_all(gds_prefix_index_t *pi)
+{
+    pi->pi_size = 0;
+}
+
+size_t gds_prefix_index_find(gds_prefix_index_t *pi,
+                             const char *prefix, size_t len,
+                             size_t *first)
+{
+    size_t lo, hi, mid, start;
+
+    /* all keys sharing the prefix are contiguous - find the
+     * first one that isn't ordered before the prefix... */
+    lo = 0;
+    hi = pi->pi_size;
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if (strncmp(pi->pi_entries[mid].key, prefix, len) < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    start = lo;
+
+    /* ...and the first one beyond it */
+    hi = pi->pi_size;
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if (strncmp(pi->pi_entries[mid].key, prefix, len) <= 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    *first = start;
+    return lo - start;
+}
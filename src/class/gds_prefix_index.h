@@ -0,0 +1,109 @@
+/* -*- Mode: C; c-basic-offset:4 ; -*- */
+/*
+ * Copyright (c) 2016      Intel, Inc. All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+/** @file
+ *
+ * An ordered index of string keys, used to answer prefix queries
+ * (e.g., "btl.*") without visiting every key. Entries are kept in
+ * a sorted array, so all keys sharing a prefix occupy a contiguous
+ * range that can be located with a pair of binary searches.
+ *
+ * The index owns neither the keys nor the values - each key must
+ * remain valid (and unchanged) for as long as it is in the index.
+ * Interned keys (see src/util/atom.h) satisfy this trivially.
+ */
+
+#ifndef GDS_PREFIX_INDEX_H
+#define GDS_PREFIX_INDEX_H
+
+#include <src/include/gds_config.h>
+
+#include "src/class/gds_object.h"
+
+BEGIN_C_DECLS
+
+typedef struct {
+    const char *key;
+    void *value;
+} gds_prefix_index_entry_t;
+
+struct gds_prefix_index_t {
+    gds_object_t super;
+    size_t pi_size;                         /**< number of entries */
+    size_t pi_capacity;                     /**< allocated entries */
+    gds_prefix_index_entry_t *pi_entries;   /**< sorted by key */
+};
+typedef struct gds_prefix_index_t gds_prefix_index_t;
+GDS_CLASS_DECLARATION(gds_prefix_index_t);
+
+/**
+ * Returns the number of entries currently in the index.
+ */
+static inline size_t gds_prefix_index_get_size(gds_prefix_index_t *pi)
+{
+    return pi->pi_size;
+}
+
+/**
+ * Returns the value of the entry at the given position. Positions
+ * are in key order and are invalidated by any modification.
+ */
+static inline void* gds_prefix_index_get_value(gds_prefix_index_t *pi, size_t idx)
+{
+    return pi->pi_entries[idx].value;
+}
+
+/**
+ * Returns the key of the entry at the given position.
+ */
+static inline const char* gds_prefix_index_get_key(gds_prefix_index_t *pi, size_t idx)
+{
+    return pi->pi_entries[idx].key;
+}
+
+/**
+ * Associate a value with a key, replacing any existing value.
+ *
+ * @param pi    The index (IN)
+ * @param key   The key - must outlive its entry (IN)
+ * @param value The value (IN)
+ * @return      GDS return code
+ */
+int gds_prefix_index_set(gds_prefix_index_t *pi, const char *key, void *value);
+
+/**
+ * Remove a key from the index.
+ *
+ * @return The value that was removed, or NULL if the key
+ *         was not present
+ */
+void* gds_prefix_index_remove(gds_prefix_index_t *pi, const char *key);
+
+/**
+ * Remove all entries from the index.
+ */
+void gds_prefix_index_remove_all(gds_prefix_index_t *pi);
+
+/**
+ * Locate the entries whose keys begin with a prefix.
+ *
+ * @param pi     The index (IN)
+ * @param prefix The prefix - need not be NULL-terminated (IN)
+ * @param len    Length of the prefix (IN)
+ * @param first  Position of the first matching entry (OUT)
+ * @return       Number of matching entries, which occupy
+ *               positions first .. first+n-1
+ */
+size_t gds_prefix_index_find(gds_prefix_index_t *pi,
+                             const char *prefix, size_t len,
+                             size_t *first);
+
+END_C_DECLS
+
+#endif /* GDS_PREFIX_INDEX_H */
@@ -0,0 +1,122 @@
+/* -*- Mode: C; c-basic-offset:4 ; -*- */
+/*
+ * Copyright (c) 2016      Intel, Inc. All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+#include <src/include/gds_config.h>
+
+#include <stdlib.h>
+
+#include "gds_common.h"
+#include "src/class/gds_slab.h"
+
+/* every chunk starts with a link to the next chunk, padded
+ * so the items that follow are suitably aligned */
+typedef union {
+    void *next;
+    long double ld;
+} gds_slab_chunk_hdr_t;
+
+static void gds_slab_construct(gds_slab_t *slab);
+static void gds_slab_destruct(gds_slab_t *slab);
+
+GDS_CLASS_INSTANCE(gds_slab_t, gds_object_t,
+                   gds_slab_construct,
+                   gds_slab_destruct);
+
+static void gds_slab_construct(gds_slab_t *slab)
+{
+    slab->sl_item_size = 0;
+    slab->sl_items_per_chunk = GDS_SLAB_ITEMS_PER_CHUNK;
+    slab->sl_free = NULL;
+    slab->sl_chunks = NULL;
+    slab->sl_nchunks = 0;
+    slab->sl_in_use = 0;
+}
+
+static void gds_slab_destruct(gds_slab_t *slab)
+{
+    gds_slab_chunk_hdr_t *chunk;
+
+    while (NULL != (chunk = (gds_slab_chunk_hdr_t*)slab->sl_chunks)) {
+        slab->sl_chunks = chunk->next;
+        free(chunk);
+    }
+    slab->sl_free = NULL;
+    slab->sl_nchunks = 0;
+    slab->sl_in_use = 0;
+}
+
+int gds_slab_init(gds_slab_t *slab, size_t item_size, size_t items_per_chunk)
+{
+    size_t align = sizeof(gds_slab_chunk_hdr_t);
+
+    if (0 == item_size || NULL != slab->sl_chunks) {
+        return GDS_ERR_BAD_PARAM;
+    }
+    /* items must be able to hold the free-list link, and
+     * each must be as aligned as the first */
+    if (item_size < sizeof(void*)) {
+        item_size = sizeof(void*);
+    }
+    slab->sl_item_size = (item_size + align - 1) / align * align;
+    if (0 < items_per_chunk) {
+        slab->sl_items_per_chunk = items_per_chunk;
+    }
+    return GDS_SUCCESS;
+}
+
+static int gds_slab_grow(gds_slab_t *slab)
+{
+    gds_slab_chunk_hdr_t *chunk;
+    char *item;
+    size_t n;
+
+    chunk = (gds_slab_chunk_hdr_t*)malloc(sizeof(gds_slab_chunk_hdr_t) +
+                                          slab->sl_item_size * slab->sl_items_per_chunk);
+    if (NULL == chunk) {
+        return GDS_ERR_OUT_OF_RESOURCE;
+    }
+    chunk->next = slab->sl_chunks;
+    slab->sl_chunks = chunk;
+    slab->sl_nchunks++;
+
+    /* thread the new items onto the free list */
+    item = (char*)(chunk + 1);
+    for (n=0; n < slab->sl_items_per_chunk; n++) {
+        *(void**)item = slab->sl_free;
+        slab->sl_free = item;
+        item += slab->sl_item_size;
+    }
+    return GDS_SUCCESS;
+}
+
+void* gds_slab_alloc(gds_slab_t *slab)
+{
+    void *item;
+
+    if (NULL == slab->sl_free) {
+        if (0 == slab->sl_item_size || GDS_SUCCESS != gds_slab_grow(slab)) {
+            return NULL;
+        }
+    }
+    item = slab->sl_free;
+    slab->sl_free = *(void**)item;
+    slab->sl_in_use++;
+    return item;
+}
+
+void gds_slab_free(gds_slab_t *slab, void *item)
+{
+    if (NULL == item) {
+        return;
+    }
+    *(void**)item = slab->sl_free;
+    slab->sl_free = item;
+    slab->sl_in_use--;
+}
@@ -0,0 +1,77 @@
+/* -*- Mode: C; c-basic-offset:4 ; -*- */
+/*
+ * Copyright (c) 2016      Intel, Inc. All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+/** @file
+ *
+ * Fixed-size item allocator. Items are carved from large chunks
+ * and recycled through a free list, so allocation and release
+ * are a couple of pointer operations and never reach malloc once
+ * the slab has warmed up. Chunks are only returned to the system
+ * when the slab itself is destructed.
+ */
+
+#ifndef GDS_SLAB_H
+#define GDS_SLAB_H
+
+#include <src/include/gds_config.h>
+
+#include "src/class/gds_object.h"
+
+BEGIN_C_DECLS
+
+/* default number of items in each chunk */
+#define GDS_SLAB_ITEMS_PER_CHUNK    256
+
+struct gds_slab_t {
+    gds_object_t super;
+    size_t sl_item_size;            /**< size of each item */
+    size_t sl_items_per_chunk;      /**< items carved from each chunk */
+    void *sl_free;                  /**< list of released items */
+    void *sl_chunks;                /**< list of allocated chunks */
+    size_t sl_nchunks;              /**< number of allocated chunks */
+    size_t sl_in_use;               /**< number of items handed out */
+};
+typedef struct gds_slab_t gds_slab_t;
+GDS_CLASS_DECLARATION(gds_slab_t);
+
+/**
+ * Define the size of the items to be allocated from the slab.
+ * Must be called before the first allocation.
+ *
+ * @param slab            The slab (IN)
+ * @param item_size       Size of each item (IN)
+ * @param items_per_chunk Number of items to allocate at a time,
+ *                        or 0 for the default (IN)
+ * @return GDS return code
+ */
+int gds_slab_init(gds_slab_t *slab, size_t item_size, size_t items_per_chunk);
+
+/**
+ * Get an item from the slab. The memory is not initialized.
+ *
+ * @return Pointer to the item, or NULL if out of resources
+ */
+void* gds_slab_alloc(gds_slab_t *slab);
+
+/**
+ * Return an item to the slab
+ */
+void gds_slab_free(gds_slab_t *slab, void *item);
+
+/**
+ * Number of items currently handed out
+ */
+static inline size_t gds_slab_get_in_use(gds_slab_t *slab)
+{
+    return slab->sl_in_use;
+}
+
+END_C_DECLS
+
+#endif /* GDS_SLAB_H */
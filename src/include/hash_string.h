@@ -2,6 +2,7 @@
  * Copyright (c) 2004-2007 The University of Tennessee and The University
  *                         of Tennessee Research Foundation.  All rights
  *                         reserved.
+ * Copyright (c) 2016      Intel, Inc. All rights reserved.
  * $COPYRIGHT$
  *
  * Additional copyrights may follow
@@ -13,11 +14,134 @@
  *
  * Simple macros to quickly compute a hash value from a string.
  *
+ * The hashing itself is done by gds_hash_bytes, which consumes the
+ * key eight bytes at a time (in the manner of wyhash): each pair of
+ * words is folded together with a 64x64->128 bit multiply, so even
+ * a long key costs only a few multiplies rather than a loop
+ * iteration per byte. Keys of up to 16 bytes are read with a few
+ * overlapping loads and no loop at all.
+ *
+ * The words are read in native byte order, so hash values are only
+ * meaningful within a single architecture - they must never be
+ * stored or sent anywhere.
  */
 
 #ifndef GDS_HASH_STRING_H
 #define GDS_HASH_STRING_H
 
+#ifdef HAVE_STDINT_H
+#include <stdint.h>
+#endif
+#include <string.h>
+
+#define GDS_HASH_SECRET0 0xa0761d6478bd642fULL
+#define GDS_HASH_SECRET1 0xe7037ed1a0b428dbULL
+#define GDS_HASH_SECRET2 0x8ebc6af09c88c6e3ULL
+#define GDS_HASH_SECRET3 0x589965cc75374cc3ULL
+
+/* replace a and b with the low and high halves of their product */
+static inline void gds_hash_mul128(uint64_t *a, uint64_t *b)
+{
+#if defined(__SIZEOF_INT128__)
+    __uint128_t r = (__uint128_t)*a * *b;
+    *a = (uint64_t)r;
+    *b = (uint64_t)(r >> 64);
+#else
+    uint64_t ha = *a >> 32, hb = *b >> 32, la = (uint32_t)*a, lb = (uint32_t)*b;
+    uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    uint64_t t = rl + (rm0 << 32), lo, c = t < rl;
+
+    lo = t + (rm1 << 32);
+    c += lo < t;
+    *a = lo;
+    *b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+}
+
+static inline uint64_t gds_hash_mix64(uint64_t a, uint64_t b)
+{
+    gds_hash_mul128(&a, &b);
+    return a ^ b;
+}
+
+static inline uint64_t gds_hash_read8(const uint8_t *p)
+{
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint64_t gds_hash_read4(const uint8_t *p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+/**
+ *  Compute a 64 bit hash of a block of memory
+ *
+ *  @param key (IN)     The bytes to hash
+ *  @param len (IN)     How many there are
+ *  @param seed (IN)    Selects one of a family of hash functions -
+ *                      pass 0 unless several independent hashes
+ *                      of the same key are needed
+ *  @return             The hash value
+ */
+static inline uint64_t gds_hash_bytes(const void *key, size_t len, uint64_t seed)
+{
+    const uint8_t *p = (const uint8_t*)key;
+    uint64_t a, b, see1, see2;
+    size_t i;
+
+    seed ^= gds_hash_mix64(seed ^ GDS_HASH_SECRET0, GDS_HASH_SECRET1);
+    if (len <= 16) {
+        if (len >= 4) {
+            /* two pairs of (possibly overlapping) 4 byte reads
+             * between them cover every byte */
+            a = (gds_hash_read4(p) << 32) | gds_hash_read4(p + ((len >> 3) << 2));
+            b = (gds_hash_read4(p + len - 4) << 32) |
+                gds_hash_read4(p + len - 4 - ((len >> 3) << 2));
+        } else if (len > 0) {
+            a = ((uint64_t)p[0] << 16) | ((uint64_t)p[len >> 1] << 8) | p[len - 1];
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        i = len;
+        if (i > 48) {
+            /* three independent lanes, so that the multiplies
+             * can overlap in the pipeline */
+            see1 = see2 = seed;
+            do {
+                seed = gds_hash_mix64(gds_hash_read8(p) ^ GDS_HASH_SECRET1,
+                                      gds_hash_read8(p + 8) ^ seed);
+                see1 = gds_hash_mix64(gds_hash_read8(p + 16) ^ GDS_HASH_SECRET2,
+                                      gds_hash_read8(p + 24) ^ see1);
+                see2 = gds_hash_mix64(gds_hash_read8(p + 32) ^ GDS_HASH_SECRET3,
+                                      gds_hash_read8(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while (i > 48);
+            seed ^= see1 ^ see2;
+        }
+        while (i > 16) {
+            seed = gds_hash_mix64(gds_hash_read8(p) ^ GDS_HASH_SECRET1,
+                                  gds_hash_read8(p + 8) ^ seed);
+            p += 16;
+            i -= 16;
+        }
+        /* the last 16 bytes, overlapping what has been done */
+        a = gds_hash_read8(p + i - 16);
+        b = gds_hash_read8(p + i - 8);
+    }
+    a ^= GDS_HASH_SECRET1;
+    b ^= seed;
+    gds_hash_mul128(&a, &b);
+    return gds_hash_mix64(a ^ GDS_HASH_SECRET0 ^ len, b ^ GDS_HASH_SECRET1);
+}
+
 /**
  *  Compute the hash value and the string length simultaneously
  *
@@ -25,23 +149,13 @@
  *  @param hash (OUT)   Where the hash value will be stored (uint32_t)
  *  @param length (OUT) The computed length of the string (uint32_t)
  */
-#define GDS_HASH_STRLEN( str, hash, length ) \
-    do {                                      \
-        register const char *_str = (str);    \
-        register uint32_t    _hash = 0;       \
-        register uint32_t    _len = 0;        \
-                                              \
-        while( *_str ) {                      \
-            _len++;                           \
-            _hash += *_str++;                 \
-            _hash += (_hash << 10);           \
-            _hash ^= (_hash >> 6);            \
-        }                                     \
-                                              \
-        _hash += (_hash << 3);                \
-        _hash ^= (_hash >> 11);               \
-        (hash) = (_hash + (_hash << 15));     \
-        (length)  = _len;                     \
+#define GDS_HASH_STRLEN( str, hash, length )                 \
+    do {                                                      \
+        const char *_str = (str);                             \
+        size_t      _len = strlen(_str);                      \
+                                                              \
+        (hash) = (uint32_t)gds_hash_bytes(_str, _len, 0);     \
+        (length) = (uint32_t)_len;                            \
     } while (0)
 
 /**
@@ -50,20 +164,11 @@
  *  @param str (IN)     The string which will be parsed   (char*)
  *  @param hash (OUT)   Where the hash value will be stored (uint32_t)
  */
-#define GDS_HASH_STR( str, hash )            \
-    do {                                      \
-        register const char *_str = (str);    \
-        register uint32_t    _hash = 0;       \
-                                              \
-        while( *_str ) {                      \
-            _hash += *_str++;                 \
-            _hash += (_hash << 10);           \
-            _hash ^= (_hash >> 6);            \
-        }                                     \
-                                              \
-        _hash += (_hash << 3);                \
-        _hash ^= (_hash >> 11);               \
-        (hash) = (_hash + (_hash << 15));     \
+#define GDS_HASH_STR( str, hash )                            \
+    do {                                                      \
+        const char *_str = (str);                             \
+                                                              \
+        (hash) = (uint32_t)gds_hash_bytes(_str, strlen(_str), 0); \
     } while (0)
 
 #endif  /* GDS_HASH_STRING_H */
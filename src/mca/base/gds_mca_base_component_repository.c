@@ -41,7 +41,7 @@
 #include "src/mca/base/gds_mca_base_component_repository.h"
 #include "src/mca/gdl/base/base.h"
 #include "gds_common.h"
-#include "src/class/gds_hash_table.h"
+#include "src/class/gds_flat_hash_table.h"
 #include "src/util/basename.h"
 
 #if GDS_HAVE_GDL_SUPPORT
@@ -65,7 +65,7 @@ static bool initialized = false;
 
 #if GDS_HAVE_GDL_SUPPORT
 
-static gds_hash_table_t gds_mca_base_component_repository;
+static gds_flat_hash_table_t gds_mca_base_component_repository;
 
 /* two-level macro for stringifying a number */
 #define STRINGIFYX(x) #x
@@ -102,8 +102,8 @@ static int process_repository_item (const char *filename, void *data)
     }
 
     /* lookup the associated framework list and create if it doesn't already exist */
-    ret = gds_hash_table_get_value_ptr(&gds_mca_base_component_repository, type,
-                                        strlen (type), (void **) &component_list);
+    ret = gds_flat_hash_table_get_value_ptr(&gds_mca_base_component_repository, type,
+                                             strlen (type), (void **) &component_list);
     if (GDS_SUCCESS != ret) {
         component_list = GDS_NEW(gds_list_t);
         if (NULL == component_list) {
@@ -112,8 +112,8 @@ static int process_repository_item (const char *filename, void *data)
             return GDS_ERR_OUT_OF_RESOURCE;
         }
 
-        ret = gds_hash_table_set_value_ptr(&gds_mca_base_component_repository, type,
-                                            strlen (type), (void *) component_list);
+        ret = gds_flat_hash_table_set_value_ptr(&gds_mca_base_component_repository, type,
+                                                 strlen (type), (void *) component_list);
         if (GDS_SUCCESS != ret) {
             free (base);
             GDS_RELEASE(component_list);
@@ -232,8 +232,8 @@ int gds_mca_base_component_repository_init(void)
     }
     gds_gdl_base_select();
 
-    GDS_CONSTRUCT(&gds_mca_base_component_repository, gds_hash_table_t);
-    ret = gds_hash_table_init (&gds_mca_base_component_repository, 128);
+    GDS_CONSTRUCT(&gds_mca_base_component_repository, gds_flat_hash_table_t);
+    ret = gds_flat_hash_table_init (&gds_mca_base_component_repository, 128);
     if (GDS_SUCCESS != ret) {
         (void) gds_mca_base_framework_close(&gds_gdl_base_framework);
         return ret;
@@ -260,8 +260,8 @@ int gds_mca_base_component_repository_get_components (gds_mca_base_framework_t *
 {
     *framework_components = NULL;
 #if GDS_HAVE_GDL_SUPPORT
-    return gds_hash_table_get_value_ptr (&gds_mca_base_component_repository, framework->framework_name,
-                                          strlen (framework->framework_name), (void **) framework_components);
+    return gds_flat_hash_table_get_value_ptr (&gds_mca_base_component_repository, framework->framework_name,
+                                               strlen (framework->framework_name), (void **) framework_components);
 #endif
     return GDS_ERR_NOT_FOUND;
 }
@@ -291,8 +291,8 @@ static gds_mca_base_component_repository_item_t *find_component(const char *type
     gds_list_t *component_list;
     int ret;
 
-    ret = gds_hash_table_get_value_ptr (&gds_mca_base_component_repository, type,
-                                         strlen (type), (void **) &component_list);
+    ret = gds_flat_hash_table_get_value_ptr (&gds_mca_base_component_repository, type,
+                                              strlen (type), (void **) &component_list);
     if (GDS_SUCCESS != ret) {
         /* component does not exist in the repository */
         return NULL;
@@ -519,13 +519,13 @@ void gds_mca_base_component_repository_finalize(void)
     size_t key_size;
     int ret;
 
-    ret = gds_hash_table_get_first_key_ptr (&gds_mca_base_component_repository, &key, &key_size,
-                                             (void **) &component_list, &node);
+    ret = gds_flat_hash_table_get_first_key_ptr (&gds_mca_base_component_repository, &key, &key_size,
+                                                  (void **) &component_list, &node);
     while (GDS_SUCCESS == ret) {
         GDS_LIST_RELEASE(component_list);
-        ret = gds_hash_table_get_next_key_ptr (&gds_mca_base_component_repository, &key,
-                                                &key_size, (void **) &component_list,
-                                                node, &node);
+        ret = gds_flat_hash_table_get_next_key_ptr (&gds_mca_base_component_repository, &key,
+                                                     &key_size, (void **) &component_list,
+                                                     node, &node);
     }
 
     (void) gds_mca_base_framework_close(&gds_gdl_base_framework);
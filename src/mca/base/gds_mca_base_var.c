@@ -77,7 +77,7 @@ static gds_list_t gds_mca_base_var_override_values;
 
 static int gds_mca_base_var_count = 0;
 
-static gds_hash_table_t gds_mca_base_var_index_hash;
+static gds_flat_hash_table_t gds_mca_base_var_index_hash;
 
 const char *var_type_names[] = {
     "int",
@@ -260,9 +260,9 @@ int gds_mca_base_var_init(void)
         GDS_CONSTRUCT(&gds_mca_base_var_file_values, gds_list_t);
         GDS_CONSTRUCT(&gds_mca_base_envar_file_values, gds_list_t);
         GDS_CONSTRUCT(&gds_mca_base_var_override_values, gds_list_t);
-        GDS_CONSTRUCT(&gds_mca_base_var_index_hash, gds_hash_table_t);
+        GDS_CONSTRUCT(&gds_mca_base_var_index_hash, gds_flat_hash_table_t);
 
-        ret = gds_hash_table_init (&gds_mca_base_var_index_hash, 1024);
+        ret = gds_flat_hash_table_init (&gds_mca_base_var_index_hash, 1024);
         if (GDS_SUCCESS != ret) {
             return ret;
         }
@@ -914,8 +914,8 @@ static int var_find_by_name (const char *full_name, int *vari, bool invalidok)
     void *tmp;
     int rc;
 
-    rc = gds_hash_table_get_value_ptr (&gds_mca_base_var_index_hash, full_name, strlen (full_name),
-                                        &tmp);
+    rc = gds_flat_hash_table_get_value_ptr (&gds_mca_base_var_index_hash, full_name, strlen (full_name),
+                                             &tmp);
     if (GDS_SUCCESS != rc) {
         return rc;
     }
@@ -1426,8 +1426,8 @@ static int register_variable (const char *project_name, const char *framework_na
             assert (0);
         }
 
-        gds_hash_table_set_value_ptr (&gds_mca_base_var_index_hash, var->mbv_full_name, strlen (var->mbv_full_name),
-                                       (void *)(uintptr_t) var_index);
+        gds_flat_hash_table_set_value_ptr (&gds_mca_base_var_index_hash, var->mbv_full_name, strlen (var->mbv_full_name),
+                                            (void *)(uintptr_t) var_index);
     } else {
         ret = var_get (var_index, &var, false);
         if (GDS_SUCCESS != ret) {
@@ -44,6 +44,7 @@
 #include "src/class/gds_value_array.h"
 #include "src/class/gds_pointer_array.h"
 #include "src/class/gds_hash_table.h"
+#include "src/class/gds_flat_hash_table.h"
 #include "src/mca/base/gds_mca_base_var.h"
 
 BEGIN_C_DECLS
@@ -17,18 +17,26 @@
 #include "gds/constants.h"
 
 #include <time.h>
+#include <stdlib.h>
 #include <string.h>
+#include <pthread.h>
+#include <sched.h>
 
 #include "gds_stdint.h"
-#include "gds/class/gds_hash_table.h"
+#include "gds/class/gds_arena.h"
+#include "gds/class/gds_epoch.h"
+#include "gds/class/gds_key_index.h"
 #include "gds/class/gds_pointer_array.h"
+#include "gds/class/gds_prefix_index.h"
+#include "gds/class/gds_slab.h"
 #include "gds/dss/dss_types.h"
 #include "gds/util/error.h"
 #include "gds/util/output.h"
 #include "gds/util/show_help.h"
+#include "gds/util/atom.h"
 
 #include "gds/mca/gdstor/base/base.h"
-#include "gdstor_hash.h"
+#include "gdstor_lhash.h"
 
 static int init(void);
 static void finalize(void);
@@ -64,8 +72,94 @@ gds_gdstor_base_module_t gds_gdstor_hash_module = {
     NULL
 };
 
+typedef struct proc_dir_t proc_dir_t;
+
+/**
+ * The procs are spread across a number of shards by their id,
+ * each with its own directory and lock, so that operations on
+ * procs in different shards can proceed in parallel. Operations
+ * that modify a shard take its lock exclusively, and fetch_multiple
+ * (which walks more than the index) takes it shared - fetches take
+ * no lock at all, see "READ PATH" below.
+ */
+typedef struct {
+    pthread_rwlock_t lock;
+    /* serializes changes to the refcounts of objects that leases
+     * may be holding - leases retain them under no lock but the
+     * epoch, and release them under no lock at all */
+    pthread_mutex_t pin_lock;
+    /* the procs in this shard, by id */
+    proc_dir_t *procs;
+    /* the records of the values we own, for these procs */
+    gds_slab_t values;
+} shard_t;
+
 /* Local "globals" */
-static gds_hash_table_t hash_data;
+static shard_t *shards = NULL;
+static size_t nshards = 0;
+/* protects whatever the fetches may be looking at */
+static gds_epoch_t epoch;
+
+/**
+ * Payload bytes of the values we own. The arena is kept in an
+ * object of its own so that leases can hold on to it after the
+ * proc has moved on to a fresh one (or been removed entirely).
+ * Nothing in an arena is ever overwritten, so a leased payload
+ * cannot change under the reader.
+ */
+typedef struct {
+    gds_object_t super;
+    gds_arena_t arena;
+    /* queues the block to be released once compacted away */
+    gds_epoch_limbo_t retire;
+} payload_block_t;
+
+static void payload_block_construct(payload_block_t *ptr)
+{
+    OBJ_CONSTRUCT(&ptr->arena, gds_arena_t);
+}
+
+static void payload_block_destruct(payload_block_t *ptr)
+{
+    OBJ_DESTRUCT(&ptr->arena);
+}
+OBJ_CLASS_INSTANCE(payload_block_t, gds_object_t,
+                   payload_block_construct, payload_block_destruct);
+
+/**
+ * A value record we own, as allocated from the shard's slab.
+ * fetch_pointer hands out pointers that stay valid until the
+ * key itself changes - but compaction moves the payloads in the
+ * arena whenever any of the proc's keys changes. So a string or
+ * byte object it hands out is first given a copy of its own,
+ * which compaction never touches and which goes with the record.
+ */
+typedef struct {
+    gds_value_t kv;
+    /* queues the record to be released once replaced */
+    gds_epoch_limbo_t retire;
+    /* the payload handed out by fetch_pointer, if any */
+    void *exposed;
+} keyval_t;
+
+/**
+ * A lease on a fetched value - holds a reference on whatever
+ * owns the payload, plus a copy of anything that lives in the
+ * (recyclable) value record itself.
+ */
+typedef struct {
+    gds_object_t *pin;
+    shard_t *shard;
+    union {
+        uint64_t uint64;
+        uint32_t uint32;
+        uint16_t uint16;
+        int integer;
+        unsigned int uint;
+        float fval;
+        gds_byte_object_t bo;
+    } data;
+} lease_t;
 
 /**
  * Data for a particular gds process
@@ -75,121 +169,836 @@ static gds_hash_table_t hash_data;
 typedef struct {
     /** Structure can be put on lists (including in hash tables) */
     gds_list_item_t super;
+    /* the shard we belong to */
+    shard_t *shard;
+    /* odd while a writer is changing our values */
+    unsigned int seq;
     /* List of gds_value_t structures containing all data
        received from this process, sorted by key. */
     gds_list_t data;
+    /* index of the entries on the data list by key */
+    gds_key_index_t index;
+    /* the same entries ordered by key, for wildcard queries */
+    gds_prefix_index_t prefixes;
+    /* payload bytes of the values we own - keys are atoms
+     * and need no storage of their own */
+    payload_block_t *payloads;
+    /* bytes of the arena still referenced by current values */
+    size_t arena_live;
 } proc_data_t;
 
+static void free_keyval(shard_t *shard, gds_value_t *kv);
+
+/**
+ * The directory of the procs in a shard. It is open-addressed and
+ * an id never moves once it has been given a slot - removing its
+ * proc just marks the slot - so a reader that finds an id can
+ * trust the proc it finds with it. When the directory fills up
+ * it is rebuilt without the removed procs and the old one retired.
+ */
+typedef struct {
+    gds_identifier_t id;
+    /* NULL while the slot is unused */
+    proc_data_t *proc;
+} proc_slot_t;
+
+struct proc_dir_t {
+    size_t capacity;        /* a power of two */
+    size_t used;            /* slots holding an id */
+    size_t nprocs;          /* slots holding a proc */
+    proc_slot_t *slots;
+};
+
+#define PROC_DIR_MIN_CAPACITY   16
+
+/* marks the slot of a removed proc */
+static char proc_removed;
+#define PROC_REMOVED    ((proc_data_t*)&proc_removed)
+
+/**
+ * Drop a reference on an object that a lease may also be
+ * holding
+ */
+static void unpin(shard_t *shard, gds_object_t *obj)
+{
+    pthread_mutex_lock(&shard->pin_lock);
+    OBJ_RELEASE(obj);
+    pthread_mutex_unlock(&shard->pin_lock);
+}
+
+/**
+ * Release functions for the items we retire - they are run by
+ * gds_epoch_reclaim once no fetch can still be using the item,
+ * with no locks held
+ */
+static void free_retired(void *ctx, void *ptr)
+{
+    free(ptr);
+}
+
+static void unpin_retired(void *ctx, void *ptr)
+{
+    unpin((shard_t*)ctx, (gds_object_t*)ptr);
+}
+
+static void keyval_retired(void *ctx, void *ptr)
+{
+    shard_t *shard = (shard_t*)ctx;
+
+    pthread_rwlock_wrlock(&shard->lock);
+    free_keyval(shard, (gds_value_t*)ptr);
+    pthread_rwlock_unlock(&shard->lock);
+}
+
+static void proc_retired(void *ctx, void *ptr)
+{
+    shard_t *shard = (shard_t*)ctx;
+
+    pthread_rwlock_wrlock(&shard->lock);
+    OBJ_RELEASE(ptr);
+    pthread_rwlock_unlock(&shard->lock);
+}
+
+static void retire(gds_epoch_release_fn_t fn, void *ctx, void *ptr)
+{
+    int rc;
+
+    if (GDS_SUCCESS != (rc = gds_epoch_retire(&epoch, fn, ctx, ptr))) {
+        /* a fetch may still be using it, so all we can do is leak it */
+        GDS_ERROR_LOG(rc);
+    }
+}
+
+/* the key index hands us the tables it grows out of */
+static void retire_table(void *ctx, void *table)
+{
+    retire(free_retired, NULL, table);
+}
+
+static inline shard_t* proc_shard(const gds_identifier_t *uid)
+{
+    gds_identifier_t id;
+    uint64_t hash;
+
+    /* to protect alignment, copy the data across */
+    memcpy(&id, uid, sizeof(gds_identifier_t));
+    /* ids are often sequential, so mix them before picking a shard */
+    hash = (uint64_t)id * 0x9e3779b97f4a7c15ULL;
+    return &shards[(hash >> 32) % nshards];
+}
+
 static void proc_data_construct(proc_data_t *ptr)
 {
+    ptr->shard = NULL;
+    ptr->seq = 0;
     OBJ_CONSTRUCT(&ptr->data, gds_list_t);
+    OBJ_CONSTRUCT(&ptr->index, gds_key_index_t);
+    gds_key_index_set_release(&ptr->index, retire_table, NULL);
+    OBJ_CONSTRUCT(&ptr->prefixes, gds_prefix_index_t);
+    ptr->payloads = OBJ_NEW(payload_block_t);
+    ptr->arena_live = 0;
 }
 
+/* by the time the last reference goes, no fetch can be looking
+ * at the proc - so everything can go at once */
 static void proc_data_destruct(proc_data_t *ptr)
 {
-    gds_list_item_t *item;
+    gds_value_t *kv;
 
-    while (NULL != (item = gds_list_remove_first(&ptr->data))) {
-        OBJ_RELEASE(item);
+    while (NULL != (kv = (gds_value_t*)gds_list_remove_first(&ptr->data))) {
+        if (kv->scope & GDS_SCOPE_REFER) {
+            unpin(ptr->shard, (gds_object_t*)kv);
+        } else {
+            free_keyval(ptr->shard, kv);
+        }
     }
     OBJ_DESTRUCT(&ptr->data);
+    OBJ_DESTRUCT(&ptr->index);
+    OBJ_DESTRUCT(&ptr->prefixes);
+    /* all the payloads go at once - unless someone
+     * still holds a lease on them */
+    if (NULL != ptr->payloads) {
+        unpin(ptr->shard, &ptr->payloads->super);
+    }
 }
 OBJ_CLASS_INSTANCE(proc_data_t, gds_list_item_t,
                    proc_data_construct, proc_data_destruct);
 
+static proc_dir_t* proc_dir_new(size_t capacity)
+{
+    proc_dir_t *dir;
+
+    dir = (proc_dir_t*)calloc(1, sizeof(proc_dir_t) + capacity * sizeof(proc_slot_t));
+    if (NULL == dir) {
+        return NULL;
+    }
+    dir->capacity = capacity;
+    dir->slots = (proc_slot_t*)(dir + 1);
+    return dir;
+}
+
+/* pick the slot an id would ideally occupy - with bits that
+ * are independent of those that picked the shard */
+static inline size_t proc_dir_home(proc_dir_t *dir, gds_identifier_t id)
+{
+    return (size_t)(((uint64_t)id * 0xc2b2ae3d27d4eb4fULL) >> 32) & (dir->capacity - 1);
+}
+
+/**
+ * Find the slot holding an id, or the unused slot that ends its
+ * probe sequence. Safe without the shard's lock - the id of a
+ * slot is written before its proc is published
+ */
+static proc_slot_t* proc_dir_probe(proc_dir_t *dir, gds_identifier_t id)
+{
+    size_t mask = dir->capacity - 1;
+    size_t ii;
+    proc_slot_t *slot;
+
+    /* there is always an unused slot, so this terminates */
+    for (ii = proc_dir_home(dir, id); ; ii = (ii + 1) & mask) {
+        slot = &dir->slots[ii];
+        if (NULL == __atomic_load_n(&slot->proc, __ATOMIC_ACQUIRE) || slot->id == id) {
+            return slot;
+        }
+    }
+}
+
+/* rebuild the shard's directory, leaving out the removed procs.
+ * The caller must hold the shard's lock */
+static int proc_dir_rebuild(shard_t *shard)
+{
+    proc_dir_t *old = shard->procs, *dir;
+    proc_slot_t *slot;
+    size_t capacity = PROC_DIR_MIN_CAPACITY, n;
+
+    /* leave room for as many procs again */
+    while (capacity < 4 * (old->nprocs + 1)) {
+        capacity *= 2;
+    }
+    if (NULL == (dir = proc_dir_new(capacity))) {
+        return GDS_ERR_OUT_OF_RESOURCE;
+    }
+    for (n=0; n < old->capacity; n++) {
+        if (NULL == old->slots[n].proc || PROC_REMOVED == old->slots[n].proc) {
+            continue;
+        }
+        slot = proc_dir_probe(dir, old->slots[n].id);
+        slot->id = old->slots[n].id;
+        slot->proc = old->slots[n].proc;
+        dir->used++;
+        dir->nprocs++;
+    }
+    __atomic_store_n(&shard->procs, dir, __ATOMIC_RELEASE);
+    retire(free_retired, NULL, old);
+    return GDS_SUCCESS;
+}
+
+/* add a proc to the shard's directory. The caller must hold the
+ * shard's lock */
+static int proc_dir_insert(shard_t *shard, gds_identifier_t id,
+                           proc_data_t *proc_data)
+{
+    proc_slot_t *slot;
+    int rc;
+
+    slot = proc_dir_probe(shard->procs, id);
+    if (NULL == slot->proc) {
+        /* keep at least half the slots unused */
+        if (2 * (shard->procs->used + 1) > shard->procs->capacity) {
+            if (GDS_SUCCESS != (rc = proc_dir_rebuild(shard))) {
+                return rc;
+            }
+            slot = proc_dir_probe(shard->procs, id);
+        }
+        if (NULL == slot->proc) {
+            slot->id = id;
+            shard->procs->used++;
+        }
+    }
+    shard->procs->nprocs++;
+    __atomic_store_n(&slot->proc, proc_data, __ATOMIC_RELEASE);
+    return GDS_SUCCESS;
+}
+
+/* take a proc out of the shard's directory. The caller must hold
+ * the shard's lock */
+static void proc_dir_remove(shard_t *shard, gds_identifier_t id)
+{
+    proc_slot_t *slot;
+
+    slot = proc_dir_probe(shard->procs, id);
+    if (NULL != slot->proc && PROC_REMOVED != slot->proc) {
+        __atomic_store_n(&slot->proc, PROC_REMOVED, __ATOMIC_RELEASE);
+        shard->procs->nprocs--;
+    }
+}
+
  
 static int init(void)
 {
-    OBJ_CONSTRUCT(&hash_data, gds_hash_table_t);
-    gds_hash_table_init(&hash_data, 256);
+    size_t n;
+    int rc;
+
+    nshards = (0 < gds_gdstor_lhash_num_shards) ? (size_t)gds_gdstor_lhash_num_shards : 1;
+    if (NULL == (shards = (shard_t*)calloc(nshards, sizeof(shard_t)))) {
+        nshards = 0;
+        return GDS_ERR_OUT_OF_RESOURCE;
+    }
+    /* our records point at the atoms' key strings, so
+     * keep the dictionary until we are finalized */
+    if (GDS_SUCCESS != (rc = gds_atom_init())) {
+        free(shards);
+        shards = NULL;
+        nshards = 0;
+        return rc;
+    }
+    OBJ_CONSTRUCT(&epoch, gds_epoch_t);
+    for (n=0; n < nshards; n++) {
+        pthread_rwlock_init(&shards[n].lock, NULL);
+        pthread_mutex_init(&shards[n].pin_lock, NULL);
+        OBJ_CONSTRUCT(&shards[n].values, gds_slab_t);
+        if (NULL == (shards[n].procs = proc_dir_new(PROC_DIR_MIN_CAPACITY))) {
+            rc = GDS_ERR_OUT_OF_RESOURCE;
+        } else {
+            rc = gds_slab_init(&shards[n].values, sizeof(keyval_t), 0);
+        }
+        if (GDS_SUCCESS != rc) {
+            GDS_ERROR_LOG(rc);
+            nshards = n + 1;
+            finalize();
+            return rc;
+        }
+    }
     return GDS_SUCCESS;
 }
 
 static void finalize(void)
 {
     proc_data_t *proc_data;
-    uint64_t key;
-    char *node;
+    size_t n, m;
 
-    /* to assist in getting a clean valgrind, cycle thru the hash table
-     * and release all data stored in it
-     */
-    if (GDS_SUCCESS == gds_hash_table_get_first_key_uint64(&hash_data, &key,
-                                                             (void**)&proc_data,
-                                                             (void**)&node)) {
-        if (NULL != proc_data) {
-            OBJ_RELEASE(proc_data);
-        }
-        while (GDS_SUCCESS == gds_hash_table_get_next_key_uint64(&hash_data, &key,
-                                                                   (void**)&proc_data,
-                                                                   node, (void**)&node)) {
-            if (NULL != proc_data) {
-                OBJ_RELEASE(proc_data);
+    if (NULL == shards) {
+        return;
+    }
+    /* nobody can be fetching by now, so release everything that
+     * was retired - while the shards are still intact */
+    OBJ_DESTRUCT(&epoch);
+
+    for (n=0; n < nshards; n++) {
+        /* to assist in getting a clean valgrind, cycle thru the directory
+         * and release all data stored in it
+         */
+        if (NULL != shards[n].procs) {
+            for (m=0; m < shards[n].procs->capacity; m++) {
+                proc_data = shards[n].procs->slots[m].proc;
+                if (NULL != proc_data && PROC_REMOVED != proc_data) {
+                    OBJ_RELEASE(proc_data);
+                }
             }
+            free(shards[n].procs);
         }
+        /* every value record has been returned by now */
+        OBJ_DESTRUCT(&shards[n].values);
+        pthread_rwlock_destroy(&shards[n].lock);
+        pthread_mutex_destroy(&shards[n].pin_lock);
+    }
+    free(shards);
+    shards = NULL;
+    nshards = 0;
+    gds_atom_finalize();
+}
+
+
+/****    READ PATH    ****
+ *
+ * Fetches take no lock. They find the proc through its shard's
+ * directory and the value through the proc's key index, inside
+ * an epoch. Writers still serialize on the shard's lock, and
+ *
+ *  - never change a value record once a fetch can find it - an
+ *    update stores a fresh record, and compaction only swaps a
+ *    payload pointer for one to an identical copy
+ *
+ *  - retire whatever they unlink (records, payload blocks, old
+ *    index tables and directories, removed procs) through the
+ *    epoch, so it stays valid until every fetch that might have
+ *    found it has finished
+ *
+ *  - bump the proc's sequence count to odd and back around each
+ *    change, so a fetch whose lookup overlapped one - and may have
+ *    been misled by entries moving about in the index - knows to
+ *    look again. Only a change to the same proc forces a retry.
+ */
+static inline void write_begin(proc_data_t *proc_data)
+{
+    __atomic_store_n(&proc_data->seq, proc_data->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static inline void write_end(proc_data_t *proc_data)
+{
+    __atomic_store_n(&proc_data->seq, proc_data->seq + 1, __ATOMIC_RELEASE);
+}
+
+static inline unsigned int read_begin(proc_data_t *proc_data)
+{
+    unsigned int seq;
+
+    /* wait out a change in progress */
+    while ((seq = __atomic_load_n(&proc_data->seq, __ATOMIC_ACQUIRE)) & 1) {
+        sched_yield();
     }
-    OBJ_DESTRUCT(&hash_data);
+    return seq;
 }
 
+static inline bool read_retry(proc_data_t *proc_data, unsigned int seq)
+{
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return seq != __atomic_load_n(&proc_data->seq, __ATOMIC_RELAXED);
+}
 
+/**
+ * Find the proc_data_t container for an id without the
+ * shard's lock. The caller must be inside the epoch.
+ */
+static proc_data_t* find_gds_proc(shard_t *shard, gds_identifier_t id)
+{
+    proc_slot_t *slot;
+    proc_data_t *proc_data;
+
+    slot = proc_dir_probe(__atomic_load_n(&shard->procs, __ATOMIC_ACQUIRE), id);
+    /* the proc may be removed while we look */
+    proc_data = __atomic_load_n(&slot->proc, __ATOMIC_ACQUIRE);
+    return (PROC_REMOVED == proc_data) ? NULL : proc_data;
+}
+
+/**
+ * Find the value for a key without the shard's lock, and take a
+ * consistent copy of its type, scope and data (plus the proc's
+ * payload block, if requested). The caller must be inside the
+ * epoch - the record remains valid until it leaves, but only
+ * the copy is guaranteed to be consistent.
+ */
+static gds_value_t* peek_keyval(proc_data_t *proc_data, gds_atom_t atom,
+                                gds_value_t *snap, payload_block_t **payloads)
+{
+    gds_value_t *kv;
+    unsigned int seq;
+
+    do {
+        seq = read_begin(proc_data);
+        if (NULL == (kv = (gds_value_t*)gds_key_index_peek(&proc_data->index, atom))) {
+            continue;
+        }
+        snap->type = kv->type;
+        snap->scope = kv->scope;
+        /* only the payload pointers can change under us */
+        if (GDS_STRING == kv->type) {
+            snap->data.string = __atomic_load_n(&kv->data.string, __ATOMIC_ACQUIRE);
+        } else if (GDS_BYTE_OBJECT == kv->type) {
+            snap->data.bo.bytes = __atomic_load_n(&kv->data.bo.bytes, __ATOMIC_ACQUIRE);
+            snap->data.bo.size = kv->data.bo.size;
+        } else {
+            memcpy(&snap->data, &kv->data, sizeof(snap->data));
+        }
+        if (NULL != payloads) {
+            *payloads = __atomic_load_n(&proc_data->payloads, __ATOMIC_ACQUIRE);
+        }
+    } while (read_retry(proc_data, seq));
+
+    return kv;
+}
 
 /**
  * Find data for a given key in a given proc_data_t
- * container.
+ * container. Keys that have never been interned cannot
+ * have been stored, so there is nothing to find.
  */
 static gds_value_t* lookup_keyval(proc_data_t *proc_data,
-                                   const char *key)
+                                   gds_atom_t atom)
 {
-    gds_value_t *kv = NULL;
-    for (kv = (gds_value_t *) gds_list_get_first(&proc_data->data);
-         kv != (gds_value_t *) gds_list_get_end(&proc_data->data);
-         kv = (gds_value_t *) gds_list_get_next(kv)) {
-        if (0 == strcmp(key, kv->key)) {
-            return kv;
-        }
+    if (GDS_ATOM_INVALID == atom) {
+        return NULL;
+    }
+    return (gds_value_t*)gds_key_index_get(&proc_data->index, atom);
+}
+
+/**
+ * Add a value to a proc_data_t container, keeping the
+ * data list and both indices in step. Any existing
+ * value for the key must already have been removed.
+ */
+static int insert_keyval(proc_data_t *proc_data, gds_atom_t atom,
+                         gds_value_t *kv)
+{
+    int rc;
+
+    if (GDS_SUCCESS != (rc = gds_key_index_set(&proc_data->index, atom, kv))) {
+        return rc;
+    }
+    /* the atom's string lives as long as we do */
+    if (GDS_SUCCESS != (rc = gds_prefix_index_set(&proc_data->prefixes,
+                                                  gds_atom_key(atom), kv))) {
+        gds_key_index_remove(&proc_data->index, atom);
+        return rc;
+    }
+    gds_list_append(&proc_data->data, &kv->super);
+    return GDS_SUCCESS;
+}
+
+/**
+ * Remove a value from a proc_data_t container. The caller
+ * is responsible for releasing it.
+ */
+static void remove_keyval(proc_data_t *proc_data, gds_atom_t atom,
+                          gds_value_t *kv)
+{
+    gds_key_index_remove(&proc_data->index, atom);
+    gds_prefix_index_remove(&proc_data->prefixes, gds_atom_key(atom));
+    gds_list_remove_item(&proc_data->data, &kv->super);
+}
+
+
+/**
+ * Get a value record from the slab. The record is owned by
+ * the datastore and must be returned with release_keyval.
+ */
+static gds_value_t* new_keyval(proc_data_t *proc_data)
+{
+    gds_value_t *kv;
+
+    if (NULL == (kv = (gds_value_t*)gds_slab_alloc(&proc_data->shard->values))) {
+        return NULL;
+    }
+    OBJ_CONSTRUCT(kv, gds_value_t);
+    ((keyval_t*)kv)->exposed = NULL;
+    return kv;
+}
+
+/**
+ * Copy a payload into the proc's arena
+ */
+static void* copy_to_arena(proc_data_t *proc_data,
+                           const void *src, size_t size)
+{
+    void *ptr;
+
+    if (NULL == proc_data->payloads) {
+        return NULL;
+    }
+    if (NULL != (ptr = gds_arena_alloc(&proc_data->payloads->arena, size))) {
+        memcpy(ptr, src, size);
+        proc_data->arena_live += size;
+    }
+    return ptr;
+}
+
+/**
+ * Return a value record we own to the slab. The key belongs to
+ * the atom table and the payload to the proc's arena, so detach
+ * them before destructing the record so the destructor leaves
+ * them alone. The caller must hold the shard's lock.
+ */
+static void free_keyval(shard_t *shard, gds_value_t *kv)
+{
+    free(((keyval_t*)kv)->exposed);
+    kv->key = NULL;
+    if (GDS_STRING == kv->type) {
+        kv->data.string = NULL;
+    } else if (GDS_BYTE_OBJECT == kv->type) {
+        kv->data.bo.bytes = NULL;
+        kv->data.bo.size = 0;
+    }
+    OBJ_DESTRUCT(kv);
+    gds_slab_free(&shard->values, kv);
+}
+
+/**
+ * Release a value that is no longer on the proc's list. A fetch
+ * may still be reading it, so it is retired rather than released
+ * on the spot - but its payload stops counting against the arena
+ * right away.
+ */
+static void release_keyval(proc_data_t *proc_data, gds_value_t *kv)
+{
+    if (kv->scope & GDS_SCOPE_REFER) {
+        retire(unpin_retired, proc_data->shard, kv);
+        return;
+    }
+    if (GDS_STRING == kv->type && NULL != kv->data.string) {
+        proc_data->arena_live -= strlen(kv->data.string) + 1;
+    } else if (GDS_BYTE_OBJECT == kv->type && NULL != kv->data.bo.bytes) {
+        proc_data->arena_live -= kv->data.bo.size;
+    }
+    gds_epoch_retire_entry(&epoch, &((keyval_t*)kv)->retire,
+                           keyval_retired, proc_data->shard, kv);
+}
+
+/**
+ * The arena only grows, so payloads replaced by updates stay
+ * behind until the proc is removed. If a proc keeps updating
+ * its values, move the live payloads to a fresh arena once
+ * the stale ones make up more than half of it. The old arena
+ * goes away once the last lease on it is released. Each value
+ * is switched to an identical copy of its payload, so a fetch
+ * reading it meanwhile gets the same bytes either way - and
+ * whatever fetch_pointer handed out is a copy of the record's
+ * own (see keyval_t), so it stays where it is.
+ */
+static void compact_arena(proc_data_t *proc_data)
+{
+    payload_block_t *fresh;
+    gds_value_t *kv;
+    char *ptr = NULL;
+    size_t len;
+
+    if (NULL == proc_data->payloads ||
+        gds_arena_get_used(&proc_data->payloads->arena) <=
+        2 * proc_data->arena_live + GDS_ARENA_CHUNK_SIZE) {
+        return;
     }
 
-    return NULL;
+    if (NULL == (fresh = OBJ_NEW(payload_block_t))) {
+        /* not fatal - we just keep the stale payloads a while longer */
+        return;
+    }
+    /* get all the space in one shot so we cannot fail half-way */
+    if (0 < proc_data->arena_live &&
+        NULL == (ptr = (char*)gds_arena_alloc(&fresh->arena, proc_data->arena_live))) {
+        OBJ_RELEASE(fresh);
+        return;
+    }
+    for (kv = (gds_value_t*) gds_list_get_first(&proc_data->data);
+         kv != (gds_value_t*) gds_list_get_end(&proc_data->data);
+         kv = (gds_value_t*) gds_list_get_next(kv)) {
+        if (kv->scope & GDS_SCOPE_REFER) {
+            continue;
+        }
+        if (GDS_STRING == kv->type && NULL != kv->data.string) {
+            len = strlen(kv->data.string) + 1;
+            memcpy(ptr, kv->data.string, len);
+            __atomic_store_n(&kv->data.string, ptr, __ATOMIC_RELEASE);
+            ptr += len;
+        } else if (GDS_BYTE_OBJECT == kv->type && NULL != kv->data.bo.bytes) {
+            memcpy(ptr, kv->data.bo.bytes, kv->data.bo.size);
+            __atomic_store_n(&kv->data.bo.bytes, (uint8_t*)ptr, __ATOMIC_RELEASE);
+            ptr += kv->data.bo.size;
+        }
+    }
+    gds_epoch_retire_entry(&epoch, &proc_data->payloads->retire,
+                           unpin_retired, proc_data->shard, proc_data->payloads);
+    __atomic_store_n(&proc_data->payloads, fresh, __ATOMIC_RELEASE);
 }
 
 
 /**
  * Find proc_data_t container associated with given
- * gds_identifier_t.
+ * gds_identifier_t, creating it if requested. The caller
+ * must hold the shard's lock.
  */
-static proc_data_t* lookup_gds_proc(gds_hash_table_t *jtable, gds_identifier_t id)
+static proc_data_t* lookup_gds_proc(shard_t *shard, gds_identifier_t id,
+                                    bool create)
 {
-    proc_data_t *proc_data = NULL;
+    proc_data_t *proc_data;
     
-    gds_hash_table_get_value_uint64(jtable, id, (void**)&proc_data);
-    if (NULL == proc_data) {
+    proc_data = proc_dir_probe(shard->procs, id)->proc;
+    if (PROC_REMOVED == proc_data) {
+        proc_data = NULL;
+    }
+    if (NULL == proc_data && create) {
         /* The proc clearly exists, so create a data structure for it */
         proc_data = OBJ_NEW(proc_data_t);
         if (NULL == proc_data) {
             gds_output(0, "gdstor:hash:lookup_gds_proc: unable to allocate proc_data_t\n");
             return NULL;
         }
-        gds_hash_table_set_value_uint64(jtable, id, proc_data);
+        proc_data->shard = shard;
+        if (GDS_SUCCESS != proc_dir_insert(shard, id, proc_data)) {
+            gds_output(0, "gdstor:hash:lookup_gds_proc: unable to grow the proc directory\n");
+            OBJ_RELEASE(proc_data);
+            return NULL;
+        }
     }
     
     return proc_data;
 }
 
-static int store(const gds_identifier_t *uid,
-                 gds_scope_t scope,
-                 const char *key, const void *data,
-                 gds_data_type_t type)
+/**
+ * Fill in a fresh value record
+ */
+static int fill_keyval(proc_data_t *proc_data, gds_value_t *kv,
+                       const void *data, gds_data_type_t type)
 {
-    proc_data_t *proc_data;
-    gds_value_t *kv;
     gds_byte_object_t *boptr;
+
+    /* the type could come in as an GDS one (e.g., GDS_VPID). Since
+     * the value is an GDS definition, it cannot cover GDS data
+     * types, so convert to the underlying GDS type
+     */
+    switch (type) {
+    case GDS_STRING:
+        kv->type = GDS_STRING;
+        if (NULL != data) {
+            kv->data.string = (char*)copy_to_arena(proc_data, data,
+                                                   strlen((const char*)data) + 1);
+            if (NULL == kv->data.string) {
+                GDS_ERROR_LOG(GDS_ERR_OUT_OF_RESOURCE);
+                return GDS_ERR_OUT_OF_RESOURCE;
+            }
+        } else {
+            kv->data.string = NULL;
+        }
+        break;
+    case GDS_UINT64:
+        if (NULL == data) {
+            GDS_ERROR_LOG(GDS_ERR_BAD_PARAM);
+            return GDS_ERR_BAD_PARAM;
+        }
+        kv->type = GDS_UINT64;
+        /* to avoid alignment issues */
+        memcpy(&kv->data.uint64, data, 8);
+        break;
+    case GDS_UINT32:
+        if (NULL == data) {
+            GDS_ERROR_LOG(GDS_ERR_BAD_PARAM);
+            return GDS_ERR_BAD_PARAM;
+        }
+        kv->type = GDS_UINT32;
+        /* to avoid alignment issues */
+        memcpy(&kv->data.uint32, data, 4);
+        break;
+    case GDS_UINT16:
+        if (NULL == data) {
+            GDS_ERROR_LOG(GDS_ERR_BAD_PARAM);
+            return GDS_ERR_BAD_PARAM;
+        }
+        kv->type = GDS_UINT16;
+        /* to avoid alignment issues */
+        memcpy(&kv->data.uint16, data, 2);
+        break;
+    case GDS_INT:
+        if (NULL == data) {
+            GDS_ERROR_LOG(GDS_ERR_BAD_PARAM);
+            return GDS_ERR_BAD_PARAM;
+        }
+        kv->type = GDS_INT;
+        /* to avoid alignment issues */
+        memcpy(&kv->data.integer, data, sizeof(int));
+        break;
+    case GDS_UINT:
+        if (NULL == data) {
+            GDS_ERROR_LOG(GDS_ERR_BAD_PARAM);
+            return GDS_ERR_BAD_PARAM;
+        }
+        kv->type = GDS_UINT;
+        /* to avoid alignment issues */
+        memcpy(&kv->data.uint, data, sizeof(unsigned int));
+        break;
+    case GDS_FLOAT:
+        if (NULL == data) {
+            GDS_ERROR_LOG(GDS_ERR_BAD_PARAM);
+            return GDS_ERR_BAD_PARAM;
+        }
+        kv->type = GDS_FLOAT;
+        memcpy(&kv->data.fval, data, sizeof(float));
+        break;
+    case GDS_BYTE_OBJECT:
+        kv->type = GDS_BYTE_OBJECT;
+        boptr = (gds_byte_object_t*)data;
+        if (NULL != boptr && NULL != boptr->bytes && 0 < boptr->size) {
+            kv->data.bo.bytes = (uint8_t*)copy_to_arena(proc_data, boptr->bytes,
+                                                        boptr->size);
+            if (NULL == kv->data.bo.bytes) {
+                GDS_ERROR_LOG(GDS_ERR_OUT_OF_RESOURCE);
+                return GDS_ERR_OUT_OF_RESOURCE;
+            }
+            kv->data.bo.size = boptr->size;
+        } else {
+            kv->data.bo.bytes = NULL;
+            kv->data.bo.size = 0;
+        }
+        break;
+    default:
+        GDS_ERROR_LOG(GDS_ERR_NOT_SUPPORTED);
+        return GDS_ERR_NOT_SUPPORTED;
+    }
+
+    return GDS_SUCCESS;
+}
+
+/**
+ * Store a value for a key in a given proc_data_t container,
+ * replacing any existing value
+ */
+static int store_keyval(proc_data_t *proc_data, gds_identifier_t id,
+                        gds_scope_t scope, gds_atom_t atom,
+                        const void *data, gds_data_type_t type)
+{
+    gds_value_t *kv;
+    int rc;
+
+    /* see if we already have this key in the data - means we are updating
+     * a pre-existing value
+     */
+    kv = lookup_keyval(proc_data, atom);
+#if GDS_ENABLE_DEBUG
+    char *_data_type = gds_dss.lookup_data_type(type);
+    GDS_OUTPUT_VERBOSE((5, gds_gdstor_base_framework.framework_output,
+                         "gdstor:hash:store: %s key %s[%s] for proc %" PRIu64 "",
+                         (NULL == kv ? "storing" : "updating"),
+                         gds_atom_key(atom), _data_type, id));
+    free (_data_type);
+#endif
+    write_begin(proc_data);
+    if (NULL != kv) {
+        remove_keyval(proc_data, atom, kv);
+        release_keyval(proc_data, kv);
+        compact_arena(proc_data);
+    }
+    if (NULL == (kv = new_keyval(proc_data))) {
+        write_end(proc_data);
+        GDS_ERROR_LOG(GDS_ERR_OUT_OF_RESOURCE);
+        return GDS_ERR_OUT_OF_RESOURCE;
+    }
+    /* the atom table holds the key for as long as we live */
+    kv->key = (char*)gds_atom_key(atom);
+    kv->scope = scope;
+    /* the record must be complete before a fetch can find it */
+    if (GDS_SUCCESS != (rc = fill_keyval(proc_data, kv, data, type))) {
+        release_keyval(proc_data, kv);
+        write_end(proc_data);
+        return rc;
+    }
+    if (GDS_SUCCESS != (rc = insert_keyval(proc_data, atom, kv))) {
+        GDS_ERROR_LOG(rc);
+        release_keyval(proc_data, kv);
+    }
+    write_end(proc_data);
+    return rc;
+}
+
+static int store_locked(shard_t *shard, const gds_identifier_t *uid,
+                        gds_scope_t scope,
+                        const char *key, const void *data,
+                        gds_data_type_t type)
+{
+    proc_data_t *proc_data;
     gds_identifier_t id;
+    gds_atom_t atom;
+    int rc;
 
     /* data must have an assigned scope */
     if (GDS_SCOPE_UNDEF == scope) {
         return GDS_ERR_BAD_PARAM;
     }
 
+    /* resolve the key to its atom */
+    if (GDS_SUCCESS != (rc = gds_atom_intern(key, &atom))) {
+        GDS_ERROR_LOG(rc);
+        return rc;
+    }
+
     /* to protect alignment, copy the data across */
     memcpy(&id, uid, sizeof(gds_identifier_t));
 
@@ -201,7 +1010,7 @@ static int store(const gds_identifier_t *uid,
                         id, (int)scope);
 
     /* lookup the proc data object for this proc */
-    if (NULL == (proc_data = lookup_gds_proc(&hash_data, id))) {
+    if (NULL == (proc_data = lookup_gds_proc(shard, id, true))) {
         /* unrecoverable error */
         GDS_OUTPUT_VERBOSE((5, gds_gdstor_base_framework.framework_output,
                              "gdstor:hash:store: storing key %s[%s] for proc %" PRIu64 " unrecoverably failed",
@@ -209,125 +1018,151 @@ static int store(const gds_identifier_t *uid,
         return GDS_ERR_OUT_OF_RESOURCE;
     }
 
-    /* see if we already have this key in the data - means we are updating
-     * a pre-existing value
-     */
-    kv = lookup_keyval(proc_data, key);
-#if GDS_ENABLE_DEBUG
-    char *_data_type = gds_dss.lookup_data_type(type);
-    GDS_OUTPUT_VERBOSE((5, gds_gdstor_base_framework.framework_output,
-                         "gdstor:hash:store: %s key %s[%s] for proc %" PRIu64 "",
-                         (NULL == kv ? "storing" : "updating"),
-                         key, _data_type, id));
-    free (_data_type);
-#endif
-    if (NULL != kv) {
-        gds_list_remove_item(&proc_data->data, &kv->super);
-        OBJ_RELEASE(kv);
+    return store_keyval(proc_data, id, scope, atom, data, type);
+}
+
+/* order the items of a vectored store by shard and then by proc,
+ * preserving the caller's order within each proc so that a later
+ * entry for a key still overwrites an earlier one */
+static int store_order(const void *a, const void *b)
+{
+    const gds_gdstor_lhash_store_t *ia = *(const gds_gdstor_lhash_store_t**)a;
+    const gds_gdstor_lhash_store_t *ib = *(const gds_gdstor_lhash_store_t**)b;
+    shard_t *sa = proc_shard(&ia->proc);
+    shard_t *sb = proc_shard(&ib->proc);
+
+    if (sa != sb) {
+        return (sa < sb) ? -1 : 1;
     }
-    kv = OBJ_NEW(gds_value_t);
-    kv->key = strdup(key);
-    kv->scope = scope;
-    gds_list_append(&proc_data->data, &kv->super);
+    if (ia->proc != ib->proc) {
+        return (ia->proc < ib->proc) ? -1 : 1;
+    }
+    return (ia < ib) ? -1 : (ia > ib);
+}
 
-    /* the type could come in as an GDS one (e.g., GDS_VPID). Since
-     * the value is an GDS definition, it cannot cover GDS data
-     * types, so convert to the underlying GDS type
-     */
-    switch (type) {
-    case GDS_STRING:
-        kv->type = GDS_STRING;
-        if (NULL != data) {
-            kv->data.string = strdup( (const char *) data);
-        } else {
-            kv->data.string = NULL;
-        }
-        break;
-    case GDS_UINT64:
-        if (NULL == data) {
-            GDS_ERROR_LOG(GDS_ERR_BAD_PARAM);
-            return GDS_ERR_BAD_PARAM;
-        }
-        kv->type = GDS_UINT64;
-        /* to avoid alignment issues */
-        memcpy(&kv->data.uint64, data, 8);
-        break;
-    case GDS_UINT32:
-        if (NULL == data) {
-            GDS_ERROR_LOG(GDS_ERR_BAD_PARAM);
+int gds_gdstor_lhash_store_multiple(gds_gdstor_lhash_store_t *items, size_t nitems)
+{
+    gds_gdstor_lhash_store_t **order = NULL, *item;
+    proc_data_t *proc_data = NULL;
+    shard_t *shard = NULL, *prev = NULL, *cur;
+    gds_identifier_t id = 0;
+    bool sorted = true;
+    size_t n;
+    int rc, ret = GDS_SUCCESS;
+
+    if (0 == nitems) {
+        return GDS_SUCCESS;
+    }
+    if (NULL == items) {
+        return GDS_ERR_BAD_PARAM;
+    }
+
+    /* check and resolve everything before we touch the table */
+    for (n=0; n < nitems; n++) {
+        /* data must have an assigned scope */
+        if (GDS_SCOPE_UNDEF == items[n].scope) {
             return GDS_ERR_BAD_PARAM;
         }
-        kv->type = GDS_UINT32;
-        /* to avoid alignment issues */
-        memcpy(&kv->data.uint32, data, 4);
-        break;
-    case GDS_UINT16:
-        if (NULL == data) {
-            GDS_ERROR_LOG(GDS_ERR_BAD_PARAM);
+        if (GDS_ATOM_INVALID == items[n].atom) {
+            if (GDS_SUCCESS != (rc = gds_atom_intern(items[n].key, &items[n].atom))) {
+                GDS_ERROR_LOG(rc);
+                return rc;
+            }
+        } else if (NULL == gds_atom_key(items[n].atom)) {
+            /* not an atom we ever handed out */
             return GDS_ERR_BAD_PARAM;
         }
-        kv->type = GDS_UINT16;
-        /* to avoid alignment issues */
-        memcpy(&kv->data.uint16, data, 2);
-        break;
-    case GDS_INT:
-        if (NULL == data) {
-            GDS_ERROR_LOG(GDS_ERR_BAD_PARAM);
-            return GDS_ERR_BAD_PARAM;
+        /* already grouped if the items arrive in the order
+         * store_order would put them in */
+        cur = proc_shard(&items[n].proc);
+        if (0 < n && items[n].proc != items[n-1].proc &&
+            (cur < prev || (cur == prev && items[n].proc < items[n-1].proc))) {
+            sorted = false;
         }
-        kv->type = GDS_INT;
-        /* to avoid alignment issues */
-        memcpy(&kv->data.integer, data, sizeof(int));
-        break;
-    case GDS_UINT:
-        if (NULL == data) {
-            GDS_ERROR_LOG(GDS_ERR_BAD_PARAM);
-            return GDS_ERR_BAD_PARAM;
+        prev = cur;
+    }
+
+    gds_output_verbose(1, gds_gdstor_base_framework.framework_output,
+                        "gdstor:hash:store_multiple storing %lu items",
+                        (unsigned long)nitems);
+
+    /* the usual case is a proc posting all its own data, in which
+     * case the items are already grouped and we can take them as
+     * they come - otherwise, group them by shard and proc */
+    if (!sorted) {
+        if (NULL == (order = (gds_gdstor_lhash_store_t**)malloc(nitems * sizeof(*order)))) {
+            GDS_ERROR_LOG(GDS_ERR_OUT_OF_RESOURCE);
+            return GDS_ERR_OUT_OF_RESOURCE;
         }
-        kv->type = GDS_UINT;
-        /* to avoid alignment issues */
-        memcpy(&kv->data.uint, data, sizeof(unsigned int));
-        break;
-    case GDS_FLOAT:
-        if (NULL == data) {
-            GDS_ERROR_LOG(GDS_ERR_BAD_PARAM);
-            return GDS_ERR_BAD_PARAM;
+        for (n=0; n < nitems; n++) {
+            order[n] = &items[n];
         }
-        kv->type = GDS_FLOAT;
-        memcpy(&kv->data.fval, data, sizeof(float));
-        break;
-    case GDS_BYTE_OBJECT:
-        kv->type = GDS_BYTE_OBJECT;
-        boptr = (gds_byte_object_t*)data;
-        if (NULL != boptr && NULL != boptr->bytes && 0 < boptr->size) {
-            kv->data.bo.bytes = (uint8_t *) malloc(boptr->size);
-            memcpy(kv->data.bo.bytes, boptr->bytes, boptr->size);
-            kv->data.bo.size = boptr->size;
-        } else {
-            kv->data.bo.bytes = NULL;
-            kv->data.bo.size = 0;
+        qsort(order, nitems, sizeof(*order), store_order);
+    }
+
+    /* store each group with a single lookup of its proc, taking
+     * each shard's lock once. Keep going if an item fails so the
+     * rest still get stored, but report the first error */
+    for (n=0; n < nitems; n++) {
+        item = (NULL == order) ? &items[n] : order[n];
+        if (0 == n || item->proc != id) {
+            id = item->proc;
+            if (shard != (cur = proc_shard(&item->proc))) {
+                if (NULL != shard) {
+                    pthread_rwlock_unlock(&shard->lock);
+                }
+                shard = cur;
+                pthread_rwlock_wrlock(&shard->lock);
+            }
+            if (NULL == (proc_data = lookup_gds_proc(shard, id, true))) {
+                GDS_OUTPUT_VERBOSE((5, gds_gdstor_base_framework.framework_output,
+                                     "gdstor:hash:store_multiple: storing for proc %" PRIu64 " unrecoverably failed",
+                                     id));
+                if (GDS_SUCCESS == ret) {
+                    ret = GDS_ERR_OUT_OF_RESOURCE;
+                }
+            }
+        }
+        if (NULL == proc_data) {
+            continue;
+        }
+        rc = store_keyval(proc_data, id, item->scope, item->atom,
+                          item->data, item->type);
+        if (GDS_SUCCESS != rc && GDS_SUCCESS == ret) {
+            ret = rc;
         }
-        break;
-    default:
-        GDS_ERROR_LOG(GDS_ERR_NOT_SUPPORTED);
-        return GDS_ERR_NOT_SUPPORTED;
     }
+    if (NULL != shard) {
+        pthread_rwlock_unlock(&shard->lock);
+    }
+    gds_epoch_reclaim(&epoch);
 
-    return GDS_SUCCESS;
+    if (NULL != order) {
+        free(order);
+    }
+    return ret;
 }
 
-static int store_pointer(const gds_identifier_t *uid,
-                         gds_value_t *kv)
+static int store_pointer_locked(shard_t *shard, const gds_identifier_t *uid,
+                                gds_value_t *kv)
 {
     proc_data_t *proc_data;
     gds_value_t *k2;
     gds_identifier_t id;
+    gds_atom_t atom;
+    int rc;
 
     /* data must have an assigned scope */
     if (GDS_SCOPE_UNDEF == kv->scope) {
         return GDS_ERR_BAD_PARAM;
     }
 
+    /* resolve the key to its atom */
+    if (GDS_SUCCESS != (rc = gds_atom_intern(kv->key, &atom))) {
+        GDS_ERROR_LOG(rc);
+        return rc;
+    }
+
     /* to protect alignment, copy the data across */
     memcpy(&id, uid, sizeof(gds_identifier_t));
 
@@ -339,7 +1174,7 @@ static int store_pointer(const gds_identifier_t *uid,
                         id, (int)kv->scope);
 
     /* lookup the proc data object for this proc */
-    if (NULL == (proc_data = lookup_gds_proc(&hash_data, id))) {
+    if (NULL == (proc_data = lookup_gds_proc(shard, id, true))) {
         /* unrecoverable error */
         GDS_OUTPUT_VERBOSE((5, gds_gdstor_base_framework.framework_output,
                              "gdstor:hash:store: storing key %s[%s] for proc %" PRIu64 " unrecoverably failed",
@@ -350,26 +1185,32 @@ static int store_pointer(const gds_identifier_t *uid,
     /* see if we already have this key in the data - means we are updating
      * a pre-existing value
      */
-    k2 = lookup_keyval(proc_data, kv->key);
+    k2 = lookup_keyval(proc_data, atom);
     GDS_OUTPUT_VERBOSE((5, gds_gdstor_base_framework.framework_output,
                          "gdstor:hash:store: %s pointer of key %s[%s] for proc %" PRIu64 "",
                          (NULL == k2 ? "storing" : "updating"),
                          kv->key, gds_dss.lookup_data_type(kv->type), id));
+    write_begin(proc_data);
     if (NULL != k2) {
-        gds_list_remove_item(&proc_data->data, &k2->super);
-        OBJ_RELEASE(k2);
+        remove_keyval(proc_data, atom, k2);
+        release_keyval(proc_data, k2);
+        compact_arena(proc_data);
     }
     kv->scope |= GDS_SCOPE_REFER;  // mark that this value was stored by reference and doesn't belong to us
-    gds_list_append(&proc_data->data, &kv->super);
-    return GDS_SUCCESS;
+    if (GDS_SUCCESS != (rc = insert_keyval(proc_data, atom, kv))) {
+        GDS_ERROR_LOG(rc);
+    }
+    write_end(proc_data);
+    return rc;
 }
 
-static int fetch(const gds_identifier_t *uid,
-                 const char *key, void **data,
-                 gds_data_type_t type)
+/* runs without the shard's lock - the caller must be inside the epoch */
+static int fetch_unlocked(shard_t *shard, const gds_identifier_t *uid,
+                          const char *key, void **data,
+                          gds_data_type_t type)
 {
     proc_data_t *proc_data;
-    gds_value_t *kv;
+    gds_value_t *kv, snap;
     gds_byte_object_t *boptr;
     gds_identifier_t id;
 
@@ -388,15 +1229,16 @@ static int fetch(const gds_identifier_t *uid,
     }
 
     /* lookup the proc data object for this proc */
-    if (NULL == (proc_data = lookup_gds_proc(&hash_data, id))) {
+    if (NULL == (proc_data = find_gds_proc(shard, id))) {
         /* maybe they can find it elsewhere */
         GDS_OUTPUT_VERBOSE((5, gds_gdstor_base_framework.framework_output,
                              "gdstor_hash:fetch data for proc %" PRIu64 " not found", id));
         return GDS_ERR_TAKE_NEXT_OPTION;
     }
 
-    /* find the value */
-    if (NULL == (kv = lookup_keyval(proc_data, key))) {
+    /* find the value - and copy it out, since it may be
+     * updated the moment we look away */
+    if (NULL == (kv = peek_keyval(proc_data, gds_atom_lookup(key), &snap, NULL))) {
         /* let them look globally for it */
         GDS_OUTPUT_VERBOSE((5, gds_gdstor_base_framework.framework_output,
                              "gdstor_hash:fetch key %s for proc %" PRIu64 " not found",
@@ -407,60 +1249,60 @@ static int fetch(const gds_identifier_t *uid,
     /* do the copy and check the type */
     switch (type) {
     case GDS_STRING:
-        if (GDS_STRING != kv->type) {
+        if (GDS_STRING != snap.type) {
             return GDS_ERR_TYPE_MISMATCH;
         }
-        if (NULL != kv->data.string) {
-            *data = strdup(kv->data.string);
+        if (NULL != snap.data.string) {
+            *data = strdup(snap.data.string);
         } else {
             *data = NULL;
         }
         break;
     case GDS_UINT64:
-        if (GDS_UINT64 != kv->type) {
+        if (GDS_UINT64 != snap.type) {
             return GDS_ERR_TYPE_MISMATCH;
         }
-        memcpy(*data, &kv->data.uint64, 8);
+        memcpy(*data, &snap.data.uint64, 8);
         break;
     case GDS_UINT32:
-        if (GDS_UINT32 != kv->type) {
+        if (GDS_UINT32 != snap.type) {
             return GDS_ERR_TYPE_MISMATCH;
         }
-        memcpy(*data, &kv->data.uint32, 4);
+        memcpy(*data, &snap.data.uint32, 4);
         break;
     case GDS_UINT16:
-        if (GDS_UINT16 != kv->type) {
+        if (GDS_UINT16 != snap.type) {
             return GDS_ERR_TYPE_MISMATCH;
         }
-        memcpy(*data, &kv->data.uint16, 2);
+        memcpy(*data, &snap.data.uint16, 2);
         break;
     case GDS_INT:
-        if (GDS_INT != kv->type) {
+        if (GDS_INT != snap.type) {
             return GDS_ERR_TYPE_MISMATCH;
         }
-        memcpy(*data, &kv->data.integer, sizeof(int));
+        memcpy(*data, &snap.data.integer, sizeof(int));
         break;
     case GDS_UINT:
-        if (GDS_UINT != kv->type) {
+        if (GDS_UINT != snap.type) {
             return GDS_ERR_TYPE_MISMATCH;
         }
-        memcpy(*data, &kv->data.uint, sizeof(unsigned int));
+        memcpy(*data, &snap.data.uint, sizeof(unsigned int));
         break;
     case GDS_FLOAT:
-        if (GDS_FLOAT != kv->type) {
+        if (GDS_FLOAT != snap.type) {
             return GDS_ERR_TYPE_MISMATCH;
         }
-        memcpy(*data, &kv->data.fval, sizeof(float));
+        memcpy(*data, &snap.data.fval, sizeof(float));
         break;
     case GDS_BYTE_OBJECT:
-        if (GDS_BYTE_OBJECT != kv->type) {
+        if (GDS_BYTE_OBJECT != snap.type) {
             return GDS_ERR_TYPE_MISMATCH;
         }
         boptr = (gds_byte_object_t*)malloc(sizeof(gds_byte_object_t));
-        if (NULL != kv->data.bo.bytes && 0 < kv->data.bo.size) {
-            boptr->bytes = (uint8_t *) malloc(kv->data.bo.size);
-            memcpy(boptr->bytes, kv->data.bo.bytes, kv->data.bo.size);
-            boptr->size = kv->data.bo.size;
+        if (NULL != snap.data.bo.bytes && 0 < snap.data.bo.size) {
+            boptr->bytes = (uint8_t *) malloc(snap.data.bo.size);
+            memcpy(boptr->bytes, snap.data.bo.bytes, snap.data.bo.size);
+            boptr->size = snap.data.bo.size;
         } else {
             boptr->bytes = NULL;
             boptr->size = 0;
@@ -475,12 +1317,52 @@ static int fetch(const gds_identifier_t *uid,
     return GDS_SUCCESS;
 }
 
-static int fetch_pointer(const gds_identifier_t *uid,
-                         const char *key,
-                         void **data, gds_data_type_t type)
+/**
+ * Get the copy of a record's payload that fetch_pointer hands
+ * out, making it on first use. Runs without the shard's lock -
+ * the caller must be inside the epoch, with snap read from kv.
+ * Returns NULL if out of resources
+ */
+static void* expose_payload(gds_value_t *kv, const gds_value_t *snap)
+{
+    keyval_t *rec = (keyval_t*)kv;
+    gds_byte_object_t *bo;
+    void *copy, *cur = NULL;
+
+    if (NULL != (copy = __atomic_load_n(&rec->exposed, __ATOMIC_ACQUIRE))) {
+        return copy;
+    }
+    if (GDS_STRING == snap->type) {
+        copy = strdup(snap->data.string);
+    } else if (NULL != (bo = (gds_byte_object_t*)malloc(sizeof(gds_byte_object_t) +
+                                                         snap->data.bo.size))) {
+        bo->size = snap->data.bo.size;
+        bo->bytes = NULL;
+        if (NULL != snap->data.bo.bytes) {
+            bo->bytes = (void*)(bo + 1);
+            memcpy(bo->bytes, snap->data.bo.bytes, bo->size);
+        }
+        copy = bo;
+    }
+    if (NULL == copy) {
+        return NULL;
+    }
+    /* another fetch may have beaten us to it */
+    if (!__atomic_compare_exchange_n(&rec->exposed, &cur, copy, false,
+                                     __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        free(copy);
+        copy = cur;
+    }
+    return copy;
+}
+
+/* runs without the shard's lock - the caller must be inside the epoch */
+static int fetch_pointer_unlocked(shard_t *shard, const gds_identifier_t *uid,
+                                  const char *key,
+                                  void **data, gds_data_type_t type)
 {
     proc_data_t *proc_data;
-    gds_value_t *kv;
+    gds_value_t *kv, snap;
     gds_identifier_t id;
 
     /* to protect alignment, copy the data across */
@@ -497,62 +1379,72 @@ static int fetch_pointer(const gds_identifier_t *uid,
     }
 
     /* lookup the proc data object for this proc */
-    if (NULL == (proc_data = lookup_gds_proc(&hash_data, id))) {
+    if (NULL == (proc_data = find_gds_proc(shard, id))) {
         /* look elsewhere */
         return GDS_ERR_TAKE_NEXT_OPTION;
     }
 
     /* find the value */
-    if (NULL == (kv = lookup_keyval(proc_data, key))) {
+    if (NULL == (kv = peek_keyval(proc_data, gds_atom_lookup(key), &snap, NULL))) {
         /* let them look globally for it */
         return GDS_ERR_TAKE_NEXT_OPTION;
     }
 
    switch (type) {
     case GDS_STRING:
-        if (GDS_STRING != kv->type) {
+        if (GDS_STRING != snap.type) {
             return GDS_ERR_TYPE_MISMATCH;
         }
-        *data = kv->data.string;
+        if (NULL == snap.data.string || (snap.scope & GDS_SCOPE_REFER)) {
+            *data = snap.data.string;
+        } else if (NULL == (*data = expose_payload(kv, &snap))) {
+            GDS_ERROR_LOG(GDS_ERR_OUT_OF_RESOURCE);
+            return GDS_ERR_OUT_OF_RESOURCE;
+        }
         break;
     case GDS_UINT64:
-        if (GDS_UINT64 != kv->type) {
+        if (GDS_UINT64 != snap.type) {
             return GDS_ERR_TYPE_MISMATCH;
         }
         *data = &kv->data.uint64;
         break;
     case GDS_UINT32:
-        if (GDS_UINT32 != kv->type) {
+        if (GDS_UINT32 != snap.type) {
             return GDS_ERR_TYPE_MISMATCH;
         }
         *data = &kv->data.uint32;
         break;
     case GDS_UINT16:
-        if (GDS_UINT16 != kv->type) {
+        if (GDS_UINT16 != snap.type) {
             return GDS_ERR_TYPE_MISMATCH;
         }
         *data = &kv->data.uint16;
         break;
     case GDS_INT:
-        if (GDS_INT != kv->type) {
+        if (GDS_INT != snap.type) {
             return GDS_ERR_TYPE_MISMATCH;
         }
         *data = &kv->data.integer;
         break;
     case GDS_UINT:
-        if (GDS_UINT != kv->type) {
+        if (GDS_UINT != snap.type) {
             return GDS_ERR_TYPE_MISMATCH;
         }
         *data = &kv->data.uint;
         break;
     case GDS_BYTE_OBJECT:
-        if (GDS_BYTE_OBJECT != kv->type) {
+        if (GDS_BYTE_OBJECT != snap.type) {
             return GDS_ERR_TYPE_MISMATCH;
         }
-        *data = &kv->data.bo;
+        if (snap.scope & GDS_SCOPE_REFER) {
+            *data = &kv->data.bo;
+        } else if (NULL == (*data = expose_payload(kv, &snap))) {
+            GDS_ERROR_LOG(GDS_ERR_OUT_OF_RESOURCE);
+            return GDS_ERR_OUT_OF_RESOURCE;
+        }
         break;
     case GDS_FLOAT:
-        if (GDS_FLOAT != kv->type) {
+        if (GDS_FLOAT != snap.type) {
             return GDS_ERR_TYPE_MISMATCH;
         }
         *data = &kv->data.fval;
@@ -565,16 +1457,147 @@ static int fetch_pointer(const gds_identifier_t *uid,
     return GDS_SUCCESS;
 }
 
-static int fetch_multiple(const gds_identifier_t *uid,
-                          gds_scope_t scope,
-                          const char *key,
-                          gds_list_t *kvs)
+static void release_lease(gds_status_t status, void *cbdata)
+{
+    lease_t *lease = (lease_t*)cbdata;
+
+    if (NULL != lease->pin) {
+        unpin(lease->shard, lease->pin);
+    }
+    free(lease);
+}
+
+/* runs without the shard's lock - the caller must be inside the epoch */
+static int fetch_lease_unlocked(shard_t *shard, const gds_identifier_t *uid,
+                                const char *key,
+                                const void **data, gds_data_type_t type,
+                                gds_release_cbfunc_t *cbfunc, void **cbdata)
+{
+    proc_data_t *proc_data;
+    payload_block_t *payloads;
+    gds_value_t *kv, snap;
+    gds_identifier_t id;
+    lease_t *lease;
+
+    /* to protect alignment, copy the data across */
+    memcpy(&id, uid, sizeof(gds_identifier_t));
+
+    GDS_OUTPUT_VERBOSE((5, gds_gdstor_base_framework.framework_output,
+                         "gdstor:hash:fetch_lease: searching for key %s on proc %" PRIu64 "",
+                         (NULL == key) ? "NULL" : key, id));
+
+    /* if the key is NULL, that is an error */
+    if (NULL == key || NULL == data || NULL == cbfunc || NULL == cbdata) {
+        GDS_ERROR_LOG(GDS_ERR_BAD_PARAM);
+        return GDS_ERR_BAD_PARAM;
+    }
+
+    /* lookup the proc data object for this proc */
+    if (NULL == (proc_data = find_gds_proc(shard, id))) {
+        /* look elsewhere */
+        return GDS_ERR_TAKE_NEXT_OPTION;
+    }
+
+    /* find the value */
+    if (NULL == (kv = peek_keyval(proc_data, gds_atom_lookup(key), &snap, &payloads))) {
+        /* let them look globally for it */
+        return GDS_ERR_TAKE_NEXT_OPTION;
+    }
+
+    /* check the type before we commit to anything */
+    switch (type) {
+    case GDS_STRING:
+    case GDS_UINT64:
+    case GDS_UINT32:
+    case GDS_UINT16:
+    case GDS_INT:
+    case GDS_UINT:
+    case GDS_FLOAT:
+    case GDS_BYTE_OBJECT:
+        if (type != snap.type) {
+            return GDS_ERR_TYPE_MISMATCH;
+        }
+        break;
+    default:
+        GDS_ERROR_LOG(GDS_ERR_NOT_SUPPORTED);
+        return GDS_ERR_NOT_SUPPORTED;
+    }
+
+    if (NULL == (lease = (lease_t*)malloc(sizeof(lease_t)))) {
+        GDS_ERROR_LOG(GDS_ERR_OUT_OF_RESOURCE);
+        return GDS_ERR_OUT_OF_RESOURCE;
+    }
+    lease->pin = NULL;
+    lease->shard = shard;
+
+    /* pin whatever owns the payload - values stored by reference
+     * are objects in their own right, otherwise the payload is
+     * in the arena that was current when we looked. Either may
+     * have been retired since, but cannot be released before we
+     * leave the epoch. Scalars are simply copied into the lease */
+    if (GDS_STRING == type || GDS_BYTE_OBJECT == type) {
+        if (snap.scope & GDS_SCOPE_REFER) {
+            lease->pin = (gds_object_t*)kv;
+        } else {
+            lease->pin = (gds_object_t*)payloads;
+        }
+        if (NULL != lease->pin) {
+            pthread_mutex_lock(&shard->pin_lock);
+            OBJ_RETAIN(lease->pin);
+            pthread_mutex_unlock(&shard->pin_lock);
+        }
+    }
+
+    switch (type) {
+    case GDS_STRING:
+        *data = snap.data.string;
+        break;
+    case GDS_UINT64:
+        lease->data.uint64 = snap.data.uint64;
+        *data = &lease->data.uint64;
+        break;
+    case GDS_UINT32:
+        lease->data.uint32 = snap.data.uint32;
+        *data = &lease->data.uint32;
+        break;
+    case GDS_UINT16:
+        lease->data.uint16 = snap.data.uint16;
+        *data = &lease->data.uint16;
+        break;
+    case GDS_INT:
+        lease->data.integer = snap.data.integer;
+        *data = &lease->data.integer;
+        break;
+    case GDS_UINT:
+        lease->data.uint = snap.data.uint;
+        *data = &lease->data.uint;
+        break;
+    case GDS_FLOAT:
+        lease->data.fval = snap.data.fval;
+        *data = &lease->data.fval;
+        break;
+    default:
+        /* GDS_BYTE_OBJECT - the bytes stay where they are, only
+         * the descriptor is copied */
+        lease->data.bo = snap.data.bo;
+        *data = &lease->data.bo;
+        break;
+    }
+
+    *cbfunc = release_lease;
+    *cbdata = lease;
+    return GDS_SUCCESS;
+}
+
+static int fetch_multiple_locked(shard_t *shard, const gds_identifier_t *uid,
+                                 gds_scope_t scope,
+                                 const char *key,
+                                 gds_list_t *kvs)
 {
     proc_data_t *proc_data;
     gds_value_t *kv, *kvnew;
     int rc;
-    char *srchkey, *ptr;
-    size_t len = 0;
+    size_t len, first, nmatch, n;
     gds_identifier_t id;
 
     /* to protect alignment, copy the data across */
@@ -585,7 +1608,7 @@ static int fetch_multiple(const gds_identifier_t *uid,
                          (NULL == key) ? "NULL" : key, id));
 
     /* lookup the proc data object for this proc */
-    if (NULL == (proc_data = lookup_gds_proc(&hash_data, id))) {
+    if (NULL == (proc_data = lookup_gds_proc(shard, id, false))) {
         /* look elsewhere */
         return GDS_ERR_TAKE_NEXT_OPTION;
     }
@@ -608,75 +1631,204 @@ static int fetch_multiple(const gds_identifier_t *uid,
         return GDS_SUCCESS;
     }
 
-    /* see if the key includes a wildcard */
-    srchkey = strdup(key);
-    if (NULL != (ptr = strchr(srchkey, '*'))) {
-        *ptr = '\0';
-        len = strlen(srchkey);
+    /* if the key doesn't include a wildcard, then the index
+     * can take us straight to the only possible match */
+    if (NULL == strchr(key, '*')) {
+        kv = lookup_keyval(proc_data, gds_atom_lookup(key));
+        if (NULL != kv && (scope & kv->scope)) {
+            if (GDS_SUCCESS != (rc = gds_dss.copy((void**)&kvnew, kv, GDS_VALUE))) {
+                GDS_ERROR_LOG(rc);
+                return rc;
+            }
+            gds_list_append(kvs, &kvnew->super);
+        }
+        return GDS_SUCCESS;
     }
 
-    /* otherwise, find all matching keys and return them */
-    for (kv = (gds_value_t*) gds_list_get_first(&proc_data->data);
-         kv != (gds_value_t*) gds_list_get_end(&proc_data->data);
-         kv = (gds_value_t*) gds_list_get_next(kv)) {
-        /* check for a matching scope */
-        if (!(scope & kv->scope)) {
-            continue;
-        }
-        if ((0 < len && 0 == strncmp(srchkey, kv->key, len)) ||
-            (0 == len && 0 == strcmp(key, kv->key))) {
+    /* the key includes a wildcard - everything before it is
+     * the prefix to match. A bare wildcard only matches itself */
+    len = strchr(key, '*') - key;
+    if (0 == len) {
+        kv = lookup_keyval(proc_data, gds_atom_lookup(key));
+        if (NULL != kv && (scope & kv->scope)) {
             if (GDS_SUCCESS != (rc = gds_dss.copy((void**)&kvnew, kv, GDS_VALUE))) {
                 GDS_ERROR_LOG(rc);
-                free(srchkey);
                 return rc;
             }
             gds_list_append(kvs, &kvnew->super);
         }
+        return GDS_SUCCESS;
+    }
+
+    /* the keys sharing the prefix are adjacent in the prefix
+     * index, so we only visit the ones that match */
+    nmatch = gds_prefix_index_find(&proc_data->prefixes, key, len, &first);
+    for (n=first; n < first + nmatch; n++) {
+        kv = (gds_value_t*)gds_prefix_index_get_value(&proc_data->prefixes, n);
+        /* check for a matching scope */
+        if (!(scope & kv->scope)) {
+            continue;
+        }
+        if (GDS_SUCCESS != (rc = gds_dss.copy((void**)&kvnew, kv, GDS_VALUE))) {
+            GDS_ERROR_LOG(rc);
+            return rc;
+        }
+        gds_list_append(kvs, &kvnew->super);
     }
-    free(srchkey);
     return GDS_SUCCESS;
 }
 
-static int remove_data(const gds_identifier_t *uid, const char *key)
+static int remove_data_locked(shard_t *shard, const gds_identifier_t *uid,
+                              const char *key)
 {
     proc_data_t *proc_data;
     gds_value_t *kv;
     gds_identifier_t id;
+    gds_atom_t atom;
 
     /* to protect alignment, copy the data across */
     memcpy(&id, uid, sizeof(gds_identifier_t));
 
     /* lookup the specified proc */
-    if (NULL == (proc_data = lookup_gds_proc(&hash_data, id))) {
+    if (NULL == (proc_data = lookup_gds_proc(shard, id, false))) {
         /* no data for this proc */
         return GDS_SUCCESS;
     }
 
     /* if key is NULL, remove all data for this proc */
     if (NULL == key) {
-        while (NULL != (kv = (gds_value_t *) gds_list_remove_first(&proc_data->data))) {
-            OBJ_RELEASE(kv);
-        }
-        /* remove the proc_data object itself from the jtable */
-        gds_hash_table_remove_value_uint64(&hash_data, id);
-        /* cleanup */
-        OBJ_RELEASE(proc_data);
+        /* remove the proc_data object itself from the directory */
+        proc_dir_remove(shard, id);
+        /* cleanup - once no fetch can be looking at it, this
+         * releases the values and their payloads all at once */
+        retire(proc_retired, shard, proc_data);
         return GDS_SUCCESS;
     }
 
     /* remove this item */
-    for (kv = (gds_value_t*) gds_list_get_first(&proc_data->data);
-         kv != (gds_value_t*) gds_list_get_end(&proc_data->data);
-         kv = (gds_value_t*) gds_list_get_next(kv)) {
-        if (0 == strcmp(key, kv->key)) {
-            gds_list_remove_item(&proc_data->data, &kv->super);
-            if (!(kv->scope & GDS_SCOPE_REFER)) {
-                OBJ_RELEASE(kv);
-            }
-            break;
+    atom = gds_atom_lookup(key);
+    if (NULL != (kv = lookup_keyval(proc_data, atom))) {
+        write_begin(proc_data);
+        remove_keyval(proc_data, atom, kv);
+        if (!(kv->scope & GDS_SCOPE_REFER)) {
+            release_keyval(proc_data, kv);
         }
+        write_end(proc_data);
     }
 
     return GDS_SUCCESS;
 }
 
+
+/****    LOCKING WRAPPERS    ****/
+/* changes take the shard's lock, and release whatever has become
+ * safe to release once they have dropped it */
+static int store(const gds_identifier_t *uid,
+                 gds_scope_t scope,
+                 const char *key, const void *data,
+                 gds_data_type_t type)
+{
+    shard_t *shard = proc_shard(uid);
+    int rc;
+
+    pthread_rwlock_wrlock(&shard->lock);
+    rc = store_locked(shard, uid, scope, key, data, type);
+    pthread_rwlock_unlock(&shard->lock);
+    gds_epoch_reclaim(&epoch);
+    return rc;
+}
+
+static int store_pointer(const gds_identifier_t *uid,
+                         gds_value_t *kv)
+{
+    shard_t *shard = proc_shard(uid);
+    int rc;
+
+    pthread_rwlock_wrlock(&shard->lock);
+    rc = store_pointer_locked(shard, uid, kv);
+    pthread_rwlock_unlock(&shard->lock);
+    gds_epoch_reclaim(&epoch);
+    return rc;
+}
+
+/* fetches only enter the epoch - see READ PATH */
+static int fetch(const gds_identifier_t *uid,
+                 const char *key, void **data,
+                 gds_data_type_t type)
+{
+    shard_t *shard = proc_shard(uid);
+    int rc;
+
+    if (GDS_SUCCESS != (rc = gds_epoch_enter(&epoch))) {
+        GDS_ERROR_LOG(rc);
+        return rc;
+    }
+    rc = fetch_unlocked(shard, uid, key, data, type);
+    gds_epoch_exit(&epoch);
+    return rc;
+}
+
+/* NOTE: the returned pointer is only good until the value is next
+ * updated or removed - use gds_gdstor_lhash_fetch_lease if other
+ * threads may be modifying it */
+static int fetch_pointer(const gds_identifier_t *uid,
+                         const char *key,
+                         void **data, gds_data_type_t type)
+{
+    shard_t *shard = proc_shard(uid);
+    int rc;
+
+    if (GDS_SUCCESS != (rc = gds_epoch_enter(&epoch))) {
+        GDS_ERROR_LOG(rc);
+        return rc;
+    }
+    rc = fetch_pointer_unlocked(shard, uid, key, data, type);
+    gds_epoch_exit(&epoch);
+    return rc;
+}
+
+int gds_gdstor_lhash_fetch_lease(const gds_identifier_t *uid,
+                                 const char *key,
+                                 const void **data, gds_data_type_t type,
+                                 gds_release_cbfunc_t *cbfunc, void **cbdata)
+{
+    shard_t *shard = proc_shard(uid);
+    int rc;
+
+    if (GDS_SUCCESS != (rc = gds_epoch_enter(&epoch))) {
+        GDS_ERROR_LOG(rc);
+        return rc;
+    }
+    rc = fetch_lease_unlocked(shard, uid, key, data, type, cbfunc, cbdata);
+    gds_epoch_exit(&epoch);
+    return rc;
+}
+
+/* walks the proc's list and prefix index, which - unlike the
+ * key index - cannot be read while they are being changed, but
+ * can be walked by any number of readers at once */
+static int fetch_multiple(const gds_identifier_t *uid,
+                          gds_scope_t scope,
+                          const char *key,
+                          gds_list_t *kvs)
+{
+    shard_t *shard = proc_shard(uid);
+    int rc;
+
+    pthread_rwlock_rdlock(&shard->lock);
+    rc = fetch_multiple_locked(shard, uid, scope, key, kvs);
+    pthread_rwlock_unlock(&shard->lock);
+    return rc;
+}
+
+static int remove_data(const gds_identifier_t *uid, const char *key)
+{
+    shard_t *shard = proc_shard(uid);
+    int rc;
+
+    pthread_rwlock_wrlock(&shard->lock);
+    rc = remove_data_locked(shard, uid, key);
+    pthread_rwlock_unlock(&shard->lock);
+    gds_epoch_reclaim(&epoch);
+    return rc;
+}
@@ -19,6 +19,39 @@ BEGIN_C_DECLS
 GDS_MODULE_DECLSPEC extern gds_gdstor_base_component_t mca_gdstor_lhash_component;
 GDS_DECLSPEC extern gds_gdstor_base_module_t gds_gdstor_lhash_module;
 
+/* number of shards the procs are spread across */
+extern int gds_gdstor_lhash_num_shards;
+
+/* one entry of a vectored store */
+typedef struct {
+    gds_identifier_t proc;
+    gds_scope_t scope;
+    const char *key;
+    gds_atom_t atom;            // GDS_ATOM_INVALID if the key is to be interned
+    const void *data;
+    gds_data_type_t type;
+} gds_gdstor_lhash_store_t;
+
+/* Store an array of values, possibly for several procs, with one
+ * lookup per proc. Equivalent to calling store on each item in
+ * turn. The atom of each key is returned in its item. Returns the
+ * first error encountered - items that succeeded remain stored */
+GDS_DECLSPEC int gds_gdstor_lhash_store_multiple(gds_gdstor_lhash_store_t *items,
+                                                 size_t nitems);
+
+/* Fetch a read-only view of a value without copying it. The view
+ * is pinned until the caller invokes the returned cbfunc with the
+ * returned cbdata - subsequent updates or removal of the value (or
+ * of the entire proc) will not free the data out from under it.
+ * For GDS_STRING, data points to the string itself - for other
+ * types, to a value of the requested type (a gds_byte_object_t in
+ * the case of GDS_BYTE_OBJECT). The view must NOT be modified, and
+ * all leases must be released before the component is finalized */
+GDS_DECLSPEC int gds_gdstor_lhash_fetch_lease(const gds_identifier_t *proc,
+                                              const char *key,
+                                              const void **data, gds_data_type_t type,
+                                              gds_release_cbfunc_t *cbfunc, void **cbdata);
+
 END_C_DECLS
 
 #endif /* GDS_GDSTOR_LHASH_H */
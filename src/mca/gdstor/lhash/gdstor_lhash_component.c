@@ -69,6 +69,9 @@ static int my_store_priority = 1;
  * it globally if we don't
  */
 static int my_fetch_priority = 100;
+/* by default, keep everything in a single shard - service
+ * nodes with many concurrent clients should raise this */
+int gds_gdstor_lhash_num_shards = 1;
 
 static int gdstor_lhash_component_open(void)
 {
@@ -115,5 +118,13 @@ static int gdstor_lhash_component_register(void)
                                            MCA_BASE_VAR_SCOPE_READONLY,
                                            &my_fetch_priority);
 
+    gds_gdstor_lhash_num_shards = 1;
+    (void) mca_base_component_var_register(c, "num_shards",
+                                           "Number of independently locked shards to spread the stored procs across",
+                                           MCA_BASE_VAR_TYPE_INT, NULL, 0, 0,
+                                           GDS_INFO_LVL_9,
+                                           MCA_BASE_VAR_SCOPE_READONLY,
+                                           &gds_gdstor_lhash_num_shards);
+
     return GDS_SUCCESS;
 }
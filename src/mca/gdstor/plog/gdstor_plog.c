@@ -0,0 +1,1427 @@
+/*
+ * Copyright (c) 2016      Intel, Inc. All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ *
+ */
+
+#include "gds_config.h"
+#include "gds/constants.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "gds_stdint.h"
+#include "gds/dss/dss_types.h"
+#include "gds/util/error.h"
+#include "gds/util/output.h"
+
+#include "gds/mca/gdstor/base/base.h"
+#include "gdstor_plog.h"
+
+static int init(void);
+static void finalize(void);
+static int store(const gds_identifier_t *proc,
+                 gds_scope_t scope,
+                 const char *key, const void *object,
+                 gds_data_type_t type);
+static int store_pointer(const gds_identifier_t *proc,
+                         gds_value_t *kv);
+static int fetch(const gds_identifier_t *proc,
+                 const char *key, void **data,
+                 gds_data_type_t type);
+static int fetch_pointer(const gds_identifier_t *proc,
+                         const char *key,
+                         void **data, gds_data_type_t type);
+static int fetch_multiple(const gds_identifier_t *proc,
+                          gds_scope_t scope,
+                          const char *key,
+                          gds_list_t *kvs);
+static int remove_data(const gds_identifier_t *proc, const char *key);
+
+gds_gdstor_base_module_t gds_gdstor_plog_module = {
+    init,
+    finalize,
+    gds_gdstor_base_set_id,
+    store,
+    store_pointer,
+    NULL,
+    fetch,
+    fetch_pointer,
+    fetch_multiple,
+    remove_data,
+    NULL
+};
+
+/**
+ * On-disk layout.
+ *
+ * Every change is appended as a record to the active log segment
+ * ("log.<seq>"). Once a segment reaches the configured size it is
+ * sealed and a new one started. Records are never modified - a
+ * new value for a key is simply a newer record, and removals are
+ * recorded as tombstones.
+ *
+ * The index ("index") is an open-addressed table mapping each proc
+ * and key to the segment and offset of its current record. It is
+ * mapped into memory and updated in place after each append, and
+ * its header records how much of the active segment it reflects.
+ * The log is always written ahead of the index, so after a crash
+ * the index can only be missing the tail of the active segment -
+ * restarting maps the index and replays just that tail.
+ *
+ * Replaced and removed records leave garbage behind in the sealed
+ * segments. A background thread copies the live records out of any
+ * sealed segment that has become mostly garbage, and then deletes
+ * it.
+ */
+#define PLOG_INDEX_MAGIC    0x58444e49474f4c50ULL
+#define PLOG_RECORD_MAGIC   0x44524c50U
+#define PLOG_VERSION        1
+#define PLOG_INDEX_NAME     "index"
+#define PLOG_INDEX_TMP_NAME "index.new"
+#define PLOG_LOG_PREFIX     "log."
+
+typedef struct {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t active;        /* seq of the segment being appended to */
+    uint64_t tail;          /* bytes of the active segment the index reflects */
+    uint64_t nslots;        /* always a power of two */
+    uint64_t nused;         /* slots claimed, including removed ones */
+    uint64_t pad[3];
+} plog_header_t;
+
+/* a slot is empty while its seq is zero. A removed value keeps
+ * its slot, so the probe sequences through it remain intact */
+typedef struct {
+    uint64_t hash;
+    uint64_t proc;
+    uint64_t offset;        /* of the record within its segment */
+    uint32_t seq;           /* segment holding the record */
+    uint32_t len;           /* bytes in the record */
+    uint32_t flags;
+    uint32_t pad;
+} plog_slot_t;
+
+#define PLOG_SLOT_REMOVED   0x01
+
+typedef struct {
+    uint32_t magic;
+    uint32_t checksum;      /* of everything that follows it */
+    uint64_t proc;
+    uint64_t size;          /* bytes of data - zero for a NULL string */
+    uint32_t keylen;        /* bytes of key, including the NUL - zero
+                             * for a tombstone covering the entire proc */
+    uint32_t type;
+    uint32_t scope;
+    uint32_t flags;
+    /* followed by the key and then the data */
+} plog_record_t;
+
+#define PLOG_RECORD_TOMBSTONE   0x01
+
+#define PLOG_ALIGN(s)       (((s) + 7) & ~((uint64_t)7))
+#define PLOG_RECORD_LEN(k, s) PLOG_ALIGN(sizeof(plog_record_t) + (k) + (s))
+
+#define PLOG_RECORD_KEY(r)  ((const char*)((r) + 1))
+#define PLOG_RECORD_DATA(r) ((const uint8_t*)((r) + 1) + (r)->keylen)
+
+/* an open log segment */
+typedef struct {
+    uint32_t seq;
+    int fd;
+    uint64_t length;        /* bytes written */
+    uint64_t live;          /* bytes holding current records */
+} plog_segment_t;
+
+/* the index, as mapped */
+static int index_fd = -1;
+static plog_header_t *index_hdr = NULL;
+static plog_slot_t *index_slots = NULL;
+static size_t index_size = 0;
+
+/* every segment that still exists, in no particular order */
+static plog_segment_t *segments = NULL;
+static size_t nsegments = 0;
+static plog_segment_t *active = NULL;
+
+/* fetches share the lock, changes (and compaction) take it exclusively */
+static pthread_rwlock_t lock = PTHREAD_RWLOCK_INITIALIZER;
+
+/* the compaction thread */
+static pthread_t compactor;
+static bool compactor_running = false;
+static pthread_mutex_t compact_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t compact_cond = PTHREAD_COND_INITIALIZER;
+static bool compact_wanted = false;
+static bool compact_stop = false;
+
+static int index_grow(void);
+static void* compact_thread(void *arg);
+
+/* both the index and the records rely on this, so it must
+ * never change for a given PLOG_VERSION */
+static uint64_t plog_hash(gds_identifier_t id, const char *key)
+{
+    const unsigned char *p;
+    uint64_t h = 0xcbf29ce484222325ULL;
+
+    for (p = (const unsigned char*)key; '\0' != *p; p++) {
+        h ^= *p;
+        h *= 0x100000001b3ULL;
+    }
+    h ^= id * 0x9e3779b97f4a7c15ULL;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return h;
+}
+
+/* catches records that were torn by a crash */
+static uint32_t plog_checksum(const plog_record_t *rec, size_t len)
+{
+    const unsigned char *p = (const unsigned char*)&rec->proc;
+    const unsigned char *end = (const unsigned char*)rec + len;
+    uint32_t h = 0x811c9dc5U;
+
+    for (; p < end; p++) {
+        h ^= *p;
+        h *= 0x01000193U;
+    }
+    return h;
+}
+
+static char* plog_path(const char *name, uint32_t seq)
+{
+    char *path;
+
+    if (0 == seq) {
+        if (0 > asprintf(&path, "%s/%s", gds_gdstor_plog_dir, name)) {
+            return NULL;
+        }
+    } else if (0 > asprintf(&path, "%s/%s%u", gds_gdstor_plog_dir, name, seq)) {
+        return NULL;
+    }
+    return path;
+}
+
+
+/****    SEGMENTS    ****/
+static plog_segment_t* segment_find(uint32_t seq)
+{
+    size_t n;
+
+    for (n=0; n < nsegments; n++) {
+        if (segments[n].seq == seq) {
+            return &segments[n];
+        }
+    }
+    return NULL;
+}
+
+/* open a segment, creating it if need be */
+static plog_segment_t* segment_open(uint32_t seq, bool create)
+{
+    plog_segment_t *seg, *tmp;
+    struct stat st;
+    size_t aidx;
+    char *path;
+    int fd;
+
+    if (NULL != (seg = segment_find(seq))) {
+        return seg;
+    }
+    if (NULL == (path = plog_path(PLOG_LOG_PREFIX, seq))) {
+        return NULL;
+    }
+    fd = open(path, O_RDWR | (create ? O_CREAT : 0), 0600);
+    free(path);
+    if (0 > fd) {
+        return NULL;
+    }
+    if (0 != fstat(fd, &st)) {
+        close(fd);
+        return NULL;
+    }
+    /* active points into the array we are about to move */
+    aidx = (NULL != active) ? (size_t)(active - segments) : 0;
+    tmp = (plog_segment_t*)realloc(segments, (nsegments + 1) * sizeof(plog_segment_t));
+    if (NULL == tmp) {
+        close(fd);
+        return NULL;
+    }
+    segments = tmp;
+    if (NULL != active) {
+        active = &segments[aidx];
+    }
+    seg = &segments[nsegments++];
+    seg->seq = seq;
+    seg->fd = fd;
+    seg->length = st.st_size;
+    seg->live = 0;
+    return seg;
+}
+
+/* close a segment and delete its file */
+static void segment_drop(plog_segment_t *seg)
+{
+    char *path;
+    uint32_t activeseq = active->seq;
+
+    close(seg->fd);
+    if (NULL != (path = plog_path(PLOG_LOG_PREFIX, seg->seq))) {
+        unlink(path);
+        free(path);
+    }
+    *seg = segments[--nsegments];
+    active = segment_find(activeseq);
+}
+
+/* seal the active segment and start a new one */
+static int segment_roll(void)
+{
+    plog_segment_t *seg;
+    uint32_t seq = index_hdr->active + 1;
+
+    /* move the index on first - if we die before the file is
+     * created, restarting creates it */
+    index_hdr->active = seq;
+    index_hdr->tail = 0;
+    if (NULL == (seg = segment_open(seq, true))) {
+        return GDS_ERR_IN_ERRNO;
+    }
+    /* anything there is from an earlier run that never
+     * got as far as recording it in the index */
+    if (0 < seg->length) {
+        if (0 != ftruncate(seg->fd, 0)) {
+            return GDS_ERR_IN_ERRNO;
+        }
+        seg->length = 0;
+    }
+    active = seg;
+    return GDS_SUCCESS;
+}
+
+/* append a record to the active segment - the caller must
+ * hold the lock exclusively */
+static int segment_append(const plog_record_t *rec, size_t len,
+                          uint32_t *seq, uint64_t *offset)
+{
+    const char *ptr = (const char*)rec;
+    size_t done = 0;
+    ssize_t rc;
+    int ret;
+
+    if (len > gds_gdstor_plog_segment_size) {
+        return GDS_ERR_TAKE_NEXT_OPTION;
+    }
+    if (active->length + len > gds_gdstor_plog_segment_size &&
+        GDS_SUCCESS != (ret = segment_roll())) {
+        return ret;
+    }
+    while (done < len) {
+        rc = pwrite(active->fd, ptr + done, len - done, active->length + done);
+        if (0 > rc) {
+            if (EINTR == errno) {
+                continue;
+            }
+            return GDS_ERR_IN_ERRNO;
+        }
+        done += rc;
+    }
+    if (gds_gdstor_plog_sync && 0 != fdatasync(active->fd)) {
+        return GDS_ERR_IN_ERRNO;
+    }
+    *seq = active->seq;
+    *offset = active->length;
+    active->length += len;
+    return GDS_SUCCESS;
+}
+
+/* read back the record a slot refers to */
+static plog_record_t* segment_read(const plog_slot_t *slot)
+{
+    plog_segment_t *seg;
+    plog_record_t *rec;
+    size_t done = 0;
+    ssize_t rc;
+
+    if (NULL == (seg = segment_find(slot->seq)) ||
+        slot->offset + slot->len > seg->length ||
+        slot->len < sizeof(plog_record_t)) {
+        return NULL;
+    }
+    if (NULL == (rec = (plog_record_t*)malloc(slot->len))) {
+        return NULL;
+    }
+    while (done < slot->len) {
+        rc = pread(seg->fd, (char*)rec + done, slot->len - done, slot->offset + done);
+        if (0 > rc && EINTR == errno) {
+            continue;
+        }
+        if (0 >= rc) {
+            free(rec);
+            return NULL;
+        }
+        done += rc;
+    }
+    if (PLOG_RECORD_MAGIC != rec->magic ||
+        rec->keylen > slot->len - sizeof(plog_record_t) ||
+        rec->size > slot->len - sizeof(plog_record_t) - rec->keylen ||
+        (0 < rec->keylen && '\0' != PLOG_RECORD_KEY(rec)[rec->keylen - 1])) {
+        free(rec);
+        return NULL;
+    }
+    return rec;
+}
+
+
+/****    INDEX    ****/
+/* map an index file, creating a fresh one with the given number
+ * of slots if it doesn't exist */
+static int index_map(const char *path, uint64_t nslots, bool create,
+                     int *fdout, plog_header_t **hdrout, size_t *sizeout)
+{
+    plog_header_t *hdr;
+    struct stat st;
+    size_t size;
+    void *ptr;
+    int fd;
+
+    if (0 > (fd = open(path, O_RDWR | (create ? O_CREAT | O_TRUNC : 0), 0600))) {
+        return (ENOENT == errno) ? GDS_ERR_NOT_FOUND : GDS_ERR_IN_ERRNO;
+    }
+    if (create) {
+        size = sizeof(plog_header_t) + nslots * sizeof(plog_slot_t);
+        if (0 != ftruncate(fd, size)) {
+            close(fd);
+            return GDS_ERR_IN_ERRNO;
+        }
+    } else {
+        if (0 != fstat(fd, &st) || (size_t)st.st_size < sizeof(plog_header_t)) {
+            close(fd);
+            return GDS_ERR_IN_ERRNO;
+        }
+        size = st.st_size;
+    }
+    ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (MAP_FAILED == ptr) {
+        close(fd);
+        return GDS_ERR_OUT_OF_RESOURCE;
+    }
+    hdr = (plog_header_t*)ptr;
+    if (create) {
+        /* the file was zero-filled, so every slot is empty */
+        hdr->magic = PLOG_INDEX_MAGIC;
+        hdr->version = PLOG_VERSION;
+        hdr->nslots = nslots;
+    } else if (PLOG_INDEX_MAGIC != hdr->magic || PLOG_VERSION != hdr->version ||
+               0 == hdr->nslots || 0 != (hdr->nslots & (hdr->nslots - 1)) ||
+               size != sizeof(plog_header_t) + hdr->nslots * sizeof(plog_slot_t) ||
+               hdr->nused > hdr->nslots || 0 == hdr->active) {
+        munmap(ptr, size);
+        close(fd);
+        return GDS_ERR_IN_ERRNO;
+    }
+    *fdout = fd;
+    *hdrout = hdr;
+    *sizeout = size;
+    return GDS_SUCCESS;
+}
+
+static void index_unmap(void)
+{
+    if (NULL != index_hdr) {
+        munmap(index_hdr, index_size);
+        index_hdr = NULL;
+        index_slots = NULL;
+        index_size = 0;
+    }
+    if (0 <= index_fd) {
+        close(index_fd);
+        index_fd = -1;
+    }
+}
+
+static bool record_match(const plog_slot_t *slot, gds_identifier_t id,
+                         const char *key, size_t keylen)
+{
+    plog_record_t *rec;
+    bool match;
+
+    if (NULL == (rec = segment_read(slot))) {
+        return false;
+    }
+    match = (rec->proc == id && rec->keylen == keylen &&
+             0 == memcmp(PLOG_RECORD_KEY(rec), key, keylen));
+    free(rec);
+    return match;
+}
+
+/* find the slot holding the proc and key, or else the empty slot
+ * it would go in. Keys are only compared - by reading the record
+ * back - when the hash and proc already match */
+static plog_slot_t* index_probe(gds_identifier_t id, const char *key,
+                                size_t keylen, uint64_t hash)
+{
+    plog_slot_t *slot;
+    uint64_t n, idx, mask = index_hdr->nslots - 1;
+
+    for (n=0, idx = hash & mask; n <= mask; n++, idx = (idx + 1) & mask) {
+        slot = &index_slots[idx];
+        if (0 == slot->seq) {
+            return slot;
+        }
+        if (slot->hash == hash && slot->proc == id &&
+            record_match(slot, id, key, keylen)) {
+            return slot;
+        }
+    }
+    return NULL;
+}
+
+/* drop whatever the slot referred to from the live count */
+static void index_release(plog_slot_t *slot)
+{
+    plog_segment_t *seg;
+
+    if (0 != slot->seq && !(slot->flags & PLOG_SLOT_REMOVED) &&
+        NULL != (seg = segment_find(slot->seq))) {
+        seg->live -= slot->len;
+        if (seg != active) {
+            __atomic_store_n(&compact_wanted, true, __ATOMIC_RELEASE);
+        }
+    }
+}
+
+/* point the index at a newly appended record - the caller
+ * must hold the lock exclusively */
+static int index_update(gds_identifier_t id, const char *key, uint64_t hash,
+                        uint32_t seq, uint64_t offset, uint32_t len,
+                        bool removed)
+{
+    plog_segment_t *seg;
+    plog_slot_t *slot;
+    size_t keylen = strlen(key) + 1;
+    int rc;
+
+    if (NULL == (slot = index_probe(id, key, keylen, hash))) {
+        return GDS_ERR_OUT_OF_RESOURCE;
+    }
+    if (0 == slot->seq) {
+        if (removed) {
+            /* nothing to remove */
+            return GDS_SUCCESS;
+        }
+        /* keep at least a quarter of the slots free */
+        if (4 * (index_hdr->nused + 1) > 3 * index_hdr->nslots) {
+            if (GDS_SUCCESS != (rc = index_grow())) {
+                return rc;
+            }
+            slot = index_probe(id, key, keylen, hash);
+        }
+        slot->hash = hash;
+        slot->proc = id;
+        index_hdr->nused++;
+    } else {
+        index_release(slot);
+    }
+    slot->seq = seq;
+    slot->offset = offset;
+    slot->len = len;
+    slot->flags = removed ? PLOG_SLOT_REMOVED : 0;
+    if (!removed && NULL != (seg = segment_find(seq))) {
+        seg->live += len;
+    }
+    return GDS_SUCCESS;
+}
+
+/* mark every value of a proc removed */
+static void index_remove_proc(gds_identifier_t id)
+{
+    uint64_t n;
+
+    for (n=0; n < index_hdr->nslots; n++) {
+        if (0 != index_slots[n].seq && index_slots[n].proc == id &&
+            !(index_slots[n].flags & PLOG_SLOT_REMOVED)) {
+            index_release(&index_slots[n]);
+            index_slots[n].flags |= PLOG_SLOT_REMOVED;
+        }
+    }
+}
+
+/* rebuild the index at twice the size, dropping the slots of
+ * removed values. The new index is built aside and renamed over
+ * the old one, so a crash leaves one or the other intact */
+static int index_grow(void)
+{
+    plog_header_t *hdr;
+    plog_slot_t *slots;
+    char *path, *tmppath;
+    uint64_t n, idx, mask, nslots, nused = 0;
+    size_t size;
+    int fd, rc;
+
+    /* if most of the slots are removed values, there is no
+     * need to grow - rebuilding alone frees enough of them */
+    nslots = index_hdr->nslots;
+    for (n=0; n < index_hdr->nslots; n++) {
+        if (0 != index_slots[n].seq && !(index_slots[n].flags & PLOG_SLOT_REMOVED)) {
+            nused++;
+        }
+    }
+    if (2 * nused > nslots) {
+        nslots *= 2;
+    }
+
+    if (NULL == (tmppath = plog_path(PLOG_INDEX_TMP_NAME, 0))) {
+        return GDS_ERR_OUT_OF_RESOURCE;
+    }
+    if (GDS_SUCCESS != (rc = index_map(tmppath, nslots, true, &fd, &hdr, &size))) {
+        free(tmppath);
+        return rc;
+    }
+    /* lock the new index before it takes the old one's name, so
+     * that the directory is never left unlocked */
+    if (0 != flock(fd, LOCK_EX | LOCK_NB)) {
+        munmap(hdr, size);
+        close(fd);
+        unlink(tmppath);
+        free(tmppath);
+        return GDS_ERR_IN_ERRNO;
+    }
+    slots = (plog_slot_t*)(hdr + 1);
+    mask = nslots - 1;
+    for (n=0; n < index_hdr->nslots; n++) {
+        if (0 == index_slots[n].seq || (index_slots[n].flags & PLOG_SLOT_REMOVED)) {
+            continue;
+        }
+        for (idx = index_slots[n].hash & mask; 0 != slots[idx].seq; idx = (idx + 1) & mask);
+        slots[idx] = index_slots[n];
+    }
+    hdr->active = index_hdr->active;
+    hdr->tail = index_hdr->tail;
+    hdr->nused = nused;
+
+    if (gds_gdstor_plog_sync && 0 != msync(hdr, size, MS_SYNC)) {
+        rc = GDS_ERR_IN_ERRNO;
+    } else if (NULL == (path = plog_path(PLOG_INDEX_NAME, 0))) {
+        rc = GDS_ERR_OUT_OF_RESOURCE;
+    } else {
+        if (0 != rename(tmppath, path)) {
+            rc = GDS_ERR_IN_ERRNO;
+        }
+        free(path);
+    }
+    if (GDS_SUCCESS != rc) {
+        munmap(hdr, size);
+        close(fd);
+        unlink(tmppath);
+        free(tmppath);
+        return rc;
+    }
+    free(tmppath);
+
+    index_unmap();
+    index_fd = fd;
+    index_hdr = hdr;
+    index_slots = slots;
+    index_size = size;
+    return GDS_SUCCESS;
+}
+
+/* bring the index up to date with a record found in the log */
+static int index_apply(const plog_record_t *rec, uint32_t seq, uint64_t offset,
+                       uint32_t len)
+{
+    const char *key = PLOG_RECORD_KEY(rec);
+
+    if (0 == rec->keylen) {
+        index_remove_proc(rec->proc);
+        return GDS_SUCCESS;
+    }
+    return index_update(rec->proc, key, plog_hash(rec->proc, key), seq, offset, len,
+                        (rec->flags & PLOG_RECORD_TOMBSTONE));
+}
+
+
+/****    RECOVERY    ****/
+/* replay whatever was appended to the active segment after the
+ * index was last updated, and cut off any record that was only
+ * partly written */
+static int recover_tail(void)
+{
+    plog_record_t *rec;
+    char *buf;
+    uint64_t pos, len, avail;
+    ssize_t rc;
+    int ret = GDS_SUCCESS;
+
+    if (active->length < index_hdr->tail) {
+        /* the log lost data the index refers to - it cannot be trusted */
+        return GDS_ERR_IN_ERRNO;
+    }
+    avail = active->length - index_hdr->tail;
+    if (0 == avail) {
+        return GDS_SUCCESS;
+    }
+    if (NULL == (buf = (char*)malloc(avail))) {
+        return GDS_ERR_OUT_OF_RESOURCE;
+    }
+    for (pos = 0; pos < avail; pos += rc) {
+        rc = pread(active->fd, buf + pos, avail - pos, index_hdr->tail + pos);
+        if (0 > rc && EINTR == errno) {
+            rc = 0;
+            continue;
+        }
+        if (0 >= rc) {
+            free(buf);
+            return GDS_ERR_IN_ERRNO;
+        }
+    }
+
+    for (pos = 0; pos + sizeof(plog_record_t) <= avail; pos += len) {
+        rec = (plog_record_t*)(buf + pos);
+        if (PLOG_RECORD_MAGIC != rec->magic ||
+            rec->keylen > avail - pos - sizeof(plog_record_t) ||
+            rec->size > avail - pos - sizeof(plog_record_t) - rec->keylen) {
+            break;
+        }
+        len = PLOG_RECORD_LEN(rec->keylen, rec->size);
+        if (len > avail - pos ||
+            rec->checksum != plog_checksum(rec, len) ||
+            (0 < rec->keylen && '\0' != PLOG_RECORD_KEY(rec)[rec->keylen - 1])) {
+            break;
+        }
+        if (GDS_SUCCESS != (ret = index_apply(rec, active->seq, index_hdr->tail + pos, len))) {
+            break;
+        }
+    }
+    free(buf);
+    if (GDS_SUCCESS != ret) {
+        return ret;
+    }
+
+    GDS_OUTPUT_VERBOSE((2, gds_gdstor_base_framework.framework_output,
+                         "gdstor:plog: replayed %lu bytes of segment %u, discarded %lu",
+                         (unsigned long)pos, active->seq, (unsigned long)(avail - pos)));
+
+    if (pos < avail) {
+        if (0 != ftruncate(active->fd, index_hdr->tail + pos)) {
+            return GDS_ERR_IN_ERRNO;
+        }
+    }
+    active->length = index_hdr->tail + pos;
+    index_hdr->tail = active->length;
+    return GDS_SUCCESS;
+}
+
+/* open every segment the index refers to and count what is live
+ * in each - this touches the index once, whatever the number of
+ * records ever written. Segment files nobody refers to were
+ * compacted or abandoned before a crash, and are deleted */
+static int recover_segments(void)
+{
+    plog_segment_t *seg;
+    struct dirent *ent;
+    char *end, *path;
+    unsigned long seq;
+    uint64_t n;
+    DIR *dir;
+
+    for (n=0; n < index_hdr->nslots; n++) {
+        if (0 == index_slots[n].seq || (index_slots[n].flags & PLOG_SLOT_REMOVED)) {
+            continue;
+        }
+        if (NULL == (seg = segment_open(index_slots[n].seq, false))) {
+            GDS_OUTPUT_VERBOSE((1, gds_gdstor_base_framework.framework_output,
+                                 "gdstor:plog: segment %u is missing",
+                                 index_slots[n].seq));
+            return GDS_ERR_IN_ERRNO;
+        }
+        seg->live += index_slots[n].len;
+    }
+    if (NULL == (active = segment_open(index_hdr->active, true))) {
+        return GDS_ERR_IN_ERRNO;
+    }
+
+    if (NULL == (dir = opendir(gds_gdstor_plog_dir))) {
+        return GDS_SUCCESS;
+    }
+    while (NULL != (ent = readdir(dir))) {
+        if (0 != strncmp(ent->d_name, PLOG_LOG_PREFIX, strlen(PLOG_LOG_PREFIX))) {
+            continue;
+        }
+        seq = strtoul(ent->d_name + strlen(PLOG_LOG_PREFIX), &end, 10);
+        if ('\0' != *end || NULL != segment_find(seq)) {
+            continue;
+        }
+        if (NULL != (path = plog_path(ent->d_name, 0))) {
+            unlink(path);
+            free(path);
+        }
+    }
+    closedir(dir);
+    return GDS_SUCCESS;
+}
+
+static void cleanup(void)
+{
+    size_t n;
+
+    for (n=0; n < nsegments; n++) {
+        close(segments[n].fd);
+    }
+    free(segments);
+    segments = NULL;
+    nsegments = 0;
+    active = NULL;
+    index_unmap();
+}
+
+static int init(void)
+{
+    uint64_t nslots;
+    char *path, *logpath;
+    int rc;
+
+    if (NULL == gds_gdstor_plog_dir) {
+        return GDS_ERR_NOT_AVAILABLE;
+    }
+    if (0 != mkdir(gds_gdstor_plog_dir, 0700) && EEXIST != errno) {
+        return GDS_ERR_IN_ERRNO;
+    }
+    if (NULL == (path = plog_path(PLOG_INDEX_NAME, 0))) {
+        return GDS_ERR_OUT_OF_RESOURCE;
+    }
+
+    pthread_rwlock_wrlock(&lock);
+    rc = index_map(path, 0, false, &index_fd, &index_hdr, &index_size);
+    if (GDS_ERR_NOT_FOUND == rc) {
+        /* starting afresh - whatever log the first segment
+         * holds cannot belong to the new index */
+        if (NULL != (logpath = plog_path(PLOG_LOG_PREFIX, 1))) {
+            unlink(logpath);
+            free(logpath);
+        }
+        nslots = 16;
+        while (nslots < 2 * (uint64_t)(0 < gds_gdstor_plog_max_keys ? gds_gdstor_plog_max_keys : 1)) {
+            nslots <<= 1;
+        }
+        if (GDS_SUCCESS == (rc = index_map(path, nslots, true, &index_fd, &index_hdr, &index_size))) {
+            index_hdr->active = 1;
+        }
+    }
+    free(path);
+    if (GDS_SUCCESS != rc) {
+        pthread_rwlock_unlock(&lock);
+        GDS_ERROR_LOG(rc);
+        return rc;
+    }
+    /* only one process may use the directory at a time */
+    if (0 != flock(index_fd, LOCK_EX | LOCK_NB)) {
+        index_unmap();
+        pthread_rwlock_unlock(&lock);
+        GDS_OUTPUT_VERBOSE((1, gds_gdstor_base_framework.framework_output,
+                             "gdstor:plog: %s is in use by another process",
+                             gds_gdstor_plog_dir));
+        return GDS_ERR_NOT_AVAILABLE;
+    }
+    index_slots = (plog_slot_t*)(index_hdr + 1);
+
+    if (GDS_SUCCESS != (rc = recover_segments()) ||
+        GDS_SUCCESS != (rc = recover_tail())) {
+        cleanup();
+        pthread_rwlock_unlock(&lock);
+        GDS_ERROR_LOG(rc);
+        return rc;
+    }
+    pthread_rwlock_unlock(&lock);
+
+    compact_stop = false;
+    compact_wanted = false;
+    compactor_running = (0 == pthread_create(&compactor, NULL, compact_thread, NULL));
+    return GDS_SUCCESS;
+}
+
+static void finalize(void)
+{
+    if (compactor_running) {
+        pthread_mutex_lock(&compact_lock);
+        compact_stop = true;
+        pthread_cond_signal(&compact_cond);
+        pthread_mutex_unlock(&compact_lock);
+        pthread_join(compactor, NULL);
+        compactor_running = false;
+    }
+
+    pthread_rwlock_wrlock(&lock);
+    if (NULL != index_hdr && NULL != active) {
+        if (0 != fdatasync(active->fd)) {
+            GDS_ERROR_LOG(GDS_ERR_IN_ERRNO);
+        }
+        msync(index_hdr, index_size, MS_SYNC);
+    }
+    cleanup();
+    pthread_rwlock_unlock(&lock);
+}
+
+
+/****    COMPACTION    ****/
+/* move the live records out of a sealed segment, and delete it.
+ * The caller must hold the lock exclusively */
+static int compact_segment(plog_segment_t *victim)
+{
+    plog_record_t *rec;
+    plog_slot_t *slot;
+    uint32_t victimseq = victim->seq, seq;
+    uint64_t n, offset, len;
+    int rc;
+
+    for (n=0; n < index_hdr->nslots; n++) {
+        slot = &index_slots[n];
+        if (slot->seq != victimseq) {
+            continue;
+        }
+        if (NULL == (rec = segment_read(slot))) {
+            return GDS_ERR_IN_ERRNO;
+        }
+        len = slot->len;
+        /* a removed value keeps its slot, and probes read the key
+         * back from the record it refers to - so move that along
+         * too. If it is a value removed with the rest of its proc,
+         * a tombstone for just its key will do */
+        if ((slot->flags & PLOG_SLOT_REMOVED) && !(rec->flags & PLOG_RECORD_TOMBSTONE)) {
+            len = PLOG_RECORD_LEN(rec->keylen, 0);
+            memset((char*)(rec + 1) + rec->keylen, 0,
+                   len - sizeof(plog_record_t) - rec->keylen);
+            rec->size = 0;
+            rec->type = 0;
+            rec->scope = 0;
+            rec->flags = PLOG_RECORD_TOMBSTONE;
+            rec->checksum = plog_checksum(rec, len);
+        }
+        rc = segment_append(rec, len, &seq, &offset);
+        free(rec);
+        if (GDS_SUCCESS != rc) {
+            return rc;
+        }
+        index_release(slot);
+        slot->seq = seq;
+        slot->offset = offset;
+        slot->len = len;
+        if (!(slot->flags & PLOG_SLOT_REMOVED)) {
+            active->live += len;
+        }
+        index_hdr->tail = active->length;
+    }
+
+    /* nothing refers to it any more - but the moved records and the
+     * index must reach the disk before the segment goes, sync or
+     * not, or a crash would leave the index pointing into a file
+     * that no longer exists */
+    if (0 != fdatasync(active->fd) ||
+        0 != msync(index_hdr, index_size, MS_SYNC)) {
+        return GDS_ERR_IN_ERRNO;
+    }
+    GDS_OUTPUT_VERBOSE((2, gds_gdstor_base_framework.framework_output,
+                         "gdstor:plog: compacted segment %u", victimseq));
+    if (NULL != (victim = segment_find(victimseq))) {
+        segment_drop(victim);
+    }
+    return GDS_SUCCESS;
+}
+
+/* pick the sealed segment holding the least live data, if any
+ * has fallen below the threshold */
+static plog_segment_t* compact_pick(void)
+{
+    plog_segment_t *best = NULL;
+    size_t n;
+
+    for (n=0; n < nsegments; n++) {
+        if (&segments[n] == active || 0 == segments[n].length) {
+            continue;
+        }
+        if (100 * segments[n].live >=
+            (uint64_t)gds_gdstor_plog_compact_threshold * segments[n].length) {
+            continue;
+        }
+        if (NULL == best || segments[n].live * best->length < best->live * segments[n].length) {
+            best = &segments[n];
+        }
+    }
+    return best;
+}
+
+static void* compact_thread(void *arg)
+{
+    plog_segment_t *victim;
+    int rc;
+
+    pthread_mutex_lock(&compact_lock);
+    while (!compact_stop) {
+        if (!__atomic_exchange_n(&compact_wanted, false, __ATOMIC_ACQ_REL)) {
+            pthread_cond_wait(&compact_cond, &compact_lock);
+            continue;
+        }
+        pthread_mutex_unlock(&compact_lock);
+
+        /* one segment at a time, so changes can get in between */
+        for (;;) {
+            pthread_rwlock_wrlock(&lock);
+            if (NULL == index_hdr || NULL == (victim = compact_pick())) {
+                pthread_rwlock_unlock(&lock);
+                break;
+            }
+            rc = compact_segment(victim);
+            pthread_rwlock_unlock(&lock);
+            if (GDS_SUCCESS != rc) {
+                GDS_ERROR_LOG(rc);
+                break;
+            }
+            if (__atomic_load_n(&compact_stop, __ATOMIC_ACQUIRE)) {
+                break;
+            }
+        }
+
+        pthread_mutex_lock(&compact_lock);
+    }
+    pthread_mutex_unlock(&compact_lock);
+    return NULL;
+}
+
+/* let the compactor know if a change left garbage in a sealed segment */
+static void compact_poke(void)
+{
+    if (!compactor_running || !__atomic_load_n(&compact_wanted, __ATOMIC_ACQUIRE)) {
+        return;
+    }
+    pthread_mutex_lock(&compact_lock);
+    pthread_cond_signal(&compact_cond);
+    pthread_mutex_unlock(&compact_lock);
+}
+
+
+/****    MODULE FUNCTIONS    ****/
+/* append a record and index it - the caller must hold the lock
+ * exclusively */
+static int log_record(plog_record_t *rec, size_t len)
+{
+    uint32_t seq;
+    uint64_t offset;
+    int rc;
+
+    rec->magic = PLOG_RECORD_MAGIC;
+    rec->checksum = plog_checksum(rec, len);
+    if (GDS_SUCCESS != (rc = segment_append(rec, len, &seq, &offset))) {
+        return rc;
+    }
+    if (GDS_SUCCESS != (rc = index_apply(rec, seq, offset, len))) {
+        return rc;
+    }
+    index_hdr->tail = active->length;
+    if (gds_gdstor_plog_sync && 0 != msync(index_hdr, index_size, MS_SYNC)) {
+        return GDS_ERR_IN_ERRNO;
+    }
+    return GDS_SUCCESS;
+}
+
+static int store(const gds_identifier_t *uid,
+                 gds_scope_t scope,
+                 const char *key, const void *data,
+                 gds_data_type_t type)
+{
+    const gds_byte_object_t *boptr;
+    const void *src = NULL;
+    plog_record_t *rec;
+    gds_identifier_t id;
+    size_t keylen, size = 0, len;
+    int rc;
+
+    /* to protect alignment, copy the data across */
+    memcpy(&id, uid, sizeof(gds_identifier_t));
+
+    GDS_OUTPUT_VERBOSE((5, gds_gdstor_base_framework.framework_output,
+                         "gdstor:plog:store storing data for proc %" PRIu64 " for key %s",
+                         id, (NULL == key) ? "NULL" : key));
+
+    if (NULL == key) {
+        GDS_ERROR_LOG(GDS_ERR_BAD_PARAM);
+        return GDS_ERR_BAD_PARAM;
+    }
+
+    /* find the bytes to place in the log */
+    switch (type) {
+    case GDS_STRING:
+        if (NULL != data) {
+            src = data;
+            size = strlen((const char*)data) + 1;
+        }
+        break;
+    case GDS_UINT64:
+        size = 8;
+        break;
+    case GDS_UINT32:
+        size = 4;
+        break;
+    case GDS_UINT16:
+        size = 2;
+        break;
+    case GDS_INT:
+        size = sizeof(int);
+        break;
+    case GDS_UINT:
+        size = sizeof(unsigned int);
+        break;
+    case GDS_FLOAT:
+        size = sizeof(float);
+        break;
+    case GDS_BYTE_OBJECT:
+        boptr = (const gds_byte_object_t*)data;
+        if (NULL != boptr && NULL != boptr->bytes && 0 < boptr->size) {
+            src = boptr->bytes;
+            size = boptr->size;
+        }
+        break;
+    default:
+        /* we cannot flatten it - leave it to someone who can */
+        return GDS_ERR_TAKE_NEXT_OPTION;
+    }
+    if (GDS_STRING != type && GDS_BYTE_OBJECT != type) {
+        if (NULL == data) {
+            GDS_ERROR_LOG(GDS_ERR_BAD_PARAM);
+            return GDS_ERR_BAD_PARAM;
+        }
+        src = data;
+    }
+
+    keylen = strlen(key) + 1;
+    len = PLOG_RECORD_LEN(keylen, size);
+    if (NULL == (rec = (plog_record_t*)calloc(1, len))) {
+        return GDS_ERR_OUT_OF_RESOURCE;
+    }
+    rec->proc = id;
+    rec->size = size;
+    rec->keylen = keylen;
+    rec->type = type;
+    rec->scope = scope;
+    memcpy((char*)(rec + 1), key, keylen);
+    if (0 < size) {
+        memcpy((uint8_t*)PLOG_RECORD_DATA(rec), src, size);
+    }
+
+    pthread_rwlock_wrlock(&lock);
+    if (NULL == index_hdr) {
+        rc = GDS_ERR_TAKE_NEXT_OPTION;
+    } else {
+        rc = log_record(rec, len);
+    }
+    pthread_rwlock_unlock(&lock);
+    free(rec);
+
+    if (GDS_SUCCESS != rc && GDS_ERR_TAKE_NEXT_OPTION != rc) {
+        GDS_ERROR_LOG(rc);
+    }
+    compact_poke();
+    return rc;
+}
+
+static int store_pointer(const gds_identifier_t *uid,
+                         gds_value_t *kv)
+{
+    /* a pointer will mean nothing after a restart */
+    return GDS_ERR_TAKE_NEXT_OPTION;
+}
+
+/* read the current record for a proc and key - the caller must
+ * hold the lock */
+static plog_record_t* lookup_record(gds_identifier_t id, const char *key)
+{
+    plog_slot_t *slot;
+    size_t keylen = strlen(key) + 1;
+
+    if (NULL == index_hdr ||
+        NULL == (slot = index_probe(id, key, keylen, plog_hash(id, key))) ||
+        0 == slot->seq || (slot->flags & PLOG_SLOT_REMOVED)) {
+        return NULL;
+    }
+    return segment_read(slot);
+}
+
+static int fetch(const gds_identifier_t *uid,
+                 const char *key, void **data,
+                 gds_data_type_t type)
+{
+    plog_record_t *rec;
+    const uint8_t *src;
+    gds_byte_object_t *boptr;
+    gds_identifier_t id;
+    int rc = GDS_SUCCESS;
+
+    /* to protect alignment, copy the data across */
+    memcpy(&id, uid, sizeof(gds_identifier_t));
+
+    GDS_OUTPUT_VERBOSE((5, gds_gdstor_base_framework.framework_output,
+                         "gdstor:plog:fetch: searching for key %s on proc %" PRIu64 "",
+                         (NULL == key) ? "NULL" : key, id));
+
+    /* if the key is NULL, that is an error */
+    if (NULL == key) {
+        GDS_ERROR_LOG(GDS_ERR_BAD_PARAM);
+        return GDS_ERR_BAD_PARAM;
+    }
+
+    pthread_rwlock_rdlock(&lock);
+    rec = lookup_record(id, key);
+    pthread_rwlock_unlock(&lock);
+    if (NULL == rec) {
+        /* let them look elsewhere for it */
+        return GDS_ERR_TAKE_NEXT_OPTION;
+    }
+    if (type != rec->type) {
+        free(rec);
+        return GDS_ERR_TYPE_MISMATCH;
+    }
+    src = PLOG_RECORD_DATA(rec);
+
+    switch (type) {
+    case GDS_STRING:
+        if (0 < rec->size) {
+            if (NULL == (*data = strndup((const char*)src, rec->size))) {
+                rc = GDS_ERR_OUT_OF_RESOURCE;
+            }
+        } else {
+            *data = NULL;
+        }
+        break;
+    case GDS_UINT64:
+        memcpy(*data, src, 8);
+        break;
+    case GDS_UINT32:
+        memcpy(*data, src, 4);
+        break;
+    case GDS_UINT16:
+        memcpy(*data, src, 2);
+        break;
+    case GDS_INT:
+        memcpy(*data, src, sizeof(int));
+        break;
+    case GDS_UINT:
+        memcpy(*data, src, sizeof(unsigned int));
+        break;
+    case GDS_FLOAT:
+        memcpy(*data, src, sizeof(float));
+        break;
+    case GDS_BYTE_OBJECT:
+        if (NULL == (boptr = (gds_byte_object_t*)malloc(sizeof(gds_byte_object_t)))) {
+            rc = GDS_ERR_OUT_OF_RESOURCE;
+            break;
+        }
+        if (0 < rec->size) {
+            if (NULL == (boptr->bytes = (uint8_t *) malloc(rec->size))) {
+                free(boptr);
+                rc = GDS_ERR_OUT_OF_RESOURCE;
+                break;
+            }
+            memcpy(boptr->bytes, src, rec->size);
+            boptr->size = rec->size;
+        } else {
+            boptr->bytes = NULL;
+            boptr->size = 0;
+        }
+        *data = boptr;
+        break;
+    default:
+        GDS_ERROR_LOG(GDS_ERR_NOT_SUPPORTED);
+        rc = GDS_ERR_NOT_SUPPORTED;
+    }
+
+    free(rec);
+    return rc;
+}
+
+static int fetch_pointer(const gds_identifier_t *uid,
+                         const char *key,
+                         void **data, gds_data_type_t type)
+{
+    /* values only exist in memory while they are being read
+     * from the log, so there is nothing to point at */
+    return GDS_ERR_NOT_SUPPORTED;
+}
+
+/* convert a record to a value of its own */
+static int record_to_value(const plog_record_t *rec, gds_value_t **kvout)
+{
+    gds_value_t *kv;
+    const uint8_t *data = PLOG_RECORD_DATA(rec);
+
+    if (NULL == (kv = OBJ_NEW(gds_value_t))) {
+        return GDS_ERR_OUT_OF_RESOURCE;
+    }
+    if (NULL == (kv->key = strdup(PLOG_RECORD_KEY(rec)))) {
+        OBJ_RELEASE(kv);
+        return GDS_ERR_OUT_OF_RESOURCE;
+    }
+    kv->scope = rec->scope;
+    kv->type = rec->type;
+    switch (rec->type) {
+    case GDS_STRING:
+        if (0 < rec->size &&
+            NULL == (kv->data.string = strndup((const char*)data, rec->size))) {
+            OBJ_RELEASE(kv);
+            return GDS_ERR_OUT_OF_RESOURCE;
+        }
+        break;
+    case GDS_UINT64:
+        memcpy(&kv->data.uint64, data, 8);
+        break;
+    case GDS_UINT32:
+        memcpy(&kv->data.uint32, data, 4);
+        break;
+    case GDS_UINT16:
+        memcpy(&kv->data.uint16, data, 2);
+        break;
+    case GDS_INT:
+        memcpy(&kv->data.integer, data, sizeof(int));
+        break;
+    case GDS_UINT:
+        memcpy(&kv->data.uint, data, sizeof(unsigned int));
+        break;
+    case GDS_FLOAT:
+        memcpy(&kv->data.fval, data, sizeof(float));
+        break;
+    case GDS_BYTE_OBJECT:
+        if (0 < rec->size) {
+            if (NULL == (kv->data.bo.bytes = (uint8_t*)malloc(rec->size))) {
+                OBJ_RELEASE(kv);
+                return GDS_ERR_OUT_OF_RESOURCE;
+            }
+            memcpy(kv->data.bo.bytes, data, rec->size);
+            kv->data.bo.size = rec->size;
+        }
+        break;
+    default:
+        OBJ_RELEASE(kv);
+        return GDS_ERR_NOT_SUPPORTED;
+    }
+    *kvout = kv;
+    return GDS_SUCCESS;
+}
+
+static int fetch_multiple(const gds_identifier_t *uid,
+                          gds_scope_t scope,
+                          const char *key,
+                          gds_list_t *kvs)
+{
+    plog_record_t *rec;
+    plog_slot_t *slot;
+    gds_value_t *kvnew;
+    gds_identifier_t id;
+    uint64_t n;
+    size_t len = 0;
+    bool prefix = false;
+    int rc = GDS_SUCCESS;
+
+    /* to protect alignment, copy the data across */
+    memcpy(&id, uid, sizeof(gds_identifier_t));
+
+    GDS_OUTPUT_VERBOSE((5, gds_gdstor_base_framework.framework_output,
+                         "gdstor:plog:fetch_multiple: searching for key %s on proc %" PRIu64 "",
+                         (NULL == key) ? "NULL" : key, id));
+
+    if (NULL != key) {
+        /* everything before a wildcard is the prefix to match.
+         * A bare wildcard only matches itself */
+        if (NULL != strchr(key, '*') && 0 < (len = strchr(key, '*') - key)) {
+            prefix = true;
+        } else {
+            len = strlen(key) + 1;
+        }
+    }
+
+    pthread_rwlock_rdlock(&lock);
+    if (NULL == index_hdr) {
+        pthread_rwlock_unlock(&lock);
+        return GDS_ERR_TAKE_NEXT_OPTION;
+    }
+    /* the index isn't ordered by proc, so visit every slot */
+    for (n=0; n < index_hdr->nslots; n++) {
+        slot = &index_slots[n];
+        if (0 == slot->seq || (slot->flags & PLOG_SLOT_REMOVED) || slot->proc != id) {
+            continue;
+        }
+        if (NULL == (rec = segment_read(slot))) {
+            continue;
+        }
+        if (!(scope & rec->scope) ||
+            (NULL != key && prefix &&
+             (rec->keylen <= len || 0 != strncmp(PLOG_RECORD_KEY(rec), key, len))) ||
+            (NULL != key && !prefix &&
+             (rec->keylen != len || 0 != memcmp(PLOG_RECORD_KEY(rec), key, len)))) {
+            free(rec);
+            continue;
+        }
+        rc = record_to_value(rec, &kvnew);
+        free(rec);
+        if (GDS_SUCCESS != rc) {
+            GDS_ERROR_LOG(rc);
+            break;
+        }
+        gds_list_append(kvs, &kvnew->super);
+    }
+    pthread_rwlock_unlock(&lock);
+    return rc;
+}
+
+static int remove_data(const gds_identifier_t *uid, const char *key)
+{
+    plog_record_t *rec;
+    gds_identifier_t id;
+    size_t keylen, len;
+    int rc;
+
+    /* to protect alignment, copy the data across */
+    memcpy(&id, uid, sizeof(gds_identifier_t));
+
+    /* a NULL key removes everything for the proc */
+    keylen = (NULL == key) ? 0 : strlen(key) + 1;
+    len = PLOG_RECORD_LEN(keylen, 0);
+    if (NULL == (rec = (plog_record_t*)calloc(1, len))) {
+        return GDS_ERR_OUT_OF_RESOURCE;
+    }
+    rec->proc = id;
+    rec->keylen = keylen;
+    rec->flags = PLOG_RECORD_TOMBSTONE;
+    if (NULL != key) {
+        memcpy((char*)(rec + 1), key, keylen);
+    }
+
+    pthread_rwlock_wrlock(&lock);
+    if (NULL == index_hdr) {
+        rc = GDS_SUCCESS;
+    } else {
+        rc = log_record(rec, len);
+    }
+    pthread_rwlock_unlock(&lock);
+    free(rec);
+
+    if (GDS_SUCCESS != rc) {
+        GDS_ERROR_LOG(rc);
+    }
+    compact_poke();
+    return rc;
+}
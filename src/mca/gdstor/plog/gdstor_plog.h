@@ -0,0 +1,42 @@
+/*
+ * Copyright (c) 2016      Intel, Inc. All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+#ifndef GDS_GDSTOR_PLOG_H
+#define GDS_GDSTOR_PLOG_H
+
+#include "gds/mca/gdstor/gdstor.h"
+
+BEGIN_C_DECLS
+
+/* Values are appended to a series of log segments kept in a
+ * directory, and located through an index file that is mapped into
+ * memory and updated in place. A restarting server maps the index
+ * and only has to replay whatever was logged after the index was
+ * last brought up to date - so its values survive the restart
+ * without the clients having to publish them again */
+
+GDS_MODULE_DECLSPEC extern gds_gdstor_base_component_t mca_gdstor_plog_component;
+GDS_DECLSPEC extern gds_gdstor_base_module_t gds_gdstor_plog_module;
+
+/* directory holding the log and index - the component is
+ * only available if one is given */
+extern char *gds_gdstor_plog_dir;
+/* bytes in each log segment before moving on to a new one */
+extern size_t gds_gdstor_plog_segment_size;
+/* number of values the index is first sized for */
+extern int gds_gdstor_plog_max_keys;
+/* compact a full segment once less than this percentage
+ * of it still holds current values */
+extern int gds_gdstor_plog_compact_threshold;
+/* flush each change to stable storage before returning */
+extern bool gds_gdstor_plog_sync;
+
+END_C_DECLS
+
+#endif /* GDS_GDSTOR_PLOG_H */
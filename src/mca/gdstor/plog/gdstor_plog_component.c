@@ -0,0 +1,163 @@
+/*
+ * Copyright (c) 2016      Intel, Inc. All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ *
+ * These symbols are in a file by themselves to provide nice linker
+ * semantics.  Since linkers generally pull in symbols by object
+ * files, keeping these symbols as the only symbols in this file
+ * prevents utility programs such as "ompi_info" from having to import
+ * entire components just to query their version and parameters.
+ */
+
+#include "gds_config.h"
+#include "gds/constants.h"
+
+#include "gds/mca/base/base.h"
+#include "gds/util/error.h"
+
+#include "gds/mca/gdstor/gdstor.h"
+#include "gds/mca/gdstor/base/base.h"
+#include "gdstor_plog.h"
+
+static int gdstor_plog_component_open(void);
+static int gdstor_plog_component_query(gds_gdstor_base_module_t **module,
+                                       int *store_priority,
+                                       int *fetch_priority,
+                                       bool restrict_local);
+static int gdstor_plog_component_close(void);
+static int gdstor_plog_component_register(void);
+
+/*
+ * Instantiate the public struct with all of our public information
+ * and pointers to our public functions in it
+ */
+gds_gdstor_base_component_t mca_gdstor_plog_component = {
+    {
+        GDS_GDSTOR_BASE_VERSION_1_0_0,
+
+        /* Component name and version */
+        "plog",
+        GDS_MAJOR_VERSION,
+        GDS_MINOR_VERSION,
+        GDS_RELEASE_VERSION,
+
+        /* Component open and close functions */
+        gdstor_plog_component_open,
+        gdstor_plog_component_close,
+        NULL,
+        gdstor_plog_component_register
+    },
+    {
+        /* The component is checkpoint ready */
+        MCA_BASE_METADATA_PARAM_CHECKPOINT
+    },
+    gdstor_plog_component_query
+};
+
+/* values stored here outlive the process, so take them
+ * ahead of the private store
+ */
+static int my_store_priority = 5;
+/* every fetch costs a read from the log, so look in
+ * the memory-resident stores first
+ */
+static int my_fetch_priority = 50;
+char *gds_gdstor_plog_dir = NULL;
+size_t gds_gdstor_plog_segment_size = 16 * 1024 * 1024;
+int gds_gdstor_plog_max_keys = 4096;
+int gds_gdstor_plog_compact_threshold = 50;
+bool gds_gdstor_plog_sync = false;
+
+static int gdstor_plog_component_open(void)
+{
+    return GDS_SUCCESS;
+}
+
+static int gdstor_plog_component_query(gds_gdstor_base_module_t **module,
+                                       int *store_priority,
+                                       int *fetch_priority,
+                                       bool restrict_local)
+{
+    /* nothing to do unless we have been told where to keep the log */
+    if (NULL == gds_gdstor_plog_dir || '\0' == gds_gdstor_plog_dir[0]) {
+        *module = NULL;
+        return GDS_ERR_NOT_AVAILABLE;
+    }
+    *store_priority = my_store_priority;
+    *fetch_priority = my_fetch_priority;
+    *module = &gds_gdstor_plog_module;
+    return GDS_SUCCESS;
+}
+
+
+static int gdstor_plog_component_close(void)
+{
+    return GDS_SUCCESS;
+}
+
+static int gdstor_plog_component_register(void)
+{
+    mca_base_component_t *c = &mca_gdstor_plog_component.base_version;
+
+    my_store_priority = 5;
+    (void) mca_base_component_var_register(c, "store_priority",
+                                           "Priority dictating order in which store commands will given to database components",
+                                           MCA_BASE_VAR_TYPE_INT, NULL, 0, 0,
+                                           GDS_INFO_LVL_9,
+                                           MCA_BASE_VAR_SCOPE_READONLY,
+                                           &my_store_priority);
+
+    my_fetch_priority = 50;
+    (void) mca_base_component_var_register(c, "fetch_priority",
+                                           "Priority dictating order in which fetch commands will given to database components",
+                                           MCA_BASE_VAR_TYPE_INT, NULL, 0, 0,
+                                           GDS_INFO_LVL_9,
+                                           MCA_BASE_VAR_SCOPE_READONLY,
+                                           &my_fetch_priority);
+
+    gds_gdstor_plog_dir = NULL;
+    (void) mca_base_component_var_register(c, "dir",
+                                           "Directory in which to keep the persistent log and its index (the component is disabled if not given)",
+                                           MCA_BASE_VAR_TYPE_STRING, NULL, 0, 0,
+                                           GDS_INFO_LVL_9,
+                                           MCA_BASE_VAR_SCOPE_READONLY,
+                                           &gds_gdstor_plog_dir);
+
+    gds_gdstor_plog_segment_size = 16 * 1024 * 1024;
+    (void) mca_base_component_var_register(c, "segment_size",
+                                           "Size in bytes a log segment may grow to before a new one is started",
+                                           MCA_BASE_VAR_TYPE_SIZE_T, NULL, 0, 0,
+                                           GDS_INFO_LVL_9,
+                                           MCA_BASE_VAR_SCOPE_READONLY,
+                                           &gds_gdstor_plog_segment_size);
+
+    gds_gdstor_plog_max_keys = 4096;
+    (void) mca_base_component_var_register(c, "max_keys",
+                                           "Number of values a new index is sized for - it grows as needed",
+                                           MCA_BASE_VAR_TYPE_INT, NULL, 0, 0,
+                                           GDS_INFO_LVL_9,
+                                           MCA_BASE_VAR_SCOPE_READONLY,
+                                           &gds_gdstor_plog_max_keys);
+
+    gds_gdstor_plog_compact_threshold = 50;
+    (void) mca_base_component_var_register(c, "compact_threshold",
+                                           "Compact a full log segment once less than this percentage of it holds current values",
+                                           MCA_BASE_VAR_TYPE_INT, NULL, 0, 0,
+                                           GDS_INFO_LVL_9,
+                                           MCA_BASE_VAR_SCOPE_READONLY,
+                                           &gds_gdstor_plog_compact_threshold);
+
+    gds_gdstor_plog_sync = false;
+    (void) mca_base_component_var_register(c, "sync",
+                                           "Flush every change to stable storage before completing it",
+                                           MCA_BASE_VAR_TYPE_BOOL, NULL, 0, 0,
+                                           GDS_INFO_LVL_9,
+                                           MCA_BASE_VAR_SCOPE_READONLY,
+                                           &gds_gdstor_plog_sync);
+
+    return GDS_SUCCESS;
+}
@@ -0,0 +1,57 @@
+# -*- shell-script -*-
+#
+# Copyright (c) 2016      Intel, Inc. All rights reserved.
+#
+# $COPYRIGHT$
+#
+# Additional copyrights may follow
+#
+# $HEADER$
+#
+
+AC_DEFUN([MCA_gds_gdstor_sm_PRIORITY], [20])
+
+#
+# Force this component to compile in static-only mode - the
+# runtime calls gds_dstore_init/finalize directly
+#
+AC_DEFUN([MCA_gds_gdstor_sm_COMPILE_MODE], [
+    AC_MSG_CHECKING([for MCA component $2:$3 compile mode])
+    $4="static"
+    AC_MSG_RESULT([$$4])
+])
+
+# MCA_gdstor_sm_CONFIG([action-if-can-compile],
+#                      [action-if-cant-compile])
+# ------------------------------------------------
+AC_DEFUN([MCA_gds_gdstor_sm_CONFIG],[
+    AC_CONFIG_FILES([src/mca/gdstor/sm/Makefile])
+
+    gds_gdstor_sm_happy=no
+    AS_IF([test "$enable_dstore" = "yes"],
+          [GDS_CHECK_PACKAGE([gds_gdstor_sm],
+              [sys/mman.h],
+              [rt],
+              [shm_open],
+              [],
+              [],
+              [],
+              [gds_gdstor_sm_happy=yes],
+              [gds_gdstor_sm_happy=no])
+           dnl newer C libraries carry shm_open themselves
+           AS_IF([test "$gds_gdstor_sm_happy" = "no"],
+                 [AC_CHECK_FUNC([shm_open],
+                                [gds_gdstor_sm_happy=yes
+                                 gds_gdstor_sm_LIBS=])])
+           AS_IF([test "$gds_gdstor_sm_happy" = "no"],
+                 [AC_MSG_WARN([--enable-dstore was given, but shm_open could not be found])
+                  AC_MSG_ERROR([Cannot continue])])
+          ])
+
+    AS_IF([test "$gds_gdstor_sm_happy" = "yes"],
+          [gds_gdstor_sm_ADD_LIBS=$gds_gdstor_sm_LIBS
+           $1],
+          [$2])
+
+    AC_SUBST(gds_gdstor_sm_LIBS)
+])
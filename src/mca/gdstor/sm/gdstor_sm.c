@@ -0,0 +1,902 @@
+/*
+ * Copyright (c) 2016      Intel, Inc. All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ *
+ */
+
+#include "gds_config.h"
+#include "gds/constants.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "gds_stdint.h"
+#include "gds/dss/dss_types.h"
+#include "gds/util/error.h"
+#include "gds/util/output.h"
+
+#include "gds/mca/gdstor/base/base.h"
+#include "gdstor_sm.h"
+
+static int init(void);
+static void finalize(void);
+static int store(const gds_identifier_t *proc,
+                 gds_scope_t scope,
+                 const char *key, const void *object,
+                 gds_data_type_t type);
+static int store_pointer(const gds_identifier_t *proc,
+                         gds_value_t *kv);
+static int fetch(const gds_identifier_t *proc,
+                 const char *key, void **data,
+                 gds_data_type_t type);
+static int fetch_pointer(const gds_identifier_t *proc,
+                         const char *key,
+                         void **data, gds_data_type_t type);
+static int fetch_multiple(const gds_identifier_t *proc,
+                          gds_scope_t scope,
+                          const char *key,
+                          gds_list_t *kvs);
+static int remove_data(const gds_identifier_t *proc, const char *key);
+
+gds_gdstor_base_module_t gds_gdstor_sm_module = {
+    init,
+    finalize,
+    gds_gdstor_base_set_id,
+    store,
+    store_pointer,
+    NULL,
+    fetch,
+    fetch_pointer,
+    fetch_multiple,
+    remove_data,
+    NULL
+};
+
+/**
+ * Layout of the segment. Each process maps it at a different
+ * address, so everything in it is addressed by its offset from the
+ * start of the segment.
+ *
+ * The header is followed by an open-addressed table of slots, and
+ * then by a heap that entries are appended to. An entry is never
+ * modified or reused once it has been published: an update appends
+ * a new entry and swings the slot over to it, and a removal just
+ * marks the slot. Readers therefore need no locks - any entry they
+ * find stays intact for the life of the segment. The price is that
+ * the space held by replaced and removed values is not recovered,
+ * and once the segment is full further values are left to the next
+ * component.
+ */
+#define SM_MAGIC        0x3154534453444721ULL
+#define SM_VERSION      1
+
+typedef struct {
+    uint64_t magic;         /* written last, once the rest is valid */
+    uint32_t version;
+    uint32_t pad;
+    uint64_t size;          /* total bytes in the segment */
+    uint64_t nslots;        /* always a power of two */
+    uint64_t slots;         /* offset of the slot table */
+    uint64_t heap;          /* offset of the heap */
+    uint64_t heap_used;     /* bytes handed out from the heap */
+    uint64_t nused;         /* slots claimed so far */
+} sm_header_t;
+
+/* a slot is empty until its entry is set, after which it belongs
+ * to that proc and key for good. Entries are 8-byte aligned, so the
+ * low bit is free to mark a value that has been removed */
+typedef struct {
+    uint64_t hash;
+    uint64_t entry;
+} sm_slot_t;
+
+#define SM_REMOVED      1ULL
+/* set along with SM_REMOVED once a value has been left to the next
+ * component. The key stays there from then on - were a later store
+ * to find room here again, the next component would still hold the
+ * old value, and fetch_multiple would find the key in both */
+#define SM_OVERFLOW     2ULL
+
+typedef struct {
+    uint64_t proc;
+    uint64_t size;          /* bytes of data - zero for a NULL string */
+    uint32_t keylen;        /* bytes of key, including the NUL */
+    uint32_t type;
+    uint32_t scope;
+    uint32_t pad;
+    /* followed by the key and then the data, each 8-byte aligned */
+} sm_entry_t;
+
+#define SM_ALIGN(s)     (((s) + 7) & ~((uint64_t)7))
+
+#define SM_ENTRY_KEY(e)     ((const char*)((e) + 1))
+#define SM_ENTRY_DATA(e)    ((const uint8_t*)((e) + 1) + SM_ALIGN((e)->keylen))
+
+/* set by the runtime */
+static bool dstore_active = false;
+static bool is_server = false;
+
+/* our mapping of the segment */
+static uint8_t *base = NULL;
+static size_t base_size = 0;
+static sm_slot_t *slots = NULL;
+static uint64_t nslots = 0;
+static uint64_t heap_offset = 0;
+static char *segment_name = NULL;
+
+/* serializes the server's writers - readers never take it */
+static pthread_mutex_t write_lock = PTHREAD_MUTEX_INITIALIZER;
+
+int gds_dstore_init(bool server)
+{
+    dstore_active = true;
+    is_server = server;
+    return GDS_SUCCESS;
+}
+
+void gds_dstore_finalize(void)
+{
+    if (NULL != base) {
+        munmap(base, base_size);
+        base = NULL;
+        base_size = 0;
+        slots = NULL;
+        nslots = 0;
+    }
+    if (NULL != segment_name) {
+        if (is_server) {
+            shm_unlink(segment_name);
+            unsetenv(GDS_GDSTOR_SM_SEGMENT_ENV);
+        }
+        free(segment_name);
+        segment_name = NULL;
+    }
+    dstore_active = false;
+}
+
+/* the server creates the segment and advertises it to the
+ * clients it will launch */
+static int sm_create(void)
+{
+    char name[64];
+    sm_header_t *hdr;
+    uint64_t n, slots_offset, heap;
+    size_t size;
+    int fd;
+
+    n = 16;
+    while (n < 2 * (uint64_t)(0 < gds_gdstor_sm_max_keys ? gds_gdstor_sm_max_keys : 1)) {
+        n <<= 1;
+    }
+    slots_offset = SM_ALIGN(sizeof(sm_header_t));
+    heap = slots_offset + n * sizeof(sm_slot_t);
+    size = gds_gdstor_sm_segment_size;
+    if (size <= heap) {
+        GDS_OUTPUT_VERBOSE((1, gds_gdstor_base_framework.framework_output,
+                             "gdstor:sm: segment size %lu cannot hold %lu slots",
+                             (unsigned long)size, (unsigned long)n));
+        return GDS_ERR_BAD_PARAM;
+    }
+
+    snprintf(name, sizeof(name), "/gds-sm-%lu-%lu",
+             (unsigned long)getuid(), (unsigned long)getpid());
+    fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (0 > fd && EEXIST == errno) {
+        /* left behind by an earlier server that had our pid */
+        shm_unlink(name);
+        fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+    }
+    if (0 > fd) {
+        GDS_OUTPUT_VERBOSE((1, gds_gdstor_base_framework.framework_output,
+                             "gdstor:sm: cannot create segment %s: %s",
+                             name, strerror(errno)));
+        return GDS_ERR_NOT_AVAILABLE;
+    }
+    if (0 != ftruncate(fd, size)) {
+        close(fd);
+        shm_unlink(name);
+        return GDS_ERR_OUT_OF_RESOURCE;
+    }
+    base = (uint8_t*)mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (MAP_FAILED == base) {
+        base = NULL;
+        shm_unlink(name);
+        return GDS_ERR_OUT_OF_RESOURCE;
+    }
+    if (NULL == (segment_name = strdup(name))) {
+        munmap(base, size);
+        base = NULL;
+        shm_unlink(name);
+        return GDS_ERR_OUT_OF_RESOURCE;
+    }
+    base_size = size;
+    nslots = n;
+    slots = (sm_slot_t*)(base + slots_offset);
+    heap_offset = heap;
+
+    /* a new segment is zero-filled, so every slot starts out empty */
+    hdr = (sm_header_t*)base;
+    hdr->version = SM_VERSION;
+    hdr->size = size;
+    hdr->nslots = n;
+    hdr->slots = slots_offset;
+    hdr->heap = heap;
+    hdr->heap_used = 0;
+    hdr->nused = 0;
+    __atomic_store_n(&hdr->magic, SM_MAGIC, __ATOMIC_RELEASE);
+
+    setenv(GDS_GDSTOR_SM_SEGMENT_ENV, name, 1);
+    return GDS_SUCCESS;
+}
+
+/* a client maps the segment its server advertised - and checks
+ * it thoroughly, since it cannot trust what it finds there */
+static int sm_map(void)
+{
+    const sm_header_t *hdr;
+    struct stat st;
+    char *name;
+    void *ptr;
+    int fd;
+
+    if (NULL == (name = getenv(GDS_GDSTOR_SM_SEGMENT_ENV))) {
+        /* our server isn't sharing its values */
+        return GDS_ERR_NOT_AVAILABLE;
+    }
+    if (0 > (fd = shm_open(name, O_RDONLY, 0))) {
+        GDS_OUTPUT_VERBOSE((1, gds_gdstor_base_framework.framework_output,
+                             "gdstor:sm: cannot open segment %s: %s",
+                             name, strerror(errno)));
+        return GDS_ERR_NOT_AVAILABLE;
+    }
+    if (0 != fstat(fd, &st) || (size_t)st.st_size < sizeof(sm_header_t)) {
+        close(fd);
+        return GDS_ERR_NOT_AVAILABLE;
+    }
+    ptr = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (MAP_FAILED == ptr) {
+        return GDS_ERR_NOT_AVAILABLE;
+    }
+
+    hdr = (const sm_header_t*)ptr;
+    if (SM_MAGIC != __atomic_load_n(&hdr->magic, __ATOMIC_ACQUIRE) ||
+        SM_VERSION != hdr->version ||
+        (uint64_t)st.st_size != hdr->size ||
+        0 == hdr->nslots || 0 != (hdr->nslots & (hdr->nslots - 1)) ||
+        0 != (hdr->slots & 7) || hdr->slots < sizeof(sm_header_t) ||
+        hdr->nslots > (hdr->size - hdr->slots) / sizeof(sm_slot_t) ||
+        hdr->heap < hdr->slots + hdr->nslots * sizeof(sm_slot_t) ||
+        0 != (hdr->heap & 7) || hdr->heap > hdr->size) {
+        GDS_OUTPUT_VERBOSE((1, gds_gdstor_base_framework.framework_output,
+                             "gdstor:sm: segment %s is not valid", name));
+        munmap(ptr, st.st_size);
+        return GDS_ERR_NOT_AVAILABLE;
+    }
+    if (NULL == (segment_name = strdup(name))) {
+        munmap(ptr, st.st_size);
+        return GDS_ERR_OUT_OF_RESOURCE;
+    }
+    base = (uint8_t*)ptr;
+    base_size = st.st_size;
+    nslots = hdr->nslots;
+    slots = (sm_slot_t*)(base + hdr->slots);
+    heap_offset = hdr->heap;
+    return GDS_SUCCESS;
+}
+
+int gds_gdstor_sm_attach(void)
+{
+    if (NULL != base) {
+        return GDS_SUCCESS;
+    }
+    if (!dstore_active) {
+        return GDS_ERR_NOT_AVAILABLE;
+    }
+    return is_server ? sm_create() : sm_map();
+}
+
+static int init(void)
+{
+    return gds_gdstor_sm_attach();
+}
+
+/* the segment belongs to the runtime - see gds_dstore_finalize */
+static void finalize(void)
+{
+}
+
+/****    SEGMENT ACCESS    ****/
+
+/* both server and clients must agree on this, so it
+ * cannot depend on anything local to the process */
+static uint64_t sm_hash(gds_identifier_t id, const char *key)
+{
+    const unsigned char *p;
+    uint64_t h = 0xcbf29ce484222325ULL;
+
+    for (p = (const unsigned char*)key; '\0' != *p; p++) {
+        h ^= *p;
+        h *= 0x100000001b3ULL;
+    }
+    h ^= id * 0x9e3779b97f4a7c15ULL;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return h;
+}
+
+/* translate an offset into an entry, making sure the whole
+ * entry lies within the heap */
+static const sm_entry_t* sm_entry(uint64_t offset)
+{
+    const sm_entry_t *e;
+    uint64_t room;
+
+    offset &= ~(SM_REMOVED | SM_OVERFLOW);
+    if (offset < heap_offset || 0 != (offset & 7) ||
+        offset > base_size - sizeof(sm_entry_t)) {
+        return NULL;
+    }
+    e = (const sm_entry_t*)(base + offset);
+    room = base_size - offset - sizeof(sm_entry_t);
+    if (0 == e->keylen || SM_ALIGN(e->keylen) > room ||
+        e->size > room - SM_ALIGN(e->keylen) ||
+        '\0' != SM_ENTRY_KEY(e)[e->keylen - 1]) {
+        return NULL;
+    }
+    return e;
+}
+
+static inline bool sm_entry_match(const sm_entry_t *e, gds_identifier_t id,
+                                  const char *key, size_t keylen)
+{
+    return (e->proc == id && e->keylen == keylen &&
+            0 == memcmp(SM_ENTRY_KEY(e), key, keylen));
+}
+
+/* find the slot holding the proc and key, or else the empty slot
+ * it would go in. Returns NULL if neither can be found */
+static sm_slot_t* sm_probe(gds_identifier_t id, const char *key,
+                           size_t keylen, uint64_t hash)
+{
+    const sm_entry_t *e;
+    uint64_t n, idx, offset;
+
+    for (n=0, idx = hash & (nslots - 1); n < nslots; n++, idx = (idx + 1) & (nslots - 1)) {
+        offset = __atomic_load_n(&slots[idx].entry, __ATOMIC_ACQUIRE);
+        if (0 == offset) {
+            return &slots[idx];
+        }
+        if (__atomic_load_n(&slots[idx].hash, __ATOMIC_RELAXED) != hash) {
+            continue;
+        }
+        if (NULL != (e = sm_entry(offset)) && sm_entry_match(e, id, key, keylen)) {
+            return &slots[idx];
+        }
+    }
+    return NULL;
+}
+
+/* find the current entry for the proc and key, if any */
+static const sm_entry_t* sm_lookup(gds_identifier_t id, const char *key)
+{
+    sm_slot_t *slot;
+    uint64_t offset;
+    size_t keylen = strlen(key) + 1;
+
+    if (NULL == base) {
+        return NULL;
+    }
+    if (NULL == (slot = sm_probe(id, key, keylen, sm_hash(id, key)))) {
+        return NULL;
+    }
+    offset = __atomic_load_n(&slot->entry, __ATOMIC_ACQUIRE);
+    if (0 == offset || (offset & SM_REMOVED)) {
+        return NULL;
+    }
+    return sm_entry(offset);
+}
+
+/* append an entry to the heap - the caller must hold the write lock */
+static sm_entry_t* sm_alloc(size_t keylen, size_t size, uint64_t *offset)
+{
+    sm_header_t *hdr = (sm_header_t*)base;
+    uint64_t need;
+
+    need = sizeof(sm_entry_t) + SM_ALIGN(keylen) + SM_ALIGN(size);
+    if (need > hdr->size - hdr->heap - hdr->heap_used) {
+        return NULL;
+    }
+    *offset = hdr->heap + hdr->heap_used;
+    hdr->heap_used += need;
+    return (sm_entry_t*)(base + *offset);
+}
+
+/* convert an entry to a value of its own */
+static int sm_copy_value(const sm_entry_t *e, gds_value_t **kvout)
+{
+    gds_value_t *kv;
+    const uint8_t *data = SM_ENTRY_DATA(e);
+
+    if (NULL == (kv = OBJ_NEW(gds_value_t))) {
+        return GDS_ERR_OUT_OF_RESOURCE;
+    }
+    if (NULL == (kv->key = strdup(SM_ENTRY_KEY(e)))) {
+        OBJ_RELEASE(kv);
+        return GDS_ERR_OUT_OF_RESOURCE;
+    }
+    kv->scope = e->scope;
+    kv->type = e->type;
+    switch (e->type) {
+    case GDS_STRING:
+        if (0 < e->size &&
+            NULL == (kv->data.string = strndup((const char*)data, e->size))) {
+            OBJ_RELEASE(kv);
+            return GDS_ERR_OUT_OF_RESOURCE;
+        }
+        break;
+    case GDS_UINT64:
+        memcpy(&kv->data.uint64, data, 8);
+        break;
+    case GDS_UINT32:
+        memcpy(&kv->data.uint32, data, 4);
+        break;
+    case GDS_UINT16:
+        memcpy(&kv->data.uint16, data, 2);
+        break;
+    case GDS_INT:
+        memcpy(&kv->data.integer, data, sizeof(int));
+        break;
+    case GDS_UINT:
+        memcpy(&kv->data.uint, data, sizeof(unsigned int));
+        break;
+    case GDS_FLOAT:
+        memcpy(&kv->data.fval, data, sizeof(float));
+        break;
+    case GDS_BYTE_OBJECT:
+        if (0 < e->size) {
+            if (NULL == (kv->data.bo.bytes = (uint8_t*)malloc(e->size))) {
+                OBJ_RELEASE(kv);
+                return GDS_ERR_OUT_OF_RESOURCE;
+            }
+            memcpy(kv->data.bo.bytes, data, e->size);
+            kv->data.bo.size = e->size;
+        }
+        break;
+    default:
+        OBJ_RELEASE(kv);
+        return GDS_ERR_NOT_SUPPORTED;
+    }
+    *kvout = kv;
+    return GDS_SUCCESS;
+}
+
+
+/****    MODULE FUNCTIONS    ****/
+static int store(const gds_identifier_t *uid,
+                 gds_scope_t scope,
+                 const char *key, const void *data,
+                 gds_data_type_t type)
+{
+    const gds_byte_object_t *boptr;
+    const void *src = NULL;
+    sm_header_t *hdr;
+    sm_slot_t *slot;
+    sm_entry_t *e;
+    gds_identifier_t id;
+    uint64_t hash, offset;
+    size_t keylen, size = 0;
+
+    /* to protect alignment, copy the data across */
+    memcpy(&id, uid, sizeof(gds_identifier_t));
+
+    GDS_OUTPUT_VERBOSE((5, gds_gdstor_base_framework.framework_output,
+                         "gdstor:sm:store storing data for proc %" PRIu64 " for key %s",
+                         id, (NULL == key) ? "NULL" : key));
+
+    /* only the server writes to the segment */
+    if (!is_server || NULL == base) {
+        return GDS_ERR_TAKE_NEXT_OPTION;
+    }
+    if (NULL == key) {
+        GDS_ERROR_LOG(GDS_ERR_BAD_PARAM);
+        return GDS_ERR_BAD_PARAM;
+    }
+
+    /* find the bytes to place in the segment */
+    switch (type) {
+    case GDS_STRING:
+        if (NULL != data) {
+            src = data;
+            size = strlen((const char*)data) + 1;
+        }
+        break;
+    case GDS_UINT64:
+        size = 8;
+        break;
+    case GDS_UINT32:
+        size = 4;
+        break;
+    case GDS_UINT16:
+        size = 2;
+        break;
+    case GDS_INT:
+        size = sizeof(int);
+        break;
+    case GDS_UINT:
+        size = sizeof(unsigned int);
+        break;
+    case GDS_FLOAT:
+        size = sizeof(float);
+        break;
+    case GDS_BYTE_OBJECT:
+        boptr = (const gds_byte_object_t*)data;
+        if (NULL != boptr && NULL != boptr->bytes && 0 < boptr->size) {
+            src = boptr->bytes;
+            size = boptr->size;
+        }
+        break;
+    default:
+        /* we cannot flatten it - leave it to someone who can */
+        return GDS_ERR_TAKE_NEXT_OPTION;
+    }
+    if (GDS_STRING != type && GDS_BYTE_OBJECT != type) {
+        if (NULL == data) {
+            GDS_ERROR_LOG(GDS_ERR_BAD_PARAM);
+            return GDS_ERR_BAD_PARAM;
+        }
+        src = data;
+    }
+
+    keylen = strlen(key) + 1;
+    hash = sm_hash(id, key);
+    hdr = (sm_header_t*)base;
+
+    pthread_mutex_lock(&write_lock);
+    slot = sm_probe(id, key, keylen, hash);
+    if (NULL != slot && (slot->entry & SM_OVERFLOW)) {
+        pthread_mutex_unlock(&write_lock);
+        return GDS_ERR_TAKE_NEXT_OPTION;
+    }
+    if (NULL == slot ||
+        (0 == slot->entry && hdr->nused >= (uint64_t)gds_gdstor_sm_max_keys) ||
+        NULL == (e = sm_alloc(keylen, size, &offset))) {
+        /* out of room - make sure the clients don't keep
+         * finding the old value, and let the next component
+         * hold the new one */
+        if (NULL != slot && 0 != slot->entry) {
+            __atomic_fetch_or(&slot->entry, SM_REMOVED | SM_OVERFLOW, __ATOMIC_RELEASE);
+        } else if (NULL != slot && hdr->nused < (uint64_t)gds_gdstor_sm_max_keys &&
+                   NULL != (e = sm_alloc(keylen, 0, &offset))) {
+            /* claim the slot with an entry holding just the key, so
+             * that sm_probe finds it again and the key stays with
+             * the next component. If not even that fits, there is
+             * no need - the heap never shrinks, so no later store
+             * of the key can fit either */
+            e->proc = id;
+            e->size = 0;
+            e->keylen = keylen;
+            e->type = GDS_UNDEF;
+            e->scope = scope;
+            e->pad = 0;
+            memcpy((char*)(e + 1), key, keylen);
+            __atomic_store_n(&slot->hash, hash, __ATOMIC_RELAXED);
+            __atomic_store_n(&slot->entry, offset | SM_REMOVED | SM_OVERFLOW, __ATOMIC_RELEASE);
+            hdr->nused++;
+        }
+        pthread_mutex_unlock(&write_lock);
+        GDS_OUTPUT_VERBOSE((2, gds_gdstor_base_framework.framework_output,
+                             "gdstor:sm:store segment full - cannot store key %s", key));
+        return GDS_ERR_TAKE_NEXT_OPTION;
+    }
+    e->proc = id;
+    e->size = size;
+    e->keylen = keylen;
+    e->type = type;
+    e->scope = scope;
+    e->pad = 0;
+    memcpy((char*)(e + 1), key, keylen);
+    if (0 < size) {
+        memcpy((uint8_t*)SM_ENTRY_DATA(e), src, size);
+    }
+
+    /* publish it - the entry must be complete before anyone can
+     * reach it, and a new slot's hash set before its entry */
+    if (0 == slot->entry) {
+        __atomic_store_n(&slot->hash, hash, __ATOMIC_RELAXED);
+        hdr->nused++;
+    }
+    __atomic_store_n(&slot->entry, offset, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&write_lock);
+
+    return GDS_SUCCESS;
+}
+
+static int store_pointer(const gds_identifier_t *uid,
+                         gds_value_t *kv)
+{
+    /* a pointer means nothing to the other processes on
+     * the node - keep it in the process that stored it */
+    return GDS_ERR_TAKE_NEXT_OPTION;
+}
+
+static int fetch(const gds_identifier_t *uid,
+                 const char *key, void **data,
+                 gds_data_type_t type)
+{
+    const sm_entry_t *e;
+    const uint8_t *src;
+    gds_byte_object_t *boptr;
+    gds_identifier_t id;
+
+    /* to protect alignment, copy the data across */
+    memcpy(&id, uid, sizeof(gds_identifier_t));
+
+    GDS_OUTPUT_VERBOSE((5, gds_gdstor_base_framework.framework_output,
+                         "gdstor:sm:fetch: searching for key %s on proc %" PRIu64 "",
+                         (NULL == key) ? "NULL" : key, id));
+
+    /* if the key is NULL, that is an error */
+    if (NULL == key) {
+        GDS_ERROR_LOG(GDS_ERR_BAD_PARAM);
+        return GDS_ERR_BAD_PARAM;
+    }
+
+    if (NULL == (e = sm_lookup(id, key))) {
+        /* let them look elsewhere for it */
+        return GDS_ERR_TAKE_NEXT_OPTION;
+    }
+    if (type != e->type) {
+        return GDS_ERR_TYPE_MISMATCH;
+    }
+    src = SM_ENTRY_DATA(e);
+
+    switch (type) {
+    case GDS_STRING:
+        if (0 < e->size) {
+            if (NULL == (*data = strndup((const char*)src, e->size))) {
+                return GDS_ERR_OUT_OF_RESOURCE;
+            }
+        } else {
+            *data = NULL;
+        }
+        break;
+    case GDS_UINT64:
+        memcpy(*data, src, 8);
+        break;
+    case GDS_UINT32:
+        memcpy(*data, src, 4);
+        break;
+    case GDS_UINT16:
+        memcpy(*data, src, 2);
+        break;
+    case GDS_INT:
+        memcpy(*data, src, sizeof(int));
+        break;
+    case GDS_UINT:
+        memcpy(*data, src, sizeof(unsigned int));
+        break;
+    case GDS_FLOAT:
+        memcpy(*data, src, sizeof(float));
+        break;
+    case GDS_BYTE_OBJECT:
+        if (NULL == (boptr = (gds_byte_object_t*)malloc(sizeof(gds_byte_object_t)))) {
+            return GDS_ERR_OUT_OF_RESOURCE;
+        }
+        if (0 < e->size) {
+            if (NULL == (boptr->bytes = (uint8_t *) malloc(e->size))) {
+                free(boptr);
+                return GDS_ERR_OUT_OF_RESOURCE;
+            }
+            memcpy(boptr->bytes, src, e->size);
+            boptr->size = e->size;
+        } else {
+            boptr->bytes = NULL;
+            boptr->size = 0;
+        }
+        *data = boptr;
+        break;
+    default:
+        GDS_ERROR_LOG(GDS_ERR_NOT_SUPPORTED);
+        return GDS_ERR_NOT_SUPPORTED;
+    }
+
+    return GDS_SUCCESS;
+}
+
+/* the returned pointer is into the segment itself, and remains
+ * valid until the dstore is finalized - even if the value is
+ * replaced or removed in the meantime */
+static int fetch_pointer(const gds_identifier_t *uid,
+                         const char *key,
+                         void **data, gds_data_type_t type)
+{
+    const sm_entry_t *e;
+    gds_identifier_t id;
+
+    /* to protect alignment, copy the data across */
+    memcpy(&id, uid, sizeof(gds_identifier_t));
+
+    GDS_OUTPUT_VERBOSE((5, gds_gdstor_base_framework.framework_output,
+                         "gdstor:sm:fetch_pointer: searching for key %s on proc %" PRIu64 "",
+                         (NULL == key) ? "NULL" : key, id));
+
+    /* if the key is NULL, that is an error */
+    if (NULL == key) {
+        GDS_ERROR_LOG(GDS_ERR_BAD_PARAM);
+        return GDS_ERR_BAD_PARAM;
+    }
+
+    if (NULL == (e = sm_lookup(id, key))) {
+        /* let them look elsewhere for it */
+        return GDS_ERR_TAKE_NEXT_OPTION;
+    }
+    if (type != e->type) {
+        return GDS_ERR_TYPE_MISMATCH;
+    }
+
+    switch (type) {
+    case GDS_STRING:
+        *data = (0 < e->size) ? (void*)SM_ENTRY_DATA(e) : NULL;
+        break;
+    case GDS_UINT64:
+    case GDS_UINT32:
+    case GDS_UINT16:
+    case GDS_INT:
+    case GDS_UINT:
+    case GDS_FLOAT:
+        *data = (void*)SM_ENTRY_DATA(e);
+        break;
+    default:
+        /* a byte object would need a gds_byte_object_t of its
+         * own, and the segment can only hold the bytes */
+        GDS_ERROR_LOG(GDS_ERR_NOT_SUPPORTED);
+        return GDS_ERR_NOT_SUPPORTED;
+    }
+
+    return GDS_SUCCESS;
+}
+
+/* whether a key is among the values from the head of the list
+ * up to last - those put there before we were asked */
+static bool sm_listed(gds_list_t *kvs, gds_list_item_t *last, const char *key)
+{
+    gds_list_item_t *item;
+
+    if (NULL == last) {
+        return false;
+    }
+    for (item = gds_list_get_first(kvs); ; item = gds_list_get_next(item)) {
+        if (NULL != ((gds_value_t*)item)->key &&
+            0 == strcmp(((gds_value_t*)item)->key, key)) {
+            return true;
+        }
+        if (item == last) {
+            return false;
+        }
+    }
+}
+
+static int fetch_multiple(const gds_identifier_t *uid,
+                          gds_scope_t scope,
+                          const char *key,
+                          gds_list_t *kvs)
+{
+    const sm_entry_t *e;
+    gds_value_t *kvnew;
+    gds_list_item_t *last;
+    gds_identifier_t id;
+    uint64_t n, offset;
+    size_t len = 0;
+    bool prefix = false;
+    int rc;
+
+    /* to protect alignment, copy the data across */
+    memcpy(&id, uid, sizeof(gds_identifier_t));
+
+    GDS_OUTPUT_VERBOSE((5, gds_gdstor_base_framework.framework_output,
+                         "gdstor:sm:fetch_multiple: searching for key %s on proc %" PRIu64 "",
+                         (NULL == key) ? "NULL" : key, id));
+
+    if (NULL == base) {
+        return GDS_ERR_TAKE_NEXT_OPTION;
+    }
+
+    if (NULL != key) {
+        /* everything before a wildcard is the prefix to match.
+         * A bare wildcard only matches itself */
+        if (NULL != strchr(key, '*') && 0 < (len = strchr(key, '*') - key)) {
+            prefix = true;
+        } else {
+            len = strlen(key) + 1;
+        }
+    }
+
+    /* a key that overflowed once lives in the next component
+     * alone, but don't hand back any key twice regardless */
+    last = gds_list_is_empty(kvs) ? NULL : gds_list_get_last(kvs);
+
+    /* the table isn't ordered by proc, so visit every slot */
+    for (n=0; n < nslots; n++) {
+        offset = __atomic_load_n(&slots[n].entry, __ATOMIC_ACQUIRE);
+        if (0 == offset || (offset & SM_REMOVED)) {
+            continue;
+        }
+        if (NULL == (e = sm_entry(offset)) || e->proc != id) {
+            continue;
+        }
+        /* check for a matching scope */
+        if (!(scope & e->scope)) {
+            continue;
+        }
+        if (NULL != key) {
+            if (prefix) {
+                if (e->keylen <= len || 0 != strncmp(SM_ENTRY_KEY(e), key, len)) {
+                    continue;
+                }
+            } else if (!sm_entry_match(e, id, key, len)) {
+                continue;
+            }
+        }
+        if (sm_listed(kvs, last, SM_ENTRY_KEY(e))) {
+            continue;
+        }
+        if (GDS_SUCCESS != (rc = sm_copy_value(e, &kvnew))) {
+            GDS_ERROR_LOG(rc);
+            return rc;
+        }
+        gds_list_append(kvs, &kvnew->super);
+    }
+    return GDS_SUCCESS;
+}
+
+static int remove_data(const gds_identifier_t *uid, const char *key)
+{
+    const sm_entry_t *e;
+    sm_slot_t *slot;
+    gds_identifier_t id;
+    uint64_t n, offset;
+
+    /* to protect alignment, copy the data across */
+    memcpy(&id, uid, sizeof(gds_identifier_t));
+
+    /* clients hold nothing here of their own */
+    if (!is_server || NULL == base) {
+        return GDS_SUCCESS;
+    }
+
+    pthread_mutex_lock(&write_lock);
+    if (NULL == key) {
+        /* remove all data for this proc */
+        for (n=0; n < nslots; n++) {
+            offset = slots[n].entry;
+            if (0 == offset || (offset & SM_REMOVED)) {
+                continue;
+            }
+            if (NULL != (e = sm_entry(offset)) && e->proc == id) {
+                __atomic_store_n(&slots[n].entry, offset | SM_REMOVED, __ATOMIC_RELEASE);
+            }
+        }
+    } else {
+        slot = sm_probe(id, key, strlen(key) + 1, sm_hash(id, key));
+        if (NULL != slot && 0 != slot->entry) {
+            __atomic_store_n(&slot->entry, slot->entry | SM_REMOVED, __ATOMIC_RELEASE);
+        }
+    }
+    pthread_mutex_unlock(&write_lock);
+
+    return GDS_SUCCESS;
+}
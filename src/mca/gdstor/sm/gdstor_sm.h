@@ -0,0 +1,45 @@
+/*
+ * Copyright (c) 2016      Intel, Inc. All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+#ifndef GDS_GDSTOR_SM_H
+#define GDS_GDSTOR_SM_H
+
+#include "gds/mca/gdstor/gdstor.h"
+
+BEGIN_C_DECLS
+
+/* The server places the values it stores in a shared-memory
+ * segment, and the local clients map that segment read-only and
+ * look values up directly instead of asking the server for them.
+ * The server publishes the name of the segment in this envar so
+ * the clients it launches can find it */
+#define GDS_GDSTOR_SM_SEGMENT_ENV   "GDS_DSTORE_SEGMENT"
+
+GDS_MODULE_DECLSPEC extern gds_gdstor_base_component_t mca_gdstor_sm_component;
+GDS_DECLSPEC extern gds_gdstor_base_module_t gds_gdstor_sm_module;
+
+/* size of the segment, in bytes - it is never grown, so values
+ * that don't fit are left to the next component */
+extern size_t gds_gdstor_sm_segment_size;
+/* number of values the segment can index */
+extern int gds_gdstor_sm_max_keys;
+
+/* Called by the runtime - records whether we are the server that
+ * owns the segment or a client reading it. The segment itself is
+ * created (or mapped) when the component is selected */
+GDS_DECLSPEC int gds_dstore_init(bool server);
+/* Unmap the segment - the server also removes it */
+GDS_DECLSPEC void gds_dstore_finalize(void);
+
+/* map or create the segment, if that hasn't already been done */
+int gds_gdstor_sm_attach(void);
+
+END_C_DECLS
+
+#endif /* GDS_GDSTOR_SM_H */
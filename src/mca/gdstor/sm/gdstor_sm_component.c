@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2016      Intel, Inc. All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ *
+ * These symbols are in a file by themselves to provide nice linker
+ * semantics.  Since linkers generally pull in symbols by object
+ * files, keeping these symbols as the only symbols in this file
+ * prevents utility programs such as "ompi_info" from having to import
+ * entire components just to query their version and parameters.
+ */
+
+#include "gds_config.h"
+#include "gds/constants.h"
+
+#include "gds/mca/base/base.h"
+#include "gds/util/error.h"
+
+#include "gds/mca/gdstor/gdstor.h"
+#include "gds/mca/gdstor/base/base.h"
+#include "gdstor_sm.h"
+
+static int gdstor_sm_component_open(void);
+static int gdstor_sm_component_query(gds_gdstor_base_module_t **module,
+                                     int *store_priority,
+                                     int *fetch_priority,
+                                     bool restrict_local);
+static int gdstor_sm_component_close(void);
+static int gdstor_sm_component_register(void);
+
+/*
+ * Instantiate the public struct with all of our public information
+ * and pointers to our public functions in it
+ */
+gds_gdstor_base_component_t mca_gdstor_sm_component = {
+    {
+        GDS_GDSTOR_BASE_VERSION_1_0_0,
+
+        /* Component name and version */
+        "sm",
+        GDS_MAJOR_VERSION,
+        GDS_MINOR_VERSION,
+        GDS_RELEASE_VERSION,
+
+        /* Component open and close functions */
+        gdstor_sm_component_open,
+        gdstor_sm_component_close,
+        NULL,
+        gdstor_sm_component_register
+    },
+    {
+        /* The component is checkpoint ready */
+        MCA_BASE_METADATA_PARAM_CHECKPOINT
+    },
+    gdstor_sm_component_query
+};
+
+/* the server should put values here ahead of its private
+ * store, so the local clients can see them
+ */
+static int my_store_priority = 10;
+/* the server's private store is cheaper to search, and
+ * holds whatever didn't fit here, so let it look first
+ */
+static int my_fetch_priority = 90;
+size_t gds_gdstor_sm_segment_size = 64 * 1024 * 1024;
+int gds_gdstor_sm_max_keys = 65536;
+
+static int gdstor_sm_component_open(void)
+{
+    return GDS_SUCCESS;
+}
+
+static int gdstor_sm_component_query(gds_gdstor_base_module_t **module,
+                                     int *store_priority,
+                                     int *fetch_priority,
+                                     bool restrict_local)
+{
+    /* only available if the runtime set up the dstore and
+     * the segment could be created or found */
+    if (GDS_SUCCESS != gds_gdstor_sm_attach()) {
+        *module = NULL;
+        return GDS_ERR_NOT_AVAILABLE;
+    }
+    *store_priority = my_store_priority;
+    *fetch_priority = my_fetch_priority;
+    *module = &gds_gdstor_sm_module;
+    return GDS_SUCCESS;
+}
+
+
+static int gdstor_sm_component_close(void)
+{
+    return GDS_SUCCESS;
+}
+
+static int gdstor_sm_component_register(void)
+{
+    mca_base_component_t *c = &mca_gdstor_sm_component.base_version;
+
+    my_store_priority = 10;
+    (void) mca_base_component_var_register(c, "store_priority",
+                                           "Priority dictating order in which store commands will given to database components",
+                                           MCA_BASE_VAR_TYPE_INT, NULL, 0, 0,
+                                           GDS_INFO_LVL_9,
+                                           MCA_BASE_VAR_SCOPE_READONLY,
+                                           &my_store_priority);
+
+    my_fetch_priority = 90;
+    (void) mca_base_component_var_register(c, "fetch_priority",
+                                           "Priority dictating order in which fetch commands will given to database components",
+                                           MCA_BASE_VAR_TYPE_INT, NULL, 0, 0,
+                                           GDS_INFO_LVL_9,
+                                           MCA_BASE_VAR_SCOPE_READONLY,
+                                           &my_fetch_priority);
+
+    gds_gdstor_sm_segment_size = 64 * 1024 * 1024;
+    (void) mca_base_component_var_register(c, "segment_size",
+                                           "Size in bytes of the shared-memory segment the server stores values in",
+                                           MCA_BASE_VAR_TYPE_SIZE_T, NULL, 0, 0,
+                                           GDS_INFO_LVL_9,
+                                           MCA_BASE_VAR_SCOPE_READONLY,
+                                           &gds_gdstor_sm_segment_size);
+
+    gds_gdstor_sm_max_keys = 65536;
+    (void) mca_base_component_var_register(c, "max_keys",
+                                           "Maximum number of values the shared-memory segment can index",
+                                           MCA_BASE_VAR_TYPE_INT, NULL, 0, 0,
+                                           GDS_INFO_LVL_9,
+                                           MCA_BASE_VAR_SCOPE_READONLY,
+                                           &gds_gdstor_sm_max_keys);
+
+    return GDS_SUCCESS;
+}
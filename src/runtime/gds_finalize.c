@@ -27,6 +27,7 @@
 #include "src/class/gds_object.h"
 #include "src/client/gds_client_ops.h"
 #include "src/usock/usock.h"
+#include "src/util/atom.h"
 #include "src/util/output.h"
 #include "src/util/keyval_parse.h"
 #include "src/util/show_help.h"
@@ -35,6 +36,9 @@
 #include "src/mca/pinstalldirs/base/base.h"
 #include "src/mca/bfrops/base/base.h"
 #include "src/mca/psec/base/base.h"
+#if defined(GDS_ENABLE_DSTORE) && (GDS_ENABLE_DSTORE == 1)
+#include "src/mca/gdstor/sm/gdstor_sm.h"
+#endif
 #include GDS_EVENT_HEADER
 
 #include "src/runtime/gds_rte.h"
@@ -117,6 +121,9 @@ void gds_rte_finalize(void)
     }
     GDS_DESTRUCT(&gds_globals.events);
 
+    /* release the key dictionary */
+    gds_atom_finalize();
+
     #if GDS_NO_LIB_DESTRUCTOR
         gds_cleanup();
     #endif
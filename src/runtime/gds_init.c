@@ -44,8 +44,12 @@
 #include "src/event/gds_event.h"
 #include "src/include/types.h"
 #include "src/usock/usock.h"
+#include "src/util/atom.h"
 #include "src/util/error.h"
 #include "src/util/keyval_parse.h"
+#if defined(GDS_ENABLE_DSTORE) && (GDS_ENABLE_DSTORE == 1)
+#include "src/mca/gdstor/sm/gdstor_sm.h"
+#endif
 
 #include "src/runtime/gds_rte.h"
 #include "src/runtime/gds_progress_threads.h"
@@ -145,6 +149,12 @@ int gds_rte_init(gds_proc_type_t type,
         goto return_error;
     }
 
+    /* setup the key dictionary */
+    if (GDS_SUCCESS != (ret = gds_atom_init())) {
+        error = "gds_atom_init";
+        goto return_error;
+    }
+
     /* setup the globals structure */
     gds_globals.proc_type = type;
     memset(&gds_globals.myid, 0, sizeof(gds_proc_t));
@@ -207,8 +217,9 @@ int gds_rte_init(gds_proc_type_t type,
 
     /* setup the dstore support, if enabled */
     #if defined(GDS_ENABLE_DSTORE) && (GDS_ENABLE_DSTORE == 1)
-        if (GDS_SUCCESS != (rc = gds_dstore_init())) {
-            return rc;
+        if (GDS_SUCCESS != (ret = gds_dstore_init(GDS_PROC_SERVER == type))) {
+            error = "gds_dstore_init";
+            goto return_error;
         }
     #endif /* GDS_ENABLE_DSTORE */
 
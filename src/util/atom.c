@@ -0,0 +1,281 @@
+/*
+ * Copyright (c) 2016      Intel, Inc. All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+#include <src/include/gds_config.h>
+
+#include <string.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#include <gds.h>
+
+#include "src/include/hash_string.h"
+#include "src/util/atom.h"
+
+/* the atom-to-key map is kept as a fixed directory of chunks so that
+ * a chunk never moves once allocated - this lets gds_atom_key run
+ * without taking the lock. A new atom's chunk and key are filled in
+ * before atom_next is advanced past it with a release store, so a
+ * reader that loads atom_next with acquire and finds the atom below
+ * it sees both */
+#define GDS_ATOM_CHUNK_SIZE     256
+#define GDS_ATOM_MAX_CHUNKS     4096
+
+/* the key-to-atom map is an open-addressed table that is only ever
+ * added to. Each slot is one word - the top half of the key's hash
+ * and its atom - stored with release once the atom's key is in
+ * place, so lookups take no lock and write nothing shared: they run
+ * on every fetch, and must not serialize the readers on one cache
+ * line. The table is kept under half full. To grow it, a new table
+ * is filled and published in its place; readers may still be
+ * probing the old one, so it is only freed by gds_atom_finalize */
+#define GDS_ATOM_INDEX_SIZE     512
+
+typedef struct atom_index_t {
+    struct atom_index_t *prev;      // table this one replaced
+    uint64_t mask;
+    uint64_t slots[];
+} atom_index_t;
+
+#define GDS_ATOM_SLOT(hash, atom)   (((hash) & 0xffffffff00000000ULL) | (uint64_t)(atom))
+#define GDS_ATOM_SLOT_ATOM(s)       ((gds_atom_t)((s) & 0xffffffffULL))
+
+/* serializes the writers - readers never take it */
+static pthread_mutex_t atom_lock = PTHREAD_MUTEX_INITIALIZER;
+static bool atom_initialized = false;
+static atom_index_t *atom_index = NULL;     // key string -> atom
+static char **atom_keys[GDS_ATOM_MAX_CHUNKS];
+static gds_atom_t atom_next = 1;
+/* the runtime and every datastore hold a reference, so the key
+ * strings outlive anything that may still point at them */
+static int atom_refs = 0;
+
+static atom_index_t* atom_index_new(uint64_t nslots)
+{
+    atom_index_t *idx;
+
+    idx = (atom_index_t*)calloc(1, sizeof(atom_index_t) + nslots * sizeof(uint64_t));
+    if (NULL != idx) {
+        idx->mask = nslots - 1;
+    }
+    return idx;
+}
+
+/* put an atom in a slot - the lock must be held */
+static void atom_index_put(atom_index_t *idx, uint64_t hash, gds_atom_t atom)
+{
+    uint64_t n;
+
+    for (n = hash & idx->mask; 0 != idx->slots[n]; n = (n + 1) & idx->mask);
+    __atomic_store_n(&idx->slots[n], GDS_ATOM_SLOT(hash, atom), __ATOMIC_RELEASE);
+}
+
+/* find a key's atom - safe to call without the lock */
+static gds_atom_t atom_index_find(const char *key, size_t len)
+{
+    atom_index_t *idx;
+    uint64_t hash, n, slot;
+    gds_atom_t atom;
+    const char *k;
+
+    if (NULL == (idx = __atomic_load_n(&atom_index, __ATOMIC_ACQUIRE))) {
+        return GDS_ATOM_INVALID;
+    }
+    hash = gds_hash_bytes(key, len, 0);
+    for (n = hash & idx->mask; ; n = (n + 1) & idx->mask) {
+        if (0 == (slot = __atomic_load_n(&idx->slots[n], __ATOMIC_ACQUIRE))) {
+            return GDS_ATOM_INVALID;
+        }
+        if (GDS_ATOM_SLOT(hash, 0) != GDS_ATOM_SLOT(slot, 0)) {
+            continue;
+        }
+        atom = GDS_ATOM_SLOT_ATOM(slot);
+        k = atom_keys[atom / GDS_ATOM_CHUNK_SIZE][atom % GDS_ATOM_CHUNK_SIZE];
+        if (0 == strcmp(k, key)) {
+            return atom;
+        }
+    }
+}
+
+/* make room for one more atom, keeping the table under half
+ * full - the lock must be held */
+static gds_status_t atom_index_reserve(void)
+{
+    atom_index_t *idx;
+    gds_atom_t atom;
+    const char *k;
+
+    if (2 * atom_next <= atom_index->mask + 1) {
+        return GDS_SUCCESS;
+    }
+    if (NULL == (idx = atom_index_new(2 * (atom_index->mask + 1)))) {
+        return GDS_ERR_OUT_OF_RESOURCE;
+    }
+    for (atom = 1; atom < atom_next; atom++) {
+        k = atom_keys[atom / GDS_ATOM_CHUNK_SIZE][atom % GDS_ATOM_CHUNK_SIZE];
+        atom_index_put(idx, gds_hash_bytes(k, strlen(k), 0), atom);
+    }
+    idx->prev = atom_index;
+    __atomic_store_n(&atom_index, idx, __ATOMIC_RELEASE);
+    return GDS_SUCCESS;
+}
+
+/* build the dictionary if need be - the lock must be held */
+static gds_status_t atom_setup(void)
+{
+    atom_index_t *idx;
+
+    if (atom_initialized) {
+        return GDS_SUCCESS;
+    }
+    if (NULL == (idx = atom_index_new(GDS_ATOM_INDEX_SIZE))) {
+        return GDS_ERR_OUT_OF_RESOURCE;
+    }
+    memset(atom_keys, 0, sizeof(atom_keys));
+    atom_next = 1;
+    __atomic_store_n(&atom_index, idx, __ATOMIC_RELEASE);
+    atom_initialized = true;
+    return GDS_SUCCESS;
+}
+
+gds_status_t gds_atom_init(void)
+{
+    gds_status_t rc;
+
+    pthread_mutex_lock(&atom_lock);
+    if (GDS_SUCCESS == (rc = atom_setup())) {
+        atom_refs++;
+    }
+    pthread_mutex_unlock(&atom_lock);
+    return rc;
+}
+
+/* nothing may be looking keys up by then */
+void gds_atom_finalize(void)
+{
+    atom_index_t *idx;
+    size_t n, m;
+
+    pthread_mutex_lock(&atom_lock);
+    if (atom_initialized && 0 < atom_refs && 0 == --atom_refs) {
+        for (n=0; n < GDS_ATOM_MAX_CHUNKS && NULL != atom_keys[n]; n++) {
+            for (m=0; m < GDS_ATOM_CHUNK_SIZE; m++) {
+                if (NULL != atom_keys[n][m]) {
+                    free(atom_keys[n][m]);
+                }
+            }
+            free(atom_keys[n]);
+            atom_keys[n] = NULL;
+        }
+        while (NULL != (idx = atom_index)) {
+            atom_index = idx->prev;
+            free(idx);
+        }
+        atom_next = 1;
+        atom_initialized = false;
+    }
+    pthread_mutex_unlock(&atom_lock);
+}
+
+gds_status_t gds_atom_intern(const char *key, gds_atom_t *atom)
+{
+    size_t len, chunk, slot;
+    gds_atom_t found;
+    char *copy;
+    gds_status_t rc;
+
+    if (NULL == key || NULL == atom) {
+        return GDS_ERR_BAD_PARAM;
+    }
+    if (!atom_initialized) {
+        /* used before init - build the dictionary, but without
+         * taking a reference on anyone's behalf */
+        pthread_mutex_lock(&atom_lock);
+        rc = atom_setup();
+        pthread_mutex_unlock(&atom_lock);
+        if (GDS_SUCCESS != rc) {
+            return rc;
+        }
+    }
+
+    len = strlen(key);
+    if (GDS_ATOM_INVALID != (found = atom_index_find(key, len))) {
+        *atom = found;
+        return GDS_SUCCESS;
+    }
+
+    /* someone may add it before we get the lock */
+    pthread_mutex_lock(&atom_lock);
+    if (GDS_ATOM_INVALID != (found = atom_index_find(key, len))) {
+        *atom = found;
+        pthread_mutex_unlock(&atom_lock);
+        return GDS_SUCCESS;
+    }
+
+    /* new key - assign it the next atom */
+    chunk = atom_next / GDS_ATOM_CHUNK_SIZE;
+    slot = atom_next % GDS_ATOM_CHUNK_SIZE;
+    if (GDS_ATOM_MAX_CHUNKS <= chunk) {
+        pthread_mutex_unlock(&atom_lock);
+        return GDS_ERR_OUT_OF_RESOURCE;
+    }
+    if (NULL == atom_keys[chunk]) {
+        atom_keys[chunk] = (char**)calloc(GDS_ATOM_CHUNK_SIZE, sizeof(char*));
+        if (NULL == atom_keys[chunk]) {
+            pthread_mutex_unlock(&atom_lock);
+            return GDS_ERR_OUT_OF_RESOURCE;
+        }
+    }
+    if (NULL == (copy = strdup(key))) {
+        pthread_mutex_unlock(&atom_lock);
+        return GDS_ERR_OUT_OF_RESOURCE;
+    }
+    if (GDS_SUCCESS != (rc = atom_index_reserve())) {
+        free(copy);
+        pthread_mutex_unlock(&atom_lock);
+        return rc;
+    }
+    /* the key must be in place before the slot points at it */
+    atom_keys[chunk][slot] = copy;
+    atom_index_put(atom_index, gds_hash_bytes(key, len, 0), atom_next);
+    *atom = atom_next;
+    __atomic_store_n(&atom_next, atom_next + 1, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&atom_lock);
+    return GDS_SUCCESS;
+}
+
+gds_atom_t gds_atom_lookup(const char *key)
+{
+    if (NULL == key) {
+        return GDS_ATOM_INVALID;
+    }
+    return atom_index_find(key, strlen(key));
+}
+
+const char* gds_atom_key(gds_atom_t atom)
+{
+    /* atoms at or above atom_next have never been handed out */
+    if (GDS_ATOM_INVALID == atom ||
+        __atomic_load_n(&atom_next, __ATOMIC_ACQUIRE) <= atom) {
+        return NULL;
+    }
+    return atom_keys[atom / GDS_ATOM_CHUNK_SIZE][atom % GDS_ATOM_CHUNK_SIZE];
+}
+
+/****    PUBLIC INTERFACE    ****/
+
+gds_status_t GDS_Intern_key(const char key[], gds_atom_t *atom)
+{
+    return gds_atom_intern(key, atom);
+}
+
+const char* GDS_Atom_key(gds_atom_t atom)
+{
+    return gds_atom_key(atom);
+}
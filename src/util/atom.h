@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) 2016      Intel, Inc. All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+/** @file
+ *
+ * Process-wide key dictionary. The key vocabulary used by callers
+ * is small (a few hundred strings) but is repeated across every
+ * process whose data we hold, so each distinct key is stored once
+ * and referred to everywhere else by a 32-bit atom. Atoms are
+ * assigned sequentially starting at 1 and are never recycled, so
+ * the string returned for an atom remains valid until
+ * gds_atom_finalize is called.
+ */
+
+#ifndef GDS_ATOM_H
+#define GDS_ATOM_H
+
+#include <src/include/gds_config.h>
+#include <gds_common.h>
+
+BEGIN_C_DECLS
+
+/* setup/teardown the dictionary. Each successful init takes a
+ * reference - anything that keeps pointers to the key strings
+ * (the runtime, each datastore) inits on startup and finalizes
+ * when done with them, and the strings are only released when
+ * the last reference goes */
+gds_status_t gds_atom_init(void);
+void gds_atom_finalize(void);
+
+/* return the atom for the given key, adding the
+ * key to the dictionary if it isn't already present */
+gds_status_t gds_atom_intern(const char *key, gds_atom_t *atom);
+
+/* return the atom for the given key without adding it to
+ * the dictionary - returns GDS_ATOM_INVALID if the key has
+ * never been interned, which means nothing can have been
+ * stored under it */
+gds_atom_t gds_atom_lookup(const char *key);
+
+/* return the key string for an atom, or NULL if the atom
+ * is unknown. The string must NOT be free'd */
+const char* gds_atom_key(gds_atom_t atom);
+
+END_C_DECLS
+
+#endif /* GDS_ATOM_H */
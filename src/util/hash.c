@@ -26,11 +26,15 @@
 #include <src/include/hash_string.h>
 
 #include <string.h>
+#include <stdlib.h>
 
 #include "src/include/gds_globals.h"
+#include "src/include/prefetch.h"
 #include "src/class/gds_hash_table.h"
+#include "src/class/gds_key_index.h"
 #include "src/class/gds_pointer_array.h"
 #include "src/mca/bfrops/bfrops.h"
+#include "src/util/atom.h"
 #include "src/util/error.h"
 #include "src/util/output.h"
 
@@ -47,30 +51,67 @@ typedef struct {
     /* List of gds_kval_t structures containing all data
        received from this process */
     gds_list_t data;
+    /* index of the entries on the data list by key atom */
+    gds_key_index_t index;
 } gds_proc_data_t;
 static void pdcon(gds_proc_data_t *p)
 {
     GDS_CONSTRUCT(&p->data, gds_list_t);
+    GDS_CONSTRUCT(&p->index, gds_key_index_t);
 }
 static void pddes(gds_proc_data_t *p)
 {
     GDS_LIST_DESTRUCT(&p->data);
+    GDS_DESTRUCT(&p->index);
 }
 static GDS_CLASS_INSTANCE(gds_proc_data_t,
                            gds_list_item_t,
                            pdcon, pddes);
 
-static gds_kval_t* lookup_keyval(gds_list_t *data,
-                                  const char *key);
-static gds_proc_data_t* lookup_proc(gds_hash_table_t *jtable,
-                                     uint64_t id, bool create);
+/* procs looked at per step of a walk over the whole table */
+#define GDS_HASH_FETCH_BATCH 64
+
+static void ptcon(gds_proc_table_t *pt)
+{
+    memset(pt->pt_dense, 0, sizeof(pt->pt_dense));
+    pt->pt_ndense = 0;
+    pt->pt_outliers = 0;
+    /* initialized when the first outlier arrives */
+    GDS_CONSTRUCT(&pt->pt_sparse, gds_hash_table_t);
+}
+static void ptdes(gds_proc_table_t *pt);
+GDS_CLASS_INSTANCE(gds_proc_table_t,
+                   gds_object_t,
+                   ptcon, ptdes);
 
-gds_status_t gds_hash_store(gds_hash_table_t *table,
+/* a walk over every proc in a table - the dense array in rank
+ * order, then the outliers */
+typedef struct {
+    uint64_t next;                      /* next rank in the dense array */
+    gds_hash_table_cursor_t sparse;
+} proc_walk_t;
+
+static gds_kval_t* lookup_keyval(gds_proc_data_t *proc_data,
+                                  gds_atom_t atom);
+static void remove_keyval(gds_proc_data_t *proc_data,
+                          gds_atom_t atom, gds_kval_t *kv);
+static gds_proc_data_t* lookup_proc(gds_proc_table_t *table,
+                                     uint64_t id, bool create);
+static void remove_proc(gds_proc_table_t *table, uint64_t id);
+static void walk_init(proc_walk_t *walk);
+static size_t walk_next(gds_proc_table_t *table, proc_walk_t *walk,
+                        uint64_t *ids, gds_proc_data_t **procs, size_t max);
+static int walk_step(gds_proc_table_t *table, void *in_pos,
+                     uint64_t *id, gds_proc_data_t **proc_data, void **out_pos);
+
+gds_status_t gds_hash_store(gds_proc_table_t *table,
                     int rank, gds_kval_t *kin)
 {
     gds_proc_data_t *proc_data;
     uint64_t id;
     gds_kval_t *hv;
+    gds_atom_t atom;
+    gds_status_t rc;
 
     gds_output_verbose(10, gds_globals.debug_output,
                         "HASH:STORE rank %d key %s",
@@ -78,6 +119,10 @@ gds_status_t gds_hash_store(gds_hash_table_t *table,
 
     id = (uint64_t)rank;
 
+    if (GDS_SUCCESS != (rc = gds_atom_intern(kin->key, &atom))) {
+        return rc;
+    }
+
     /* lookup the proc data object for this proc - create
      * it if we don't already have it */
     if (NULL == (proc_data = lookup_proc(table, id, true))) {
@@ -85,33 +130,42 @@ gds_status_t gds_hash_store(gds_hash_table_t *table,
     }
 
     /* see if we already have this key-value */
-    hv = lookup_keyval(&proc_data->data, kin->key);
+    hv = lookup_keyval(proc_data, atom);
     if (NULL != hv) {
         /* yes we do - so remove the current value
          * and replace it */
-        gds_list_remove_item(&proc_data->data, &hv->super);
+        remove_keyval(proc_data, atom, hv);
         GDS_RELEASE(hv);
     }
+    if (GDS_SUCCESS != (rc = gds_key_index_set(&proc_data->index, atom, kin))) {
+        return rc;
+    }
     GDS_RETAIN(kin);
     gds_list_append(&proc_data->data, &kin->super);
 
     return GDS_SUCCESS;
 }
 
-gds_status_t gds_hash_fetch(gds_hash_table_t *table, int rank,
+gds_status_t gds_hash_fetch(gds_proc_table_t *table, int rank,
                               const char *key, gds_value_t **kvs)
 {
     gds_status_t rc = GDS_SUCCESS;
     gds_proc_data_t *proc_data;
     gds_kval_t *hv;
     uint64_t id;
-    char *node;
+    gds_atom_t atom;
+    proc_walk_t walk;
+    uint64_t ids[GDS_HASH_FETCH_BATCH];
+    gds_proc_data_t *procs[GDS_HASH_FETCH_BATCH];
+    size_t n, nprocs;
 
     gds_output_verbose(10, gds_globals.debug_output,
                         "HASH:FETCH rank %d key %s",
                         rank, (NULL == key) ? "NULL" : key);
 
     id = (uint64_t)rank;
+    /* resolve the key once for all the procs we may search */
+    atom = gds_atom_lookup(key);
 
     /* - GDS_RANK_UNDEF should return following statuses
      * GDS_ERR_PROC_ENTRY_NOT_FOUND | GDS_SUCCESS
@@ -119,61 +173,68 @@ gds_status_t gds_hash_fetch(gds_hash_table_t *table, int rank,
      * GDS_ERR_PROC_ENTRY_NOT_FOUND | GDS_ERR_NOT_FOUND | GDS_SUCCESS
      * special logic is basing on these statuses on a client and a server */
     if (GDS_RANK_UNDEF == rank) {
-        rc = gds_hash_table_get_first_key_uint64(table, &id,
-                (void**)&proc_data, (void**)&node);
-        if (GDS_SUCCESS != rc) {
+        /* walk the procs a batch at a time - each batch comes
+         * back with its proc data already on its way into cache */
+        walk_init(&walk);
+        if (0 == (nprocs = walk_next(table, &walk, ids, procs, GDS_HASH_FETCH_BATCH))) {
             gds_output_verbose(10, gds_globals.debug_output,
                                 "HASH:FETCH proc data for rank %d not found",
                                 rank);
             return GDS_ERR_PROC_ENTRY_NOT_FOUND;
         }
+        do {
+            for (n=0; NULL != key && n < nprocs; n++) {
+                /* find the value from within this proc_data object */
+                if (NULL != (hv = lookup_keyval(procs[n], atom))) {
+                    /* create the copy */
+                    if (GDS_SUCCESS != (rc = gds_globals.mypeer->comm.bfrops->copy((void**)kvs, hv->value, GDS_VALUE))) {
+                        GDS_ERROR_LOG(rc);
+                        return rc;
+                    }
+                    return GDS_SUCCESS;
+                }
+            }
+        } while (0 < (nprocs = walk_next(table, &walk, ids, procs, GDS_HASH_FETCH_BATCH)));
+        gds_output_verbose(10, gds_globals.debug_output,
+                            "HASH:FETCH data for key %s not found", key);
+        return GDS_ERR_PROC_ENTRY_NOT_FOUND;
     }
 
-    while (GDS_SUCCESS == rc) {
-        proc_data = lookup_proc(table, id, false);
-        if (NULL == proc_data) {
-            gds_output_verbose(10, gds_globals.debug_output,
-                                "HASH:FETCH proc data for rank %d not found",
-                                rank);
-            return GDS_ERR_PROC_ENTRY_NOT_FOUND;
-        }
-
-        /* if the key is NULL, then the user wants -all- data
-         * put by the specified rank */
-        if (NULL == key) {
-            /* we will return the data as an array of gds_info_t
-             * in the kvs gds_value_t */
+    proc_data = lookup_proc(table, id, false);
+    if (NULL == proc_data) {
+        gds_output_verbose(10, gds_globals.debug_output,
+                            "HASH:FETCH proc data for rank %d not found",
+                            rank);
+        return GDS_ERR_PROC_ENTRY_NOT_FOUND;
+    }
 
-        } else {
-            /* find the value from within this proc_data object */
-            hv = lookup_keyval(&proc_data->data, key);
-            if (NULL != hv) {
-                /* create the copy */
-                if (GDS_SUCCESS != (rc = gds_globals.mypeer->comm.bfrops->copy((void**)kvs, hv->value, GDS_VALUE))) {
-                    GDS_ERROR_LOG(rc);
-                    return rc;
-                }
-                break;
-            } else if (GDS_RANK_UNDEF != rank) {
-                gds_output_verbose(10, gds_globals.debug_output,
-                                    "HASH:FETCH data for key %s not found", key);
-                return GDS_ERR_NOT_FOUND;
-            }
-        }
+    /* if the key is NULL, then the user wants -all- data
+     * put by the specified rank */
+    if (NULL == key) {
+        /* we will return the data as an array of gds_info_t
+         * in the kvs gds_value_t */
+        gds_output_verbose(10, gds_globals.debug_output,
+                            "HASH:FETCH data for key %s not found", key);
+        return GDS_ERR_PROC_ENTRY_NOT_FOUND;
+    }
 
-        rc = gds_hash_table_get_next_key_uint64(table, &id,
-                (void**)&proc_data, node, (void**)&node);
-        if (GDS_SUCCESS != rc) {
-            gds_output_verbose(10, gds_globals.debug_output,
-                                "HASH:FETCH data for key %s not found", key);
-            return GDS_ERR_PROC_ENTRY_NOT_FOUND;
-        }
+    /* find the value from within this proc_data object */
+    hv = lookup_keyval(proc_data, atom);
+    if (NULL == hv) {
+        gds_output_verbose(10, gds_globals.debug_output,
+                            "HASH:FETCH data for key %s not found", key);
+        return GDS_ERR_NOT_FOUND;
+    }
+    /* create the copy */
+    if (GDS_SUCCESS != (rc = gds_globals.mypeer->comm.bfrops->copy((void**)kvs, hv->value, GDS_VALUE))) {
+        GDS_ERROR_LOG(rc);
+        return rc;
     }
 
     return rc;
 }
 
-gds_status_t gds_hash_fetch_by_key(gds_hash_table_t *table, const char *key,
+gds_status_t gds_hash_fetch_by_key(gds_proc_table_t *table, const char *key,
                                      int *rank, gds_value_t **kvs, void **last)
 {
     gds_status_t rc = GDS_SUCCESS;
@@ -192,12 +253,10 @@ gds_status_t gds_hash_fetch_by_key(gds_hash_table_t *table, const char *key,
     }
 
     if (key) {
-        rc = gds_hash_table_get_first_key_uint64(table, &id,
-                (void**)&proc_data, (void**)&node);
+        rc = walk_step(table, NULL, &id, &proc_data, (void**)&node);
         key_r = key;
     } else {
-        rc = gds_hash_table_get_next_key_uint64(table, &id,
-                (void**)&proc_data, node, (void**)&node);
+        rc = walk_step(table, node, &id, &proc_data, (void**)&node);
     }
 
     gds_output_verbose(10, gds_globals.debug_output,
@@ -212,7 +271,7 @@ gds_status_t gds_hash_fetch_by_key(gds_hash_table_t *table, const char *key,
     }
 
     /* find the value from within this proc_data object */
-    hv = lookup_keyval(&proc_data->data, key_r);
+    hv = lookup_keyval(proc_data, gds_atom_lookup(key_r));
     if (hv) {
         /* create the copy */
         if (GDS_SUCCESS != (rc = gds_globals.mypeer->comm.bfrops->copy((void**)kvs, hv->value, GDS_VALUE))) {
@@ -229,39 +288,46 @@ gds_status_t gds_hash_fetch_by_key(gds_hash_table_t *table, const char *key,
     return GDS_SUCCESS;
 }
 
-gds_status_t gds_hash_remove_data(gds_hash_table_t *table,
+gds_status_t gds_hash_remove_data(gds_proc_table_t *table,
                           int rank, const char *key)
 {
-    gds_status_t rc = GDS_SUCCESS;
     gds_proc_data_t *proc_data;
     gds_kval_t *kv;
     uint64_t id;
-    char *node;
+    gds_atom_t atom;
+    proc_walk_t walk;
+    uint64_t ids[GDS_HASH_FETCH_BATCH];
+    gds_proc_data_t *procs[GDS_HASH_FETCH_BATCH];
+    size_t n, nprocs;
 
     id = (uint64_t)rank;
+    atom = gds_atom_lookup(key);
 
     /* if the rank is wildcard, we want to apply this to
      * all rank entries */
     if (GDS_RANK_UNDEF == rank) {
-        rc = gds_hash_table_get_first_key_uint64(table, &id,
-                (void**)&proc_data, (void**)&node);
-        while (GDS_SUCCESS == rc) {
-            if (NULL != proc_data) {
+        walk_init(&walk);
+        while (0 < (nprocs = walk_next(table, &walk, ids, procs, GDS_HASH_FETCH_BATCH))) {
+            for (n=0; n < nprocs; n++) {
                 if (NULL == key) {
-                    GDS_RELEASE(proc_data);
-                } else {
-                    GDS_LIST_FOREACH(kv, &proc_data->data, gds_kval_t) {
-                        if (0 == strcmp(key, kv->key)) {
-                            gds_list_remove_item(&proc_data->data, &kv->super);
-                            GDS_RELEASE(kv);
-                            break;
-                        }
-                    }
+                    GDS_RELEASE(procs[n]);
+                } else if (NULL != (kv = lookup_keyval(procs[n], atom))) {
+                    remove_keyval(procs[n], atom, kv);
+                    GDS_RELEASE(kv);
                 }
             }
-            rc = gds_hash_table_get_next_key_uint64(table, &id,
-                    (void**)&proc_data, node, (void**)&node);
         }
+        if (NULL == key) {
+            /* every proc is gone - start the table afresh */
+            for (n=0; n < GDS_PROC_TABLE_SEGMENTS; n++) {
+                free(table->pt_dense[n]);
+                table->pt_dense[n] = NULL;
+            }
+            table->pt_ndense = 0;
+            table->pt_outliers = 0;
+            gds_hash_table_remove_all(&table->pt_sparse);
+        }
+        return GDS_SUCCESS;
     }
 
     /* lookup the specified proc */
@@ -272,55 +338,253 @@ gds_status_t gds_hash_remove_data(gds_hash_table_t *table,
 
     /* if key is NULL, remove all data for this proc */
     if (NULL == key) {
+        gds_key_index_remove_all(&proc_data->index);
         while (NULL != (kv = (gds_kval_t*)gds_list_remove_first(&proc_data->data))) {
             GDS_RELEASE(kv);
         }
-        /* remove the proc_data object itself from the jtable */
-        gds_hash_table_remove_value_uint64(table, id);
+        /* remove the proc_data object itself from the table */
+        remove_proc(table, id);
         /* cleanup */
         GDS_RELEASE(proc_data);
         return GDS_SUCCESS;
     }
 
     /* remove this item */
-    GDS_LIST_FOREACH(kv, &proc_data->data, gds_kval_t) {
-        if (0 == strcmp(key, kv->key)) {
-            gds_list_remove_item(&proc_data->data, &kv->super);
-            GDS_RELEASE(kv);
-            break;
-        }
+    if (NULL != (kv = lookup_keyval(proc_data, atom))) {
+        remove_keyval(proc_data, atom, kv);
+        GDS_RELEASE(kv);
     }
 
     return GDS_SUCCESS;
 }
 
 /**
- * Find data for a given key in a given gds_list_t.
+ * Find data for a given key atom in a given proc_data object.
  */
-static gds_kval_t* lookup_keyval(gds_list_t *data,
-                                  const char *key)
+static gds_kval_t* lookup_keyval(gds_proc_data_t *proc_data,
+                                  gds_atom_t atom)
 {
-    gds_kval_t *kv;
+    if (GDS_ATOM_INVALID == atom) {
+        /* never interned, so never stored */
+        return NULL;
+    }
+    return (gds_kval_t*)gds_key_index_get(&proc_data->index, atom);
+}
+
+/**
+ * Remove an entry from a proc_data object - the caller
+ * is responsible for releasing it.
+ */
+static void remove_keyval(gds_proc_data_t *proc_data,
+                          gds_atom_t atom, gds_kval_t *kv)
+{
+    gds_key_index_remove(&proc_data->index, atom);
+    gds_list_remove_item(&proc_data->data, &kv->super);
+}
+
+
+/****    DENSE ARRAY    ****
+ *
+ * Segment 0 of the dense array holds ranks [0, GDS_PROC_TABLE_SEG0),
+ * and segment s > 0 the ranks [SEG0 << (s-1), SEG0 << s) - so the
+ * segment for a rank comes straight from its highest set bit, and
+ * no segment ever has to be copied to grow the array.
+ */
+#define GDS_PROC_TABLE_MAX ((uint64_t)GDS_PROC_TABLE_SEG0 << (GDS_PROC_TABLE_SEGMENTS - 1))
 
-    GDS_LIST_FOREACH(kv, data, gds_kval_t) {
-        if (0 == strcmp(key, kv->key)) {
-            return kv;
+static inline uint64_t dense_base(size_t s)
+{
+    return (0 == s) ? 0 : (uint64_t)GDS_PROC_TABLE_SEG0 << (s - 1);
+}
+
+static inline uint64_t dense_len(size_t s)
+{
+    return (0 == s) ? GDS_PROC_TABLE_SEG0 : (uint64_t)GDS_PROC_TABLE_SEG0 << (s - 1);
+}
+
+/* the segment a rank below GDS_PROC_TABLE_MAX falls in */
+static inline size_t dense_segment(uint64_t id)
+{
+    if (id < GDS_PROC_TABLE_SEG0) {
+        return 0;
+    }
+    return 64 - __builtin_clzll(id / GDS_PROC_TABLE_SEG0);
+}
+
+/* allocate a segment of the dense array, and move into it any
+ * outliers it covers. The segment is only published once they
+ * are in it - if they cannot be moved, it is dropped again */
+static void dense_alloc(gds_proc_table_t *table, size_t s)
+{
+    uint64_t base = dense_base(s), len = dense_len(s);
+    uint64_t ids[GDS_HASH_FETCH_BATCH], *moved;
+    gds_proc_data_t *procs[GDS_HASH_FETCH_BATCH];
+    gds_hash_table_cursor_t cursor;
+    size_t n, nprocs, nmoved = 0;
+    void **seg;
+
+    if (NULL != table->pt_dense[s]) {
+        return;
+    }
+    if (NULL == (seg = (void**)calloc(len, sizeof(void*)))) {
+        /* the procs will just go in the hash table */
+        return;
+    }
+    if (0 == (table->pt_outliers & (1u << s))) {
+        table->pt_dense[s] = seg;
+        return;
+    }
+    moved = (uint64_t*)malloc(gds_hash_table_get_size(&table->pt_sparse) * sizeof(uint64_t));
+    if (NULL == moved) {
+        /* leave them where they are - they can still be found,
+         * and we can try again when the next proc arrives */
+        free(seg);
+        return;
+    }
+    /* the hash table must not change while we walk it, so take
+     * them out afterwards */
+    gds_hash_table_cursor_init(&cursor);
+    while (GDS_SUCCESS == gds_hash_table_get_batch_uint64(&table->pt_sparse, &cursor, ids,
+                                                          (void**)procs, GDS_HASH_FETCH_BATCH, &nprocs)) {
+        for (n=0; n < nprocs; n++) {
+            if (base <= ids[n] && ids[n] < base + len) {
+                seg[ids[n] - base] = procs[n];
+                moved[nmoved++] = ids[n];
+            }
         }
     }
+    for (n=0; n < nmoved; n++) {
+        gds_hash_table_remove_value_uint64(&table->pt_sparse, moved[n]);
+    }
+    table->pt_dense[s] = seg;
+    table->pt_ndense += nmoved;
+    table->pt_outliers &= ~(1u << s);
+    free(moved);
+}
+
+/* the first proc in the dense array at or after the given rank,
+ * updating the rank to match */
+static gds_proc_data_t* dense_next(gds_proc_table_t *table, uint64_t *id)
+{
+    uint64_t r = *id, base, len;
+    void **seg;
+    size_t s;
+
+    while (r < GDS_PROC_TABLE_MAX) {
+        s = dense_segment(r);
+        base = dense_base(s);
+        len = dense_len(s);
+        if (NULL != (seg = table->pt_dense[s])) {
+            for (; r < base + len; r++) {
+                if (NULL != seg[r - base]) {
+                    *id = r;
+                    return (gds_proc_data_t*)seg[r - base];
+                }
+            }
+        }
+        r = base + len;
+    }
     return NULL;
 }
 
+static void ptdes(gds_proc_table_t *pt)
+{
+    proc_walk_t walk;
+    uint64_t ids[GDS_HASH_FETCH_BATCH];
+    gds_proc_data_t *procs[GDS_HASH_FETCH_BATCH];
+    size_t n, nprocs;
+
+    /* release whatever procs are left */
+    walk_init(&walk);
+    while (0 < (nprocs = walk_next(pt, &walk, ids, procs, GDS_HASH_FETCH_BATCH))) {
+        for (n=0; n < nprocs; n++) {
+            GDS_RELEASE(procs[n]);
+        }
+    }
+    for (n=0; n < GDS_PROC_TABLE_SEGMENTS; n++) {
+        free(pt->pt_dense[n]);
+    }
+    GDS_DESTRUCT(&pt->pt_sparse);
+}
+
+static void walk_init(proc_walk_t *walk)
+{
+    walk->next = 0;
+    gds_hash_table_cursor_init(&walk->sparse);
+}
+
+/* fill the given arrays with the next procs of a walk, returning
+ * how many there are - 0 once the walk is complete */
+static size_t walk_next(gds_proc_table_t *table, proc_walk_t *walk,
+                        uint64_t *ids, gds_proc_data_t **procs, size_t max)
+{
+    gds_proc_data_t *proc_data;
+    size_t n = 0, nsparse;
+
+    while (n < max) {
+        if (NULL == (proc_data = dense_next(table, &walk->next))) {
+            walk->next = GDS_PROC_TABLE_MAX;
+            break;
+        }
+        GDS_PREFETCH(proc_data, 0, 3);
+        ids[n] = walk->next++;
+        procs[n++] = proc_data;
+    }
+    if (n < max &&
+        GDS_SUCCESS == gds_hash_table_get_batch_uint64(&table->pt_sparse, &walk->sparse,
+                                                       ids + n, (void**)(procs + n),
+                                                       max - n, &nsparse)) {
+        n += nsparse;
+    }
+    return n;
+}
+
+/* one step of a walk, for callers that can only keep a pointer
+ * between steps. A NULL position starts the walk - after that, it
+ * is either a rank in the dense array, tagged in its low bit, or
+ * the node of an outlier in the hash table */
+static int walk_step(gds_proc_table_t *table, void *in_pos,
+                     uint64_t *id, gds_proc_data_t **proc_data, void **out_pos)
+{
+    uintptr_t pos = (uintptr_t)in_pos;
+    uint64_t r;
+
+    if (0 == pos || (pos & 1)) {
+        r = (0 == pos) ? 0 : (pos >> 1) + 1;
+        if (NULL != (*proc_data = dense_next(table, &r))) {
+            *id = r;
+            *out_pos = (void*)(uintptr_t)((r << 1) | 1);
+            return GDS_SUCCESS;
+        }
+        return gds_hash_table_get_first_key_uint64(&table->pt_sparse, id,
+                                                   (void**)proc_data, out_pos);
+    }
+    return gds_hash_table_get_next_key_uint64(&table->pt_sparse, id,
+                                              (void**)proc_data, in_pos, out_pos);
+}
 
 /**
  * Find proc_data_t container associated with given
  * gds_identifier_t.
  */
-static gds_proc_data_t* lookup_proc(gds_hash_table_t *jtable,
+static gds_proc_data_t* lookup_proc(gds_proc_table_t *table,
                                      uint64_t id, bool create)
 {
     gds_proc_data_t *proc_data = NULL;
-
-    gds_hash_table_get_value_uint64(jtable, id, (void**)&proc_data);
+    uint64_t limit;
+    uint32_t grow;
+    size_t s = 0;
+
+    if (id < GDS_PROC_TABLE_MAX) {
+        s = dense_segment(id);
+        if (NULL != table->pt_dense[s] &&
+            NULL != (proc_data = (gds_proc_data_t*)table->pt_dense[s][id - dense_base(s)])) {
+            return proc_data;
+        }
+    }
+    if (0 < gds_hash_table_get_size(&table->pt_sparse)) {
+        gds_hash_table_get_value_uint64(&table->pt_sparse, id, (void**)&proc_data);
+    }
     if (NULL == proc_data && create) {
         /* The proc clearly exists, so create a data structure for it */
         proc_data = GDS_NEW(gds_proc_data_t);
@@ -328,8 +592,53 @@ static gds_proc_data_t* lookup_proc(gds_hash_table_t *jtable,
             gds_output(0, "gds:client:hash:lookup_gds_proc: unable to allocate proc_data_t\n");
             return NULL;
         }
-        gds_hash_table_set_value_uint64(jtable, id, proc_data);
+        /* a segment is worth having once there are about half as
+         * many procs as ranks below it */
+        limit = 2 * (table->pt_ndense + gds_hash_table_get_size(&table->pt_sparse) + 1) +
+                GDS_PROC_TABLE_SEG0;
+        if (id < GDS_PROC_TABLE_MAX && NULL == table->pt_dense[s] && dense_base(s) < limit) {
+            dense_alloc(table, s);
+        }
+        if (id < GDS_PROC_TABLE_MAX && NULL != table->pt_dense[s]) {
+            table->pt_dense[s][id - dense_base(s)] = proc_data;
+            table->pt_ndense++;
+        } else {
+            if ((0 == table->pt_sparse.ht_capacity &&
+                 GDS_SUCCESS != gds_hash_table_init(&table->pt_sparse, GDS_PROC_TABLE_SEG0)) ||
+                GDS_SUCCESS != gds_hash_table_set_value_uint64(&table->pt_sparse, id, proc_data)) {
+                GDS_RELEASE(proc_data);
+                return NULL;
+            }
+            if (id < GDS_PROC_TABLE_MAX) {
+                table->pt_outliers |= 1u << s;
+            }
+        }
+        /* outliers that have since come to look dense move in */
+        for (grow = table->pt_outliers; 0 != grow; grow &= grow - 1) {
+            s = __builtin_ctz(grow);
+            if (NULL == table->pt_dense[s] && dense_base(s) < limit) {
+                dense_alloc(table, s);
+            }
+        }
     }
 
     return proc_data;
 }
+
+/* take a proc out of the table - the caller releases it */
+static void remove_proc(gds_proc_table_t *table, uint64_t id)
+{
+    size_t s;
+
+    if (id < GDS_PROC_TABLE_MAX) {
+        s = dense_segment(id);
+        if (NULL != table->pt_dense[s] && NULL != table->pt_dense[s][id - dense_base(s)]) {
+            table->pt_dense[s][id - dense_base(s)] = NULL;
+            table->pt_ndense--;
+            return;
+        }
+    }
+    if (0 < gds_hash_table_get_size(&table->pt_sparse)) {
+        gds_hash_table_remove_value_uint64(&table->pt_sparse, id);
+    }
+}
@@ -22,32 +22,55 @@
 
 BEGIN_C_DECLS
 
-/* store a value in the given hash table for the specified
+/* ranks in the first segment of a gds_proc_table_t's dense array -
+ * each later segment holds as many ranks as all those before it */
+#define GDS_PROC_TABLE_SEG0     64
+/* enough segments to cover every non-negative int rank */
+#define GDS_PROC_TABLE_SEGMENTS 26
+
+/**
+ * The data stored for a set of procs, by rank. Ranks in a namespace
+ * are normally dense from 0, so procs are kept in a segmented array
+ * indexed directly by rank. A segment is only allocated once there
+ * are at least about half as many procs as ranks below it - until
+ * then, procs that would go in it are outliers, and are kept in a
+ * hash table. When the segment is allocated, they move into it.
+ */
+typedef struct {
+    gds_object_t        super;
+    void **             pt_dense[GDS_PROC_TABLE_SEGMENTS];  /**< the dense array */
+    size_t              pt_ndense;      /**< number of procs in the dense array */
+    uint32_t            pt_outliers;    /**< segments that have procs in pt_sparse */
+    gds_hash_table_t    pt_sparse;      /**< the outliers, by rank */
+} gds_proc_table_t;
+GDS_CLASS_DECLARATION(gds_proc_table_t);
+
+/* store a value in the given table for the specified
  * rank index.*/
-gds_status_t gds_hash_store(gds_hash_table_t *table,
+gds_status_t gds_hash_store(gds_proc_table_t *table,
                               int rank, gds_kval_t *kv);
 
 /* Fetch the value for a specified key and rank from within
- * the given hash_table */
-gds_status_t gds_hash_fetch(gds_hash_table_t *table, int rank,
+ * the given table */
+gds_status_t gds_hash_fetch(gds_proc_table_t *table, int rank,
                               const char *key, gds_value_t **kvs);
 
 /* Fetch the value for a specified key from within
- * the given hash_table
+ * the given table
  * It gets the next portion of data from table, where matching key.
  * To get the first data from table, function is called with key parameter as string.
  * Remaining data from table are obtained by calling function with a null pointer for the key parameter.*/
-gds_status_t gds_hash_fetch_by_key(gds_hash_table_t *table, const char *key,
+gds_status_t gds_hash_fetch_by_key(gds_proc_table_t *table, const char *key,
                                      int *rank, gds_value_t **kvs, void **last);
 
-/* remove the specified key-value from the given hash_table.
+/* remove the specified key-value from the given table.
  * A NULL key will result in removal of all data for the
  * given rank. A rank of GDS_RANK_WILDCARD indicates that
  * the specified key  is to be removed from the data for all
  * ranks in the table. Combining key=NULL with rank=GDS_RANK_WILDCARD
  * will therefore result in removal of all data from the
  * table */
-gds_status_t gds_hash_remove_data(gds_hash_table_t *table,
+gds_status_t gds_hash_remove_data(gds_proc_table_t *table,
                                     int rank, const char *key);
 
 END_C_DECLS
@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2016      Intel, Inc. All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+/* gds_cinfo_t support - the functions are declared in gds_common.h */
+
+#include <src/include/gds_config.h>
+
+#include <string.h>
+#include <stdlib.h>
+
+#include <gds.h>
+
+#include "src/util/atom.h"
+
+static void release_key(gds_cinfo_t *m)
+{
+    if (GDS_CINFO_KEY_HEAP == m->keyloc) {
+        free((char*)m->key.ptr);
+    }
+    m->keyloc = GDS_CINFO_KEY_INLINE;
+    m->key.inl[0] = '\0';
+    m->keylen = 0;
+    m->atom = GDS_ATOM_INVALID;
+}
+
+gds_status_t gds_cinfo_set_key(gds_cinfo_t *m, const char *key)
+{
+    const char *end;
+    size_t len;
+    char *copy;
+    gds_atom_t atom;
+
+    release_key(m);
+    end = (const char*)memchr(key, '\0', GDS_MAX_KEYLEN + 1);
+    len = (NULL == end) ? GDS_MAX_KEYLEN : (size_t)(end - key);
+
+    if (len <= GDS_CINFO_INLINE_KEYLEN) {
+        memcpy(m->key.inl, key, len);
+        m->key.inl[len] = '\0';
+        m->keylen = len;
+        return GDS_SUCCESS;
+    }
+
+    /* a long key that has been interned can share the
+     * dictionary's copy */
+    if (NULL != end && GDS_ATOM_INVALID != (atom = gds_atom_lookup(key))) {
+        m->key.ptr = gds_atom_key(atom);
+        m->keyloc = GDS_CINFO_KEY_ATOM;
+        m->keylen = len;
+        m->atom = atom;
+        return GDS_SUCCESS;
+    }
+
+    if (NULL == (copy = (char*)malloc(len + 1))) {
+        return GDS_ERR_OUT_OF_RESOURCE;
+    }
+    memcpy(copy, key, len);
+    copy[len] = '\0';
+    m->key.ptr = copy;
+    m->keyloc = GDS_CINFO_KEY_HEAP;
+    m->keylen = len;
+    return GDS_SUCCESS;
+}
+
+gds_status_t gds_cinfo_set_atom(gds_cinfo_t *m, gds_atom_t atom)
+{
+    const char *key;
+    size_t len;
+
+    if (NULL == (key = gds_atom_key(atom))) {
+        return GDS_ERR_BAD_PARAM;
+    }
+    release_key(m);
+    len = strlen(key);
+    if (len <= GDS_CINFO_INLINE_KEYLEN) {
+        memcpy(m->key.inl, key, len + 1);
+    } else {
+        m->key.ptr = key;
+        m->keyloc = GDS_CINFO_KEY_ATOM;
+    }
+    m->keylen = len;
+    m->atom = atom;
+    return GDS_SUCCESS;
+}
+
+gds_status_t gds_info_to_cinfo(gds_cinfo_t dst[], gds_info_t src[], size_t n)
+{
+    gds_status_t rc;
+    size_t i;
+
+    for (i=0; i < n; i++) {
+        if (GDS_SUCCESS != (rc = gds_cinfo_set_key(&dst[i], src[i].key))) {
+            return rc;
+        }
+        dst[i].flags = src[i].flags;
+        if (GDS_SUCCESS != (rc = gds_value_xfer(&dst[i].value, &src[i].value))) {
+            return rc;
+        }
+    }
+    return GDS_SUCCESS;
+}
+
+gds_status_t gds_cinfo_to_info(gds_info_t dst[], gds_cinfo_t src[], size_t n)
+{
+    gds_status_t rc;
+    size_t i;
+
+    for (i=0; i < n; i++) {
+        (void)gds_key_copy(dst[i].key, GDS_CINFO_KEY(&src[i]));
+        dst[i].flags = src[i].flags;
+        if (GDS_SUCCESS != (rc = gds_value_xfer(&dst[i].value, &src[i].value))) {
+            return rc;
+        }
+    }
+    return GDS_SUCCESS;
+}